@@ -0,0 +1,463 @@
+// Copyright (c) 2014-2019 The Dash Core Developers, The DAC Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "appcache.h"
+
+#include "compat.h"
+#include "crypto/common.h"
+#include "hash.h"
+#include "util.h"
+#include "utiltime.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <string.h>
+#include <thread>
+
+#include <boost/filesystem.hpp>
+#include <boost/thread/locks.hpp>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+CApplicationCache::Section* CApplicationCache::FindSection(const std::string& sSection) const
+{
+	boost::shared_lock<boost::shared_mutex> lock(csSections);
+	auto it = mapSectionIds.find(sSection);
+	if (it == mapSectionIds.end())
+		return NULL;
+	return vSections[it->second].get();
+}
+
+CApplicationCache::Section* CApplicationCache::FindOrCreateSection(const std::string& sSection)
+{
+	Section* pSection = FindSection(sSection);
+	if (pSection)
+		return pSection;
+	boost::unique_lock<boost::shared_mutex> lock(csSections);
+	// Another writer may have interned it between the two locks
+	auto it = mapSectionIds.find(sSection);
+	if (it != mapSectionIds.end())
+		return vSections[it->second].get();
+	vSections.emplace_back(new Section());
+	mapSectionIds.emplace(sSection, (int)vSections.size() - 1);
+	return vSections.back().get();
+}
+
+CAppCacheEntry CApplicationCache::Read(const std::string& sSection, const std::string& sKey) const
+{
+	Section* pSection = FindSection(sSection);
+	if (!pSection)
+		return CAppCacheEntry(std::string(), 0);
+	boost::shared_lock<boost::shared_mutex> lock(pSection->cs);
+	auto it = pSection->mapEntries.find(sKey);
+	if (it == pSection->mapEntries.end())
+		return CAppCacheEntry(std::string(), 0);
+	return it->second;
+}
+
+void CApplicationCache::Write(const std::string& sSection, const std::string& sKey, const std::string& sValue, int64_t nTimestamp)
+{
+	Section* pSection = FindOrCreateSection(sSection);
+	{
+		boost::unique_lock<boost::shared_mutex> lock(pSection->cs);
+		CAppCacheEntry& entry = pSection->mapEntries[sKey];
+		entry.first = sValue;
+		entry.second = nTimestamp;
+	}
+	if (fJournal)
+	{
+		std::lock_guard<std::mutex> lock(csJournal);
+		AddToJournal(sSection, sKey);
+	}
+}
+
+void CApplicationCache::Erase(const std::string& sSection, const std::string& sKey)
+{
+	Section* pSection = FindSection(sSection);
+	if (!pSection)
+		return;
+	{
+		boost::unique_lock<boost::shared_mutex> lock(pSection->cs);
+		if (!pSection->mapEntries.erase(sKey))
+			return;
+	}
+	if (fJournal)
+	{
+		std::lock_guard<std::mutex> lock(csJournal);
+		AddToJournal(sSection, sKey);
+	}
+}
+
+void CApplicationCache::ClearSection(const std::string& sSection)
+{
+	Section* pSection = FindSection(sSection);
+	if (!pSection)
+		return;
+	boost::unique_lock<boost::shared_mutex> lock(pSection->cs);
+	std::lock_guard<std::mutex> lockJournal(csJournal);
+	for (auto& item : pSection->mapEntries)
+	{
+		item.second.first.clear();
+		item.second.second = 0;
+		if (fJournal)
+			AddToJournal(sSection, item.first);
+	}
+}
+
+std::vector<std::pair<std::string, CAppCacheEntry>> CApplicationCache::GetSection(const std::string& sSection) const
+{
+	std::vector<std::pair<std::string, CAppCacheEntry>> vEntries;
+	Section* pSection = FindSection(sSection);
+	if (!pSection)
+		return vEntries;
+	boost::shared_lock<boost::shared_mutex> lock(pSection->cs);
+	vEntries.reserve(pSection->mapEntries.size());
+	vEntries.assign(pSection->mapEntries.begin(), pSection->mapEntries.end());
+	return vEntries;
+}
+
+size_t CApplicationCache::GetSectionSize(const std::string& sSection) const
+{
+	Section* pSection = FindSection(sSection);
+	if (!pSection)
+		return 0;
+	boost::shared_lock<boost::shared_mutex> lock(pSection->cs);
+	return pSection->mapEntries.size();
+}
+
+std::vector<std::string> CApplicationCache::GetSectionNames(const std::string& sPattern) const
+{
+	std::vector<std::string> vNames;
+	boost::shared_lock<boost::shared_mutex> lock(csSections);
+	for (const auto& item : mapSectionIds)
+	{
+		if (sPattern.empty() || item.first.find(sPattern) != std::string::npos)
+			vNames.push_back(item.first);
+	}
+	return vNames;
+}
+
+size_t CApplicationCache::GetSectionCount() const
+{
+	boost::shared_lock<boost::shared_mutex> lock(csSections);
+	return vSections.size();
+}
+
+size_t CApplicationCache::Size() const
+{
+	boost::shared_lock<boost::shared_mutex> lock(csSections);
+	size_t nSize = 0;
+	for (const auto& pSection : vSections)
+	{
+		boost::shared_lock<boost::shared_mutex> lockSection(pSection->cs);
+		nSize += pSection->mapEntries.size();
+	}
+	return nSize;
+}
+
+std::vector<CAppCacheRecord> CApplicationCache::GetAll() const
+{
+	std::vector<CAppCacheRecord> vRecords;
+	for (const std::string& sSection : GetSectionNames())
+	{
+		for (const auto& item : GetSection(sSection))
+			vRecords.push_back(CAppCacheRecord{sSection, item.first, item.second, false});
+	}
+	return vRecords;
+}
+
+// csJournal must be held
+void CApplicationCache::AddToJournal(const std::string& sSection, const std::string& sKey)
+{
+	if (fJournalOverflow)
+		return;
+	// Rewriting a key already in the journal costs nothing; only distinct keys count against the limit
+	if (setJournal.emplace(sSection, sKey).second && setJournal.size() > MAX_APPCACHE_JOURNAL)
+	{
+		fJournalOverflow = true;
+		setJournal.clear();
+	}
+}
+
+void CApplicationCache::StartJournal()
+{
+	std::lock_guard<std::mutex> lock(csJournal);
+	setJournal.clear();
+	fJournalOverflow = false;
+	fJournal = true;
+}
+
+bool CApplicationCache::IsJournalOverflowed() const
+{
+	std::lock_guard<std::mutex> lock(csJournal);
+	return fJournalOverflow;
+}
+
+bool CApplicationCache::IsJournaling() const
+{
+	return fJournal;
+}
+
+std::vector<CAppCacheRecord> CApplicationCache::TakeJournal()
+{
+	std::set<std::pair<std::string, std::string>> setKeys;
+	{
+		std::lock_guard<std::mutex> lock(csJournal);
+		setKeys.swap(setJournal);
+	}
+	std::vector<CAppCacheRecord> vRecords;
+	vRecords.reserve(setKeys.size());
+	for (const auto& key : setKeys)
+	{
+		CAppCacheRecord r{key.first, key.second, CAppCacheEntry(std::string(), 0), true};
+		Section* pSection = FindSection(key.first);
+		if (pSection)
+		{
+			boost::shared_lock<boost::shared_mutex> lock(pSection->cs);
+			auto it = pSection->mapEntries.find(key.second);
+			if (it != pSection->mapEntries.end())
+			{
+				r.entry = it->second;
+				r.fErased = false;
+			}
+		}
+		vRecords.push_back(r);
+	}
+	return vRecords;
+}
+
+static const unsigned char APPCACHE_SNAPSHOT_MAGIC[4] = {'B', 'A', 'P', 'C'};
+static const size_t APPCACHE_HEADER_SIZE = 8;
+// Height, record count and payload size ahead of the payload, checksum after it
+static const size_t APPCACHE_CHUNK_OVERHEAD = 16;
+
+static void AppendLE32(std::vector<unsigned char>& vch, uint32_t n)
+{
+	unsigned char buf[4];
+	WriteLE32(buf, n);
+	vch.insert(vch.end(), buf, buf + 4);
+}
+
+static void AppendString(std::vector<unsigned char>& vch, const std::string& s)
+{
+	AppendLE32(vch, s.size());
+	vch.insert(vch.end(), s.begin(), s.end());
+}
+
+static std::vector<unsigned char> SerializeAppCacheChunk(const std::vector<CAppCacheRecord>& vRecords, int nHeight)
+{
+	std::vector<unsigned char> vchPayload;
+	for (const auto& r : vRecords)
+	{
+		unsigned char buf[8];
+		WriteLE64(buf, (uint64_t)r.entry.second);
+		vchPayload.insert(vchPayload.end(), buf, buf + 8);
+		vchPayload.push_back(r.fErased ? 1 : 0);
+		AppendString(vchPayload, r.sSection);
+		AppendString(vchPayload, r.sKey);
+		AppendString(vchPayload, r.entry.first);
+	}
+	std::vector<unsigned char> vchChunk;
+	vchChunk.reserve(vchPayload.size() + APPCACHE_CHUNK_OVERHEAD);
+	AppendLE32(vchChunk, (uint32_t)nHeight);
+	AppendLE32(vchChunk, vRecords.size());
+	AppendLE32(vchChunk, vchPayload.size());
+	vchChunk.insert(vchChunk.end(), vchPayload.begin(), vchPayload.end());
+	uint256 hash = Hash(vchPayload.begin(), vchPayload.end());
+	vchChunk.insert(vchChunk.end(), hash.begin(), hash.begin() + 4);
+	return vchChunk;
+}
+
+static bool ReadString(const unsigned char*& p, const unsigned char* pEnd, std::string& s)
+{
+	if (pEnd - p < 4)
+		return false;
+	uint32_t nLen = ReadLE32(p);
+	p += 4;
+	if ((uint64_t)(pEnd - p) < nLen)
+		return false;
+	s.assign((const char*)p, nLen);
+	p += nLen;
+	return true;
+}
+
+// Walk the chunks in [pBegin, pEnd) and apply them to the cache.  nValidSize receives the length of the good prefix.
+static int ApplyAppCacheSnapshot(const unsigned char* pBegin, const unsigned char* pEnd, CApplicationCache& cache, int& nRecords, size_t& nValidSize)
+{
+	nValidSize = 0;
+	if (pEnd - pBegin < (ptrdiff_t)APPCACHE_HEADER_SIZE || memcmp(pBegin, APPCACHE_SNAPSHOT_MAGIC, 4) != 0)
+		return -1;
+	if (ReadLE32(pBegin + 4) != APPCACHE_SNAPSHOT_VERSION)
+		return -1;
+	int nHeight = -1;
+	const unsigned char* p = pBegin + APPCACHE_HEADER_SIZE;
+	nValidSize = APPCACHE_HEADER_SIZE;
+	while ((size_t)(pEnd - p) >= APPCACHE_CHUNK_OVERHEAD)
+	{
+		int nChunkHeight = (int)ReadLE32(p);
+		uint32_t nCount = ReadLE32(p + 4);
+		uint32_t nPayload = ReadLE32(p + 8);
+		const unsigned char* pPayload = p + 12;
+		if ((uint64_t)(pEnd - pPayload) < (uint64_t)nPayload + 4)
+			break;
+		const unsigned char* pPayloadEnd = pPayload + nPayload;
+		uint256 hash = Hash(pPayload, pPayloadEnd);
+		if (memcmp(hash.begin(), pPayloadEnd, 4) != 0)
+			break;
+		const unsigned char* q = pPayload;
+		CAppCacheRecord r;
+		for (uint32_t i = 0; i < nCount; i++)
+		{
+			if (pPayloadEnd - q < 9)
+				return nHeight;
+			r.entry.second = (int64_t)ReadLE64(q);
+			r.fErased = q[8] != 0;
+			q += 9;
+			if (!ReadString(q, pPayloadEnd, r.sSection) || !ReadString(q, pPayloadEnd, r.sKey) || !ReadString(q, pPayloadEnd, r.entry.first))
+				return nHeight;
+			if (r.fErased)
+				cache.Erase(r.sSection, r.sKey);
+			else
+				cache.Write(r.sSection, r.sKey, r.entry.first, r.entry.second);
+			nRecords++;
+		}
+		p = pPayloadEnd + 4;
+		nValidSize = p - pBegin;
+		nHeight = nChunkHeight;
+	}
+	return nHeight;
+}
+
+int LoadAppCacheSnapshot(const std::string& sPath, CApplicationCache& cache, int& nRecords)
+{
+	nRecords = 0;
+	size_t nValidSize = 0;
+	int nHeight = -1;
+	boost::system::error_code ec;
+	uint64_t nFileSize = boost::filesystem::file_size(sPath, ec);
+	if (ec || nFileSize == 0)
+		return -1;
+#ifndef WIN32
+	int fd = open(sPath.c_str(), O_RDONLY);
+	if (fd < 0)
+		return -1;
+	void* pMap = mmap(NULL, nFileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (pMap == MAP_FAILED)
+		return -1;
+	// The file is read front to back exactly once
+	madvise(pMap, nFileSize, MADV_SEQUENTIAL);
+	const unsigned char* pBegin = (const unsigned char*)pMap;
+	nHeight = ApplyAppCacheSnapshot(pBegin, pBegin + nFileSize, cache, nRecords, nValidSize);
+	munmap(pMap, nFileSize);
+#else
+	std::vector<unsigned char> vch(nFileSize);
+	FILE* file = fopen(sPath.c_str(), "rb");
+	if (!file)
+		return -1;
+	size_t nRead = fread(vch.data(), 1, vch.size(), file);
+	fclose(file);
+	nHeight = ApplyAppCacheSnapshot(vch.data(), vch.data() + nRead, cache, nRecords, nValidSize);
+#endif
+	// Drop a torn append so the next chunk lands directly after the last good one
+	if (nHeight >= 0 && nValidSize < nFileSize)
+	{
+		LogPrintf("LoadAppCacheSnapshot: discarding %d corrupt bytes at the end of %s\n", nFileSize - nValidSize, sPath);
+		boost::filesystem::resize_file(sPath, nValidSize, ec);
+	}
+	return nHeight;
+}
+
+static bool WriteAppCacheFile(const std::string& sPath, const std::vector<unsigned char>& vchChunk, bool fFull)
+{
+	std::string sTarget = fFull ? sPath + ".new" : sPath;
+	FILE* file = fopen(sTarget.c_str(), fFull ? "wb" : "ab");
+	if (!file)
+		return false;
+	bool fOk = true;
+	if (fFull)
+	{
+		unsigned char header[APPCACHE_HEADER_SIZE];
+		memcpy(header, APPCACHE_SNAPSHOT_MAGIC, 4);
+		WriteLE32(header + 4, APPCACHE_SNAPSHOT_VERSION);
+		fOk = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+	}
+	fOk = fOk && fwrite(vchChunk.data(), 1, vchChunk.size(), file) == vchChunk.size();
+	fOk = fOk && fflush(file) == 0;
+	if (fOk)
+		FileCommit(file);
+	fclose(file);
+	if (fOk && fFull)
+		fOk = RenameOver(sTarget, sPath);
+	return fOk;
+}
+
+struct AppCacheSnapshotJob
+{
+	std::string sPath;
+	std::vector<CAppCacheRecord> vRecords;
+	int nHeight;
+	bool fFull;
+};
+
+static std::mutex csSnapshot;
+static std::condition_variable condSnapshot;
+static std::deque<AppCacheSnapshotJob> dqSnapshotJobs;
+static std::thread threadSnapshot;
+static bool fSnapshotStopping = false;
+
+static void ThreadAppCacheSnapshot()
+{
+	while (true)
+	{
+		AppCacheSnapshotJob job;
+		{
+			std::unique_lock<std::mutex> lock(csSnapshot);
+			condSnapshot.wait(lock, [] { return fSnapshotStopping || !dqSnapshotJobs.empty(); });
+			if (dqSnapshotJobs.empty())
+				return;
+			job = std::move(dqSnapshotJobs.front());
+			dqSnapshotJobs.pop_front();
+		}
+		int64_t nStart = GetTimeMillis();
+		std::vector<unsigned char> vchChunk = SerializeAppCacheChunk(job.vRecords, job.nHeight);
+		if (!WriteAppCacheFile(job.sPath, vchChunk, job.fFull))
+			LogPrintf("ThreadAppCacheSnapshot: unable to write %s\n", job.sPath);
+		else if (job.fFull)
+			LogPrintf("ThreadAppCacheSnapshot: wrote %d records at height %d in %dms\n", job.vRecords.size(), job.nHeight, GetTimeMillis() - nStart);
+	}
+}
+
+void QueueAppCacheSnapshot(const std::string& sPath, std::vector<CAppCacheRecord>&& vRecords, int nHeight, bool fFull)
+{
+	std::unique_lock<std::mutex> lock(csSnapshot);
+	if (fSnapshotStopping)
+		return;
+	// A full snapshot supersedes anything still waiting to be written to the same file
+	if (fFull)
+	{
+		dqSnapshotJobs.erase(std::remove_if(dqSnapshotJobs.begin(), dqSnapshotJobs.end(),
+			[&sPath](const AppCacheSnapshotJob& job) { return job.sPath == sPath; }), dqSnapshotJobs.end());
+	}
+	dqSnapshotJobs.push_back(AppCacheSnapshotJob{sPath, std::move(vRecords), nHeight, fFull});
+	if (!threadSnapshot.joinable())
+		threadSnapshot = std::thread(&TraceThread<void (*)()>, "appcache", &ThreadAppCacheSnapshot);
+	condSnapshot.notify_one();
+}
+
+void StopAppCacheSnapshotWriter()
+{
+	{
+		std::unique_lock<std::mutex> lock(csSnapshot);
+		fSnapshotStopping = true;
+	}
+	condSnapshot.notify_all();
+	if (threadSnapshot.joinable())
+		threadSnapshot.join();
+	// fSnapshotStopping stays set: a writer started after this would never be joined
+}
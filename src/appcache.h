@@ -0,0 +1,117 @@
+// Copyright (c) 2014-2019 The Dash Core Developers, The DAC Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_APPCACHE_H
+#define BITCOIN_APPCACHE_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/thread/shared_mutex.hpp>
+
+/** A cached value and the time it was written */
+typedef std::pair<std::string, int64_t> CAppCacheEntry;
+
+/** One entry with its section and key, as stored in a snapshot */
+struct CAppCacheRecord
+{
+	std::string sSection;
+	std::string sKey;
+	CAppCacheEntry entry;
+	// Journal records only: the key was erased, entry is empty
+	bool fErased;
+};
+
+/**
+ * The application cache (sporks, prayers, CPKs, DWS/DASH burns, coin-age votes, ...), stored as one key map per section.
+ * Section names are interned into a directory once; every section has its own readers-writer lock, so readers never
+ * block each other and a writer only blocks readers of the same section.  Keys are iterated in order within a section
+ * and sections are visited in name order, which matches the order of the original (section, key) map.
+ * Callers are responsible for normalizing the case of sections and keys.
+ */
+class CApplicationCache
+{
+public:
+	CApplicationCache() : fJournal(false), fJournalOverflow(false) {}
+	CApplicationCache(const CApplicationCache&) = delete;
+	CApplicationCache& operator=(const CApplicationCache&) = delete;
+
+	/** Returns an empty value with a zero timestamp if the entry does not exist */
+	CAppCacheEntry Read(const std::string& sSection, const std::string& sKey) const;
+	void Write(const std::string& sSection, const std::string& sKey, const std::string& sValue, int64_t nTimestamp);
+	/** Remove the key altogether, so it reads and iterates as if it had never been written */
+	void Erase(const std::string& sSection, const std::string& sKey);
+	/** Blank every value in the section (the keys are kept, as they always were) */
+	void ClearSection(const std::string& sSection);
+
+	/** Copy of one section's entries in key order */
+	std::vector<std::pair<std::string, CAppCacheEntry>> GetSection(const std::string& sSection) const;
+	/** Number of keys in one section (cleared values included) */
+	size_t GetSectionSize(const std::string& sSection) const;
+	/** Names of the sections that contain sPattern (all sections if empty), in name order */
+	std::vector<std::string> GetSectionNames(const std::string& sPattern = std::string()) const;
+
+	size_t GetSectionCount() const;
+	size_t Size() const;
+
+	/** Every entry, sections in name order and keys in order within a section */
+	std::vector<CAppCacheRecord> GetAll() const;
+	/** Start remembering which entries are written so they can be appended to a snapshot */
+	void StartJournal();
+	bool IsJournaling() const;
+	/** Current values of the entries written or erased since the previous call (or since StartJournal); erased keys have fErased set */
+	std::vector<CAppCacheRecord> TakeJournal();
+	/** More than MAX_APPCACHE_JOURNAL keys were written since StartJournal was last called: the journal is incomplete,
+	 *  and only a full snapshot (followed by StartJournal) brings the file up to date again */
+	bool IsJournalOverflowed() const;
+
+private:
+	struct Section
+	{
+		mutable boost::shared_mutex cs;
+		std::map<std::string, CAppCacheEntry> mapEntries;
+	};
+
+	Section* FindSection(const std::string& sSection) const;
+	Section* FindOrCreateSection(const std::string& sSection);
+	void AddToJournal(const std::string& sSection, const std::string& sKey);
+
+	// Guards the section directory only; sections are never removed, so a Section* stays valid once handed out
+	mutable boost::shared_mutex csSections;
+	std::map<std::string, int> mapSectionIds;
+	std::vector<std::unique_ptr<Section>> vSections;
+
+	mutable std::mutex csJournal;
+	std::atomic<bool> fJournal;
+	// Distinct section/key pairs written or erased since the last TakeJournal
+	std::set<std::pair<std::string, std::string>> setJournal;
+	bool fJournalOverflow;
+};
+
+/**
+ * Binary application cache snapshots.
+ * A snapshot file starts with a magic and version, followed by chunks of records: a full dump of the cache, then one
+ * chunk appended per block until the next full dump replaces the file.  Every chunk carries the height it was taken
+ * at and a checksum; a torn or corrupt chunk at the tail is dropped on load.  An appended record can erase its key.
+ */
+static const uint32_t APPCACHE_SNAPSHOT_VERSION = 2;
+/** Keys the journal holds between two TakeJournal calls before it gives up (see IsJournalOverflowed) */
+static const size_t MAX_APPCACHE_JOURNAL = 100000;
+
+/** Apply every valid chunk in sPath to the cache.  Returns the height of the last chunk, or -1 if there is no usable snapshot */
+int LoadAppCacheSnapshot(const std::string& sPath, CApplicationCache& cache, int& nRecords);
+/** Queue a write on the background snapshot thread: fFull replaces the file with vRecords, otherwise they are appended as one chunk */
+void QueueAppCacheSnapshot(const std::string& sPath, std::vector<CAppCacheRecord>&& vRecords, int nHeight, bool fFull);
+/** Finish the queued snapshot writes and join the snapshot thread; later writes are ignored */
+void StopAppCacheSnapshotWriter();
+
+#endif // BITCOIN_APPCACHE_H
@@ -4,132 +4,606 @@
 
 #include "bbpsocket.h"
 
-#include <boost/asio/connect.hpp>
-#include <boost/asio/deadline_timer.hpp>
-#include <boost/asio/io_service.hpp>
-#include <boost/asio/ip/tcp.hpp>
-#include <boost/asio/read_until.hpp>
-#include <boost/asio/streambuf.hpp>
-#include <boost/system/system_error.hpp>
-#include <boost/asio/write.hpp>
-#include <cstdlib>
-#include <iostream>
-#include <string>
-#include <boost/lambda/bind.hpp>
-#include <boost/lambda/lambda.hpp>
-
-using boost::asio::deadline_timer;
-using boost::asio::ip::tcp;
-using boost::lambda::bind;
-using boost::lambda::var;
-using boost::lambda::_1;
+#include "compat.h"
+#include "netbase.h"
+#include "sync.h"
+#include "utiltime.h"
 
-//----------------------------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+#include <boost/algorithm/string.hpp>
+
+#include <openssl/ssl.h>
+
+// Idle keep-alive connections kept per host, and how long one may sit idle before it is dropped
+static const size_t DAC_HTTP_MAX_IDLE_PER_HOST = 4;
+static const int64_t DAC_HTTP_IDLE_TIMEOUT = 30;
+// Requests waiting for the worker threads
+static const size_t DAC_HTTP_QUEUE_SIZE = 64;
+static const int DAC_HTTP_WORKERS = 4;
+static const size_t DAC_HTTP_MAX_RESPONSE = 20000000;
+static const size_t DAC_HTTP_MAX_FILE = 300000000;
+
+class DACHttpConnection
+{
+public:
+	SOCKET hSocket;
+	SSL* ssl;
+	int64_t nLastUsed;
+
+	DACHttpConnection() : hSocket(INVALID_SOCKET), ssl(nullptr), nLastUsed(0) {}
+
+	int Send(const char* pch, int nLen)
+	{
+		if (ssl)
+			return SSL_write(ssl, pch, nLen);
+		return send(hSocket, pch, nLen, MSG_NOSIGNAL);
+	}
+
+	int Recv(char* pch, int nLen)
+	{
+		if (ssl)
+			return SSL_read(ssl, pch, nLen);
+		return recv(hSocket, pch, nLen, 0);
+	}
+
+	// A clean close keeps the TLS session resumable; after an error the session is discarded with the connection
+	void Close(bool fClean)
+	{
+		if (ssl)
+		{
+			if (fClean)
+				SSL_set_shutdown(ssl, SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+			SSL_free(ssl);
+			ssl = nullptr;
+		}
+		if (hSocket != INVALID_SOCKET)
+			CloseSocket(hSocket);
+	}
+};
+
+static CCriticalSection cs_dachttp;
+static SSL_CTX* pDACHttpContext = nullptr;
+static std::map<std::string, std::deque<DACHttpConnection>> mapDACHttpIdle;
+static std::map<std::string, SSL_SESSION*> mapDACHttpSessions;
+static std::atomic<bool> fDACHttpInterrupt(false);
+
+static SSL_CTX* GetDACHttpContext()
+{
+	AssertLockHeld(cs_dachttp);
+	if (!pDACHttpContext)
+	{
+		SSL_library_init();
+		pDACHttpContext = SSL_CTX_new(SSLv23_client_method());
+		if (pDACHttpContext)
+		{
+			SSL_CTX_set_session_cache_mode(pDACHttpContext, SSL_SESS_CACHE_CLIENT);
+			SSL_CTX_set_mode(pDACHttpContext, SSL_MODE_AUTO_RETRY);
+		}
+	}
+	return pDACHttpContext;
+}
+
+static void SetSocketTimeout(SOCKET hSocket, int iTimeoutSecs)
+{
+#ifdef WIN32
+	DWORD nTimeout = iTimeoutSecs * 1000;
+	setsockopt(hSocket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&nTimeout, sizeof(nTimeout));
+	setsockopt(hSocket, SOL_SOCKET, SO_SNDTIMEO, (const char*)&nTimeout, sizeof(nTimeout));
+#else
+	struct timeval timeout = MillisToTimeval(iTimeoutSecs * 1000);
+	setsockopt(hSocket, SOL_SOCKET, SO_RCVTIMEO, (void*)&timeout, sizeof(timeout));
+	setsockopt(hSocket, SOL_SOCKET, SO_SNDTIMEO, (void*)&timeout, sizeof(timeout));
+#endif
+}
+
+// Waits up to nMillis for the connection to become readable: 1 if readable, 0 on timeout, -1 on error
+static int WaitReadable(const DACHttpConnection& conn, int64_t nMillis)
+{
+	if (conn.ssl && SSL_pending(conn.ssl) > 0)
+		return 1;
+	fd_set fdset;
+	FD_ZERO(&fdset);
+	FD_SET(conn.hSocket, &fdset);
+	struct timeval timeout = MillisToTimeval(nMillis);
+	int nRet = select(conn.hSocket + 1, &fdset, nullptr, nullptr, &timeout);
+	return nRet == SOCKET_ERROR ? -1 : (nRet > 0 ? 1 : 0);
+}
+
+static void RememberSession(const std::string& sKey, SSL* ssl)
+{
+	SSL_SESSION* pSession = SSL_get1_session(ssl);
+	if (!pSession)
+		return;
+	LOCK(cs_dachttp);
+	SSL_SESSION*& pStored = mapDACHttpSessions[sKey];
+	if (pStored)
+		SSL_SESSION_free(pStored);
+	pStored = pSession;
+}
+
+static bool TakeIdleConnection(const std::string& sKey, DACHttpConnection& conn)
+{
+	int64_t nNow = GetTime();
+	LOCK(cs_dachttp);
+	auto it = mapDACHttpIdle.find(sKey);
+	if (it == mapDACHttpIdle.end())
+		return false;
+	while (!it->second.empty())
+	{
+		conn = it->second.back();
+		it->second.pop_back();
+		// Anything readable on an idle connection means the server closed it (or sent something we did not ask for)
+		if (nNow - conn.nLastUsed <= DAC_HTTP_IDLE_TIMEOUT && WaitReadable(conn, 0) == 0)
+			return true;
+		conn.Close(true);
+	}
+	return false;
+}
+
+static void ReturnIdleConnection(const std::string& sKey, DACHttpConnection& conn)
+{
+	conn.nLastUsed = GetTime();
+	LOCK(cs_dachttp);
+	std::deque<DACHttpConnection>& dqIdle = mapDACHttpIdle[sKey];
+	if (dqIdle.size() >= DAC_HTTP_MAX_IDLE_PER_HOST)
+	{
+		dqIdle.front().Close(true);
+		dqIdle.pop_front();
+	}
+	dqIdle.push_back(conn);
+}
 
-//
-// This class manages socket timeouts by subclassing a deadline timer.
-// Each asynchronous operation is given a deadline by which it must complete.
-// Deadlines are enforced by the check_deadline actor that persists for the lifetime of the socket object:
-//
-//  +----------------+
-//  |                |     
-//  | check_deadline |<---+
-//  |                |    |
-//  +----------------+    | async_wait()
-//              |         |
-//              +---------+
-//
-// If the actor determines that the deadline has expired, the socket is closed
-// and any outstanding operations are consequently cancelled. The socket
-// operations themselves use boost::lambda function objects as completion
-// handlers. For a given socket operation, the socket object runs the
-// io_service to block thread execution until the actor completes.
-//
-// Written by Christopher M. Kohlhoff (Chris@Kohlhoff.com) and the DAC developers
-
-
-class bbpsocket
+static bool OpenConnection(const DACHttpRequest& request, const std::string& sKey, DACHttpConnection& conn, std::string& sError)
+{
+	sError = "Failed connection to " + request.sHost + ":" + std::to_string(request.iPort);
+	CService addr;
+	if (HaveNameProxy())
+	{
+		// Let the proxy resolve the host (-proxy / -onion), as for peers added by name
+		if (!ConnectSocketByName(addr, conn.hSocket, request.sHost.c_str(), request.iPort, request.iTimeoutSecs * 1000))
+			return false;
+	}
+	else
+	{
+		if (!Lookup(request.sHost.c_str(), addr, request.iPort, true))
+			return false;
+		if (!ConnectSocket(addr, conn.hSocket, request.iTimeoutSecs * 1000))
+			return false;
+	}
+	if (!SetSocketNonBlocking(conn.hSocket, false))
+	{
+		conn.Close(false);
+		return false;
+	}
+	SetSocketTimeout(conn.hSocket, request.iTimeoutSecs);
+	if (!request.fSSL)
+		return true;
+
+	{
+		LOCK(cs_dachttp);
+		SSL_CTX* ctx = GetDACHttpContext();
+		if (ctx == nullptr)
+		{
+			sError = "CTX_IS_NULL";
+			conn.Close(false);
+			return false;
+		}
+		conn.ssl = SSL_new(ctx);
+		auto it = mapDACHttpSessions.find(sKey);
+		if (conn.ssl && it != mapDACHttpSessions.end())
+			SSL_set_session(conn.ssl, it->second);
+	}
+	if (!conn.ssl)
+	{
+		conn.Close(false);
+		return false;
+	}
+	// Compatibility with strict d-dos prevention rules (like cloudflare)
+	SSL_set_tlsext_host_name(conn.ssl, const_cast<char *>(request.sHost.c_str()));
+	SSL_set_fd(conn.ssl, (int)conn.hSocket);
+	if (SSL_connect(conn.ssl) != 1)
+	{
+		conn.Close(false);
+		return false;
+	}
+	return true;
+}
+
+/** Buffered line and block reads from one connection, bounded by a deadline */
+class DACHttpReader
 {
 public:
-  bbpsocket() : socket_(io_service_), deadline_(io_service_)
-  {
-    deadline_.expires_at(boost::posix_time::pos_infin);
-    check_deadline();
-  }
-
-  void connect(const std::string& host, const std::string& service,
-      boost::posix_time::time_duration timeout)
-  {
-    tcp::resolver::query query(host, service);
-    tcp::resolver::iterator iter = tcp::resolver(io_service_).resolve(query);
-
-    // Set a deadline for the asynchronous operation. 
-    deadline_.expires_from_now(timeout);
-    boost::system::error_code ec = boost::asio::error::would_block;
-
-    // Start the asynchronous operation itself. The boost::lambda function
-    // object is used as a callback and will update the ec when the operation completes. 
-    boost::asio::async_connect(socket_, iter, var(ec) = boost::lambda::_1);
-
-    // Block until the asynchronous operation has completed.
-    do io_service_.run_one(); while (ec == boost::asio::error::would_block);
-    if (ec || !socket_.is_open())
-      throw boost::system::system_error(
-          ec ? ec : boost::asio::error::operation_aborted);
-  }
-
-  std::string read_line(boost::posix_time::time_duration timeout)
-  {
-    // Set a deadline
-    deadline_.expires_from_now(timeout);
-    boost::system::error_code ec = boost::asio::error::would_block;
-    boost::asio::async_read_until(socket_, input_buffer_, '\n', var(ec) = boost::lambda::_1);
-    // Block until the asynchronous operation has completed.
-    do io_service_.run_one(); while (ec == boost::asio::error::would_block);
-
-    if (ec)
-      throw boost::system::system_error(ec);
-
-    std::string line;
-    std::istream is(&input_buffer_);
-    std::getline(is, line);
-    return line;
-  }
-
-  void write_line(const std::string& line,
-      boost::posix_time::time_duration timeout)
-  {
-    std::string data = line + "\n";
-    // Set a deadline
-    deadline_.expires_from_now(timeout);
-    boost::system::error_code ec = boost::asio::error::would_block;
-    boost::asio::async_write(socket_, boost::asio::buffer(data), var(ec) = boost::lambda::_1);
-    // Block until the asynchronous operation has completed.
-    do io_service_.run_one(); while (ec == boost::asio::error::would_block);
-    if (ec)
-      throw boost::system::system_error(ec);
-  }
+	size_t nReceived;
+
+	DACHttpReader(DACHttpConnection& connIn, int64_t nDeadlineIn) : nReceived(0), conn(connIn), nDeadline(nDeadlineIn), nPos(0) {}
+
+	bool ReadLine(std::string& sLine)
+	{
+		while (true)
+		{
+			size_t nEnd = sBuffer.find('\n', nPos);
+			if (nEnd != std::string::npos)
+			{
+				sLine.assign(sBuffer, nPos, nEnd - nPos);
+				if (!sLine.empty() && sLine.back() == '\r')
+					sLine.pop_back();
+				nPos = nEnd + 1;
+				return true;
+			}
+			if (sBuffer.size() - nPos > 65536 || !Fill())
+				return false;
+		}
+	}
+
+	/** Up to nMax bytes, at least one unless the connection failed */
+	bool Read(size_t nMax, const char*& pch, size_t& nLen)
+	{
+		if (nPos == sBuffer.size() && !Fill())
+			return false;
+		pch = sBuffer.data() + nPos;
+		nLen = std::min(nMax, sBuffer.size() - nPos);
+		nPos += nLen;
+		return true;
+	}
+
+	bool HasBuffered() const
+	{
+		return nPos < sBuffer.size();
+	}
 
 private:
-  void check_deadline()
-  {
-    if (deadline_.expires_at() <= deadline_timer::traits_type::now())
-    {
-      // The deadline has passed. 
-      boost::system::error_code ignored_ec;
-      socket_.close(ignored_ec);
-      deadline_.expires_at(boost::posix_time::pos_infin);
-    }
-    // Put the actor back to sleep.
-    deadline_.async_wait(bind(&bbpsocket::check_deadline, this));
-  }
-
-  boost::asio::io_service io_service_;
-  tcp::socket socket_;
-  deadline_timer deadline_;
-  boost::asio::streambuf input_buffer_;
+	DACHttpConnection& conn;
+	int64_t nDeadline;
+	std::string sBuffer;
+	size_t nPos;
+
+	bool Fill()
+	{
+		sBuffer.erase(0, nPos);
+		nPos = 0;
+		while (true)
+		{
+			if (fDACHttpInterrupt || GetTimeMillis() > nDeadline)
+				return false;
+			// Wait in short slices so shutdown does not have to sit out a long upload timeout
+			int nReady = WaitReadable(conn, std::min((int64_t)1000, nDeadline - GetTimeMillis()));
+			if (nReady < 0)
+				return false;
+			if (nReady == 0)
+				continue;
+			char buf[16384];
+			int nRead = conn.Recv(buf, sizeof(buf));
+			if (nRead <= 0)
+				return false;
+			sBuffer.append(buf, nRead);
+			nReceived += nRead;
+			return true;
+		}
+	}
 };
 
+/**
+ * Sends the request and reads one response.  fKeepAlive is set when the connection can carry another request, and
+ * fNothingReceived when the server never answered (a pooled connection that was closed while idle).
+ */
+static bool ExecuteOnConnection(const DACHttpRequest& request, const std::string& sRequest, DACHttpConnection& conn, DACHttpResponse& response, bool& fKeepAlive, bool& fNothingReceived)
+{
+	fKeepAlive = false;
+	fNothingReceived = true;
+	size_t nSent = 0;
+	while (nSent < sRequest.size())
+	{
+		int nChunk = (int)std::min(sRequest.size() - nSent, (size_t)1048576);
+		int nRet = conn.Send(sRequest.data() + nSent, nChunk);
+		if (nRet <= 0)
+		{
+			response.sError = "FAILED_HTTPS_POST";
+			return false;
+		}
+		nSent += nRet;
+	}
+
+	DACHttpReader reader(conn, GetTimeMillis() + request.iTimeoutSecs * 1000);
+	std::string sLine;
+	bool fHttp11 = false;
+	bool fChunked = false;
+	bool fClose = false;
+	bool fKeepAliveHeader = false;
+	int64_t nContentLength = -1;
+	do
+	{
+		if (!reader.ReadLine(sLine))
+		{
+			fNothingReceived = reader.nReceived == 0;
+			response.sError = "NO_RESPONSE";
+			return false;
+		}
+		if (sLine.size() < 12 || sLine.compare(0, 5, "HTTP/") != 0)
+		{
+			response.sError = "BAD_RESPONSE";
+			return false;
+		}
+		fHttp11 = sLine.compare(0, 8, "HTTP/1.1") == 0;
+		response.nStatus = atoi(sLine.substr(9, 3));
+		response.sHeaders = sLine + "\r\n";
+		fChunked = fClose = fKeepAliveHeader = false;
+		nContentLength = -1;
+		while (true)
+		{
+			if (!reader.ReadLine(sLine))
+			{
+				response.sError = "BAD_RESPONSE";
+				return false;
+			}
+			response.sHeaders += sLine + "\r\n";
+			if (sLine.empty())
+				break;
+			size_t nColon = sLine.find(':');
+			if (nColon == std::string::npos)
+				continue;
+			std::string sName = boost::algorithm::to_lower_copy(boost::algorithm::trim_copy(sLine.substr(0, nColon)));
+			std::string sValue = boost::algorithm::to_lower_copy(boost::algorithm::trim_copy(sLine.substr(nColon + 1)));
+			if (sName == "content-length")
+				nContentLength = atoi64(sValue);
+			else if (sName == "transfer-encoding")
+				fChunked = sValue.find("chunked") != std::string::npos;
+			else if (sName == "connection")
+			{
+				fClose = sValue.find("close") != std::string::npos;
+				fKeepAliveHeader = sValue.find("keep-alive") != std::string::npos;
+			}
+		}
+	} while (response.nStatus >= 100 && response.nStatus < 200);
+
+	std::ofstream OutFile;
+	if (!request.sTargetFileName.empty())
+	{
+		OutFile.open(request.sTargetFileName, std::ios::out | std::ios::binary);
+		if (!OutFile.is_open())
+		{
+			response.sError = "FILE_OPEN_FAILED";
+			return false;
+		}
+	}
+	size_t nMaxSize = request.sTargetFileName.empty() ? DAC_HTTP_MAX_RESPONSE : DAC_HTTP_MAX_FILE;
+	size_t nBodySize = 0;
+	auto ReadBody = [&](size_t nLength) -> bool {
+		while (nLength > 0)
+		{
+			const char* pch;
+			size_t nLen;
+			if (!reader.Read(nLength, pch, nLen))
+			{
+				response.sError = "INCOMPLETE_RESPONSE";
+				return false;
+			}
+			nBodySize += nLen;
+			if (nBodySize > nMaxSize)
+			{
+				response.sError = "RESPONSE_TOO_LARGE";
+				return false;
+			}
+			if (OutFile.is_open())
+				OutFile.write(pch, nLen);
+			else
+				response.sBody.append(pch, nLen);
+			nLength -= nLen;
+		}
+		return true;
+	};
+
+	bool fFramed = true;
+	if (response.nStatus == 204 || response.nStatus == 304)
+	{
+		// No body
+	}
+	else if (fChunked)
+	{
+		while (true)
+		{
+			if (!reader.ReadLine(sLine))
+			{
+				response.sError = "INCOMPLETE_RESPONSE";
+				return false;
+			}
+			size_t nChunkSize = strtoul(sLine.c_str(), nullptr, 16);
+			if (nChunkSize == 0)
+				break;
+			if (!ReadBody(nChunkSize))
+				return false;
+			if (!reader.ReadLine(sLine))
+			{
+				response.sError = "INCOMPLETE_RESPONSE";
+				return false;
+			}
+		}
+		// Trailer headers end with an empty line
+		do
+		{
+			if (!reader.ReadLine(sLine))
+			{
+				response.sError = "INCOMPLETE_RESPONSE";
+				return false;
+			}
+		} while (!sLine.empty());
+	}
+	else if (nContentLength >= 0)
+	{
+		if (!ReadBody(nContentLength))
+			return false;
+	}
+	else
+	{
+		// Legacy servers frame the response by closing the connection, or by one of the terminators the callers know about
+		fFramed = false;
+		const char* pch;
+		size_t nLen;
+		while (reader.Read(nMaxSize, pch, nLen))
+		{
+			nBodySize += nLen;
+			if (nBodySize > nMaxSize)
+				break;
+			if (OutFile.is_open())
+				OutFile.write(pch, nLen);
+			else
+			{
+				response.sBody.append(pch, nLen);
+				if (TermPeekFound(response.sBody, request.iBOE))
+					break;
+			}
+		}
+	}
+
+	fKeepAlive = fFramed && !reader.HasBuffered() && (fHttp11 ? !fClose : fKeepAliveHeader);
+	return true;
+}
+
+bool DACHttpExecute(const DACHttpRequest& request, DACHttpResponse& response)
+{
+	response = DACHttpResponse();
+	if (fDACHttpInterrupt)
+	{
+		response.sError = "SHUTDOWN";
+		return false;
+	}
+	if (request.sHost.empty())
+	{
+		response.sError = "DOMAIN_MISSING";
+		return false;
+	}
+	std::string sKey = std::string(request.fSSL ? "https://" : "http://") + request.sHost + ":" + std::to_string(request.iPort);
+	std::string sRequest = PrepareHTTPPost(request.fPost, request.sPage, request.sHost, request.sPayload, request.mapRequestHeaders);
+	for (int nAttempt = 0; nAttempt < 2; nAttempt++)
+	{
+		DACHttpConnection conn;
+		bool fReused = nAttempt == 0 && TakeIdleConnection(sKey, conn);
+		if (fReused)
+			SetSocketTimeout(conn.hSocket, request.iTimeoutSecs);
+		else if (!OpenConnection(request, sKey, conn, response.sError))
+			return false;
+		response.sError.clear();
+
+		bool fKeepAlive = false;
+		bool fNothingReceived = false;
+		bool fOk = ExecuteOnConnection(request, sRequest, conn, response, fKeepAlive, fNothingReceived);
+		if (fOk && conn.ssl)
+			RememberSession(sKey, conn.ssl);
+		if (fOk && fKeepAlive)
+			ReturnIdleConnection(sKey, conn);
+		else
+			conn.Close(fOk);
+		// The server may close a pooled connection while it sits idle; the request never reached it, so use a fresh one
+		if (!fOk && fReused && fNothingReceived)
+		{
+			response = DACHttpResponse();
+			continue;
+		}
+		return fOk;
+	}
+	return false;
+}
+
+struct DACHttpJob
+{
+	DACHttpRequest request;
+	std::promise<DACHttpResponse> promise;
+};
+
+static std::mutex csDACHttpQueue;
+static std::condition_variable condDACHttpQueue;
+static std::deque<DACHttpJob> dqDACHttpJobs;
+static std::vector<std::thread> vDACHttpWorkers;
+static bool fDACHttpStopping = false;
+
+static void ThreadDACHttpWorker()
+{
+	while (true)
+	{
+		DACHttpJob job;
+		{
+			std::unique_lock<std::mutex> lock(csDACHttpQueue);
+			condDACHttpQueue.wait(lock, [] { return fDACHttpStopping || !dqDACHttpJobs.empty(); });
+			if (fDACHttpStopping)
+				return;
+			job = std::move(dqDACHttpJobs.front());
+			dqDACHttpJobs.pop_front();
+		}
+		DACHttpResponse response;
+		DACHttpExecute(job.request, response);
+		job.promise.set_value(response);
+	}
+}
+
+std::future<DACHttpResponse> DACHttpQueue(const DACHttpRequest& request)
+{
+	DACHttpJob job;
+	job.request = request;
+	std::future<DACHttpResponse> future = job.promise.get_future();
+	std::unique_lock<std::mutex> lock(csDACHttpQueue);
+	if (fDACHttpStopping || dqDACHttpJobs.size() >= DAC_HTTP_QUEUE_SIZE)
+	{
+		DACHttpResponse response;
+		response.sError = fDACHttpStopping ? "SHUTDOWN" : "QUEUE_FULL";
+		job.promise.set_value(response);
+		return future;
+	}
+	dqDACHttpJobs.push_back(std::move(job));
+	if (vDACHttpWorkers.empty())
+	{
+		for (int i = 0; i < DAC_HTTP_WORKERS; i++)
+			vDACHttpWorkers.emplace_back(&TraceThread<void (*)()>, "sidechain", &ThreadDACHttpWorker);
+	}
+	condDACHttpQueue.notify_one();
+	return future;
+}
+
+void StopDACHttpClient()
+{
+	{
+		std::unique_lock<std::mutex> lock(csDACHttpQueue);
+		fDACHttpStopping = true;
+	}
+	fDACHttpInterrupt = true;
+	condDACHttpQueue.notify_all();
+	for (auto& thread : vDACHttpWorkers)
+		thread.join();
+	vDACHttpWorkers.clear();
+	{
+		std::unique_lock<std::mutex> lock(csDACHttpQueue);
+		for (auto& job : dqDACHttpJobs)
+		{
+			DACHttpResponse response;
+			response.sError = "SHUTDOWN";
+			job.promise.set_value(response);
+		}
+		dqDACHttpJobs.clear();
+	}
+	// Both flags stay set: requests made after shutdown fail with SHUTDOWN instead of starting workers nobody joins
+
+	LOCK(cs_dachttp);
+	for (auto& item : mapDACHttpIdle)
+	{
+		for (auto& conn : item.second)
+			conn.Close(true);
+	}
+	mapDACHttpIdle.clear();
+	for (auto& item : mapDACHttpSessions)
+		SSL_SESSION_free(item.second);
+	mapDACHttpSessions.clear();
+	if (pDACHttpContext)
+	{
+		SSL_CTX_free(pDACHttpContext);
+		pDACHttpContext = nullptr;
+	}
+}
+
 //----------------------------------------------------------------------
 
 std::string sPrepareVersion()
@@ -149,7 +623,7 @@ std::string sPrepareVersion()
 std::string PrepareHTTPPost(bool bPost, std::string sPage, std::string sHostHeader, const std::string& sMsg, const std::map<std::string,std::string>& mapRequestHeaders)
 {
 	std::ostringstream s;
-	std::string sUserAgent = "Mozilla/5.0";
+	std::string sUserAgent = "Mozilla/5.0 (Macintosh; Intel Mac OS X 10_11_2) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/47.0.2526.80 Safari/537.36";
 	std::string sMethod = bPost ? "POST" : "GET";
 
 	s << sMethod + " /" + sPage + " HTTP/1.1\r\n"
@@ -159,39 +633,25 @@ std::string PrepareHTTPPost(bool bPost, std::string sPage, std::string sHostHead
 
 	for (auto item : mapRequestHeaders) 
 	{
-        s << item.first << ": " << item.second << "\r\n";
+		s << item.first << ": " << item.second << "\r\n";
 	}
-    s << "\r\n" << sMsg;
-    return s.str();
+	s << "\r\n" << sMsg;
+	return s.str();
 }
 
 std::string DACPost(std::string sHost, std::string sService, std::string sPage, std::string sPayload, int iTimeout)
 {
-	std::string sData;
-	try
-	{
-		bbpsocket c;
-		c.connect(sHost, sService, boost::posix_time::seconds(iTimeout));
-		boost::posix_time::ptime time_sent = boost::posix_time::microsec_clock::universal_time();
-		std::map<std::string, std::string> mapRequestHeaders;
-		mapRequestHeaders["Agent"] = FormatFullVersion();
-		std::string sPost = PrepareHTTPPost(true, sPage, sHost, sPayload, mapRequestHeaders);
-		c.write_line(sPost, boost::posix_time::seconds(iTimeout));
-		for (;;)
-		{
-		  std::string line = c.read_line(boost::posix_time::seconds(iTimeout));
-  		  sData += line;
-	  	  if (Contains(line, "</html>") || Contains(line,"<eof>") || Contains(line,"<END>"))
-			  break;
-		}
-  }
-  catch (std::exception& e)
-  {
-      std::string sErr = std::string("DACPostException::") + e.what();
-	  return sErr;
-  }
-  return sData;
+	DACHttpRequest request;
+	request.fPost = true;
+	request.fSSL = false;
+	request.sHost = sHost;
+	request.iPort = sService == "http" ? 80 : atoi(sService);
+	request.sPage = sPage;
+	request.sPayload = sPayload;
+	request.mapRequestHeaders["Agent"] = FormatFullVersion();
+	request.iTimeoutSecs = iTimeout;
+	DACHttpResponse response;
+	if (!DACHttpExecute(request, response) && response.sHeaders.empty())
+		return "DACPostException::" + response.sError;
+	return response.sHeaders + response.sBody;
 }
-
-	
-    
\ No newline at end of file
@@ -12,6 +12,47 @@
 #include "netmessagemaker.h"
 #include "activemasternode.h"
 
+#include <future>
+#include <map>
+#include <string>
+
+/** One HTTP/1.1 request to a sidechain host (Uplink, DSQL, BIPFS, DACPost) */
+struct DACHttpRequest
+{
+	bool fPost = false;
+	bool fSSL = true;
+	std::string sHost;
+	int iPort = 443;
+	std::string sPage;
+	std::string sPayload;
+	std::map<std::string, std::string> mapRequestHeaders;
+	int iTimeoutSecs = 30;
+	// Legacy terminator (see TermPeekFound), only consulted for responses without Content-Length or chunked framing
+	int iBOE = 0;
+	// When set, the body is streamed to this file instead of being returned
+	std::string sTargetFileName;
+};
+
+struct DACHttpResponse
+{
+	int nStatus = 0;
+	// Status line and headers, including the blank line that ends them
+	std::string sHeaders;
+	std::string sBody;
+	// Empty on success; otherwise the response may be partial
+	std::string sError;
+};
+
+/**
+ * Connections are kept alive in a small per-host pool and TLS sessions are resumed, so repeated sidechain calls
+ * skip the TCP and TLS handshakes.  Responses are framed by Content-Length or chunked encoding.
+ */
+bool DACHttpExecute(const DACHttpRequest& request, DACHttpResponse& response);
+/** Run the request on the sidechain worker threads.  The queue is bounded; a full queue fails the request immediately */
+std::future<DACHttpResponse> DACHttpQueue(const DACHttpRequest& request);
+/** Fail the queued requests, join the workers and close the pooled connections.  Later requests fail with SHUTDOWN */
+void StopDACHttpClient();
+
 std::string DACPost(std::string sHost, std::string sService, std::string sPage, std::string sPayload, int iTimeout);
 std::string PrepareHTTPPost(bool bPost, std::string sPage, std::string sHostHeader, const std::string& sMsg, const std::map<std::string,std::string>& mapRequestHeaders);
 
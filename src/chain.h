@@ -292,7 +292,7 @@ public:
         block.nBits          = nBits;
         block.nNonce         = nNonce;
 		block.RandomXKey     = RandomXKey;
-		block.RandomXData    = RandomXData;
+		block.SetRandomXData(RandomXData);
 
         return block;
     }
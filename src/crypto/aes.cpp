@@ -215,3 +215,27 @@ int AES128CBCDecrypt::Decrypt(const unsigned char* data, int size, unsigned char
 {
     return CBCDecrypt(dec, iv, data, size, pad, out);
 }
+
+AES256CTR::AES256CTR(const unsigned char key[AES256_KEYSIZE], const unsigned char ivIn[AES_BLOCKSIZE])
+    : enc(key), used(AES_BLOCKSIZE)
+{
+    memcpy(counter, ivIn, AES_BLOCKSIZE);
+}
+
+AES256CTR::~AES256CTR()
+{
+    memset(counter, 0, AES_BLOCKSIZE);
+    memset(keystream, 0, AES_BLOCKSIZE);
+}
+
+void AES256CTR::Crypt(const unsigned char* data, size_t size, unsigned char* out)
+{
+    for (size_t i = 0; i < size; i++) {
+        if (used == AES_BLOCKSIZE) {
+            enc.Encrypt(keystream, counter);
+            for (int j = AES_BLOCKSIZE - 1; j >= 0 && ++counter[j] == 0; j--) {}
+            used = 0;
+        }
+        out[i] = data[i] ^ keystream[used++];
+    }
+}
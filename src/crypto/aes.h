@@ -115,4 +115,23 @@ private:
     unsigned char iv[AES_BLOCKSIZE];
 };
 
+/**
+ * AES-256 in counter mode (NIST SP 800-38A). The 16 byte counter block is
+ * incremented as a big-endian integer. Encryption and decryption are the
+ * same operation, and successive calls continue the key stream.
+ */
+class AES256CTR
+{
+public:
+    AES256CTR(const unsigned char key[AES256_KEYSIZE], const unsigned char ivIn[AES_BLOCKSIZE]);
+    ~AES256CTR();
+    void Crypt(const unsigned char* data, size_t size, unsigned char* out);
+
+private:
+    const AES256Encrypt enc;
+    unsigned char counter[AES_BLOCKSIZE];
+    unsigned char keystream[AES_BLOCKSIZE];
+    size_t used;
+};
+
 #endif // BITCOIN_CRYPTO_AES_H
@@ -7,6 +7,7 @@
 #include "governance-classes.h"
 #include "core_io.h"
 #include "init.h"
+#include "miner.h"
 #include "utilstrencodings.h"
 #include "validation.h"
 #include "rpcpog.h"
@@ -137,6 +138,7 @@ bool CGovernanceTriggerManager::AddNewTrigger(uint256 nHash)
 
     DBG(std::cout << "CGovernanceTriggerManager::AddNewTrigger: Inserting trigger" << std::endl;);
     mapTrigger.insert(std::make_pair(nHash, pSuperblock));
+    InvalidateBlockTemplateCache();
 
     DBG(std::cout << "CGovernanceTriggerManager::AddNewTrigger: End" << std::endl;);
 
@@ -224,6 +226,7 @@ void CGovernanceTriggerManager::CleanAndRemove()
             }
             // delete the trigger
             mapTrigger.erase(it++);
+            InvalidateBlockTemplateCache();
         } else {
             ++it;
         }
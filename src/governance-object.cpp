@@ -12,6 +12,7 @@
 #include "masternode-meta.h"
 #include "masternode-sync.h"
 #include "messagesigner.h"
+#include "miner.h"
 #include "spork.h"
 #include "util.h"
 #include "validation.h"
@@ -223,6 +224,9 @@ bool CGovernanceObject::ProcessVote(CNode* pfrom,
     voteInstanceRef = vote_instance_t(vote.GetOutcome(), nVoteTimeUpdate, vote.GetTimestamp(), vote.GetMultipleChoiceData());
     fileVotes.AddVote(vote);
     fDirtyCache = true;
+    // A vote can flip a trigger's funding, and with it the superblock payees of the next block template
+    if (nObjectType == GOVERNANCE_OBJECT_TRIGGER)
+        InvalidateBlockTemplateCache();
     return true;
 }
 
@@ -279,6 +283,8 @@ std::set<uint256> CGovernanceObject::RemoveInvalidVotes(const COutPoint& mnOutpo
         }
         LogPrintf("CGovernanceObject::%s -- Removed %d invalid votes for %s from MN %s:\n%s", __func__, removedVotes.size(), nParentHash.ToString(), mnOutpoint.ToString(), removedStr);
         fDirtyCache = true;
+        if (nObjectType == GOVERNANCE_OBJECT_TRIGGER)
+            InvalidateBlockTemplateCache();
     }
 
     return removedVotes;
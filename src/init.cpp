@@ -13,8 +13,10 @@
 #include "kjv.h"
 #include "addrman.h"
 #include "amount.h"
+#include "appcache.h"
 #include "miner.h"
 #include "base58.h"
+#include "bbpsocket.h"
 #include "chain.h"
 #include "rpcpog.h"
 #include "chainparams.h"
@@ -38,6 +40,7 @@
 #include "timedata.h"
 #include "txdb.h"
 #include "txmempool.h"
+#include "stratum.h"
 #include "torcontrol.h"
 #include "ui_interface.h"
 #include "util.h"
@@ -72,6 +75,7 @@
 #include "llmq/quorums_init.h"
 #include "llmq/quorums_init.h"
 #include "pose.h"
+#include "randomx_bbp.h"
 
 #include <stdint.h>
 #include <stdio.h>
@@ -214,6 +218,7 @@ void Interrupt(boost::thread_group& threadGroup)
     InterruptRPC();
     InterruptREST();
     InterruptTorControl();
+    InterruptStratumServer();
     llmq::InterruptLLMQSystem();
     if (g_connman)
         g_connman->Interrupt();
@@ -241,6 +246,7 @@ void PrepareShutdown()
 
     // DAC - Stop Miner Gracefully
     GenerateCoins(false, 0, Params());
+    StopStratumServer();
 
     StopHTTPServer();
     llmq::StopLLMQSystem();
@@ -267,6 +273,7 @@ void PrepareShutdown()
         g_connman->Stop();
     }
     g_connman.reset();
+    StopHeaderVerifyThreads();
 
     if (!fLiteMode && !fRPCInWarmup) {
         // STORE DATA CACHES INTO SERIALIZED DAT FILES
@@ -284,6 +291,10 @@ void PrepareShutdown()
         CFlatDB<CSporkManager> flatdb6("sporks.dat", "magicSporkCache");
         flatdb6.Dump(sporkManager);
     }
+    // Finish writing any queued prayer/application cache snapshot
+    StopAppCacheSnapshotWriter();
+    // Fail the queued sidechain requests and close the pooled connections
+    StopDACHttpClient();
 
     UnregisterNodeSignals(GetNodeSignals());
     if (fDumpMempoolLater)
@@ -379,6 +390,7 @@ void Shutdown()
     globalVerifyHandle.reset();
     ECC_Stop();
     LogPrintf("%s: done\n", __func__);
+    StopDebugLogWriter();
 }
 
 /**
@@ -427,6 +439,15 @@ void OnRPCPreCommand(const CRPCCommand& cmd)
         throw JSONRPCError(RPC_FORBIDDEN_BY_SAFE_MODE, std::string("Safe mode: ") + strWarning);
 }
 
+static std::string GetSupportedSocketEventsStr()
+{
+    std::string strSupportedModes = "'select'";
+#ifdef HAVE_SYS_EPOLL_H
+    strSupportedModes += ", 'epoll'";
+#endif
+    return strSupportedModes;
+}
+
 std::string HelpMessage(HelpMessageMode mode)
 {
     const bool showDebug = GetBoolArg("-help-debug", false);
@@ -458,6 +479,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-blockreconstructionextratxn=<n>", strprintf(_("Extra transactions to keep in memory for compact block reconstructions (default: %u)"), DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN));
     strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
+    strUsage += HelpMessageOpt("-randomxfastmode", strprintf(_("Use the full ~2GB RandomX dataset instead of light mode for the key being mined on and the current tip's key; other keys stay in light mode, so this uses up to about 4GB on top of the -randomxcachekeys caches (default: %u)"), DEFAULT_RANDOMX_FASTMODE));
+    strUsage += HelpMessageOpt("-randomxcachekeys=<n>", strprintf(_("Number of RandomX keys to keep cached in memory, each cache uses about 256MB (default: %u)"), DEFAULT_RANDOMX_CACHED_KEYS));
 #ifndef WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf(_("Specify pid file (default: %s)"), BITCOIN_PID_FILENAME));
 #endif
@@ -474,6 +497,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-addressindex", strprintf(_("Maintain a full address index, used to query for the balance, txids and unspent outputs for addresses (default: %u)"), DEFAULT_ADDRESSINDEX));
     strUsage += HelpMessageOpt("-timestampindex", strprintf(_("Maintain a timestamp index for block hashes, used to query blocks hashes by a range of timestamps (default: %u)"), DEFAULT_TIMESTAMPINDEX));
     strUsage += HelpMessageOpt("-spentindex", strprintf(_("Maintain a full spent index, used to query the spending txid and input index for an outpoint (default: %u)"), DEFAULT_SPENTINDEX));
+    strUsage += HelpMessageOpt("-messageindex", strprintf(_("Maintain an index of prayers, sporks, DWS/DASH burns and coin-age votes so they are not rebuilt from the chain at startup (default: %u)"), DEFAULT_MESSAGEINDEX));
 
     strUsage += HelpMessageGroup(_("Connection options:"));
     strUsage += HelpMessageOpt("-addnode=<ip>", _("Add a node to connect to and attempt to keep the connection open"));
@@ -501,6 +525,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-proxy=<ip:port>", _("Connect through SOCKS5 proxy"));
     strUsage += HelpMessageOpt("-proxyrandomize", strprintf(_("Randomize credentials for every proxy connection. This enables Tor stream isolation (default: %u)"), DEFAULT_PROXYRANDOMIZE));
     strUsage += HelpMessageOpt("-seednode=<ip>", _("Connect to a node to retrieve peer addresses, and disconnect"));
+    strUsage += HelpMessageOpt("-socketevents=<mode>", strprintf(_("Socket events mode, which must be one of: %s (default: %s)"), GetSupportedSocketEventsStr(), DEFAULT_SOCKETEVENTS));
     strUsage += HelpMessageOpt("-timeout=<n>", strprintf(_("Specify connection timeout in milliseconds (minimum: 1, default: %d)"), DEFAULT_CONNECT_TIMEOUT));
     strUsage += HelpMessageOpt("-torcontrol=<ip>:<port>", strprintf(_("Tor control port to use if onion listening enabled (default: %s)"), DEFAULT_TOR_CONTROL));
     strUsage += HelpMessageOpt("-torpassword=<pass>", _("Tor control port password (default: empty)"));
@@ -547,6 +572,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-checkblockindex", strprintf("Do a full consistency check for mapBlockIndex, setBlockIndexCandidates, chainActive and mapBlocksUnlinked occasionally. Also sets -checkmempool (default: %u)", Params(CBaseChainParams::MAIN).DefaultConsistencyChecks()));
         strUsage += HelpMessageOpt("-checkmempool=<n>", strprintf("Run checks every <n> transactions (default: %u)", Params(CBaseChainParams::MAIN).DefaultConsistencyChecks()));
         strUsage += HelpMessageOpt("-checkpoints", strprintf("Disable expensive verification for known chain history (default: %u)", DEFAULT_CHECKPOINTS_ENABLED));
+        strUsage += HelpMessageOpt("-checkpowondisk", strprintf("Recompute RandomX proof of work when loading the block index and reading blocks from disk instead of trusting the stored result (default: %u)", DEFAULT_CHECKPOWONDISK));
         strUsage += HelpMessageOpt("-disablesafemode", strprintf("Disable safemode, override a real safe mode event (default: %u)", DEFAULT_DISABLE_SAFEMODE));
         strUsage += HelpMessageOpt("-testsafemode", strprintf("Force safe mode (default: %u)", DEFAULT_TESTSAFEMODE));
         strUsage += HelpMessageOpt("-dropmessagestest=<n>", "Randomly drop 1 of every <n> network messages");
@@ -568,6 +594,7 @@ std::string HelpMessage(HelpMessageMode mode)
     if (showDebug)
         strUsage += HelpMessageOpt("-nodebug", "Turn off debugging messages, same as -debug=0");
     strUsage += HelpMessageOpt("-help-debug", _("Show all debugging options (usage: --help -help-debug)"));
+    strUsage += HelpMessageOpt("-logflushinterval=<n>", strprintf(_("Write buffered debug output to debug.log every <n> milliseconds, 0 to write every line immediately (default: %u)"), DEFAULT_LOGFLUSHINTERVAL));
     strUsage += HelpMessageOpt("-logips", strprintf(_("Include IP addresses in debug output (default: %u)"), DEFAULT_LOGIPS));
     strUsage += HelpMessageOpt("-logtimestamps", strprintf(_("Prepend debug output with timestamp (default: %u)"), DEFAULT_LOGTIMESTAMPS));
     if (showDebug)
@@ -631,6 +658,13 @@ std::string HelpMessage(HelpMessageMode mode)
     if (showDebug)
         strUsage += HelpMessageOpt("-blockversion=<n>", "Override block version to test forking scenarios");
 
+    strUsage += HelpMessageGroup(_("Stratum server options:"));
+    strUsage += HelpMessageOpt("-stratumport=<port>", strprintf(_("Serve RandomX mining jobs to Stratum workers on <port> (default: %u = disabled)"), DEFAULT_STRATUM_PORT));
+    strUsage += HelpMessageOpt("-stratumbind=<addr>", _("Bind the Stratum server to the given address (default: 127.0.0.1)"));
+    strUsage += HelpMessageOpt("-stratumdiff=<n>", strprintf(_("Share difficulty for Stratum workers (default: %u)"), DEFAULT_STRATUM_DIFF));
+    strUsage += HelpMessageOpt("-stratummaxclients=<n>", strprintf(_("Maximum number of Stratum workers (default: %u)"), DEFAULT_STRATUM_MAX_CLIENTS));
+    strUsage += HelpMessageOpt("-stratumthreads=<n>", strprintf(_("Number of threads verifying Stratum shares (default: %u)"), DEFAULT_STRATUM_THREADS));
+
     strUsage += HelpMessageGroup(_("RPC server options:"));
     strUsage += HelpMessageOpt("-server", _("Accept command line and JSON-RPC commands"));
     strUsage += HelpMessageOpt("-rest", strprintf(_("Accept public REST requests (default: %u)"), DEFAULT_REST_ENABLE));
@@ -988,6 +1022,7 @@ void InitParameterInteraction()
     bool fAdditionalIndexes =
         GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX) ||
         GetBoolArg("-spentindex", DEFAULT_SPENTINDEX) ||
+        GetBoolArg("-messageindex", DEFAULT_MESSAGEINDEX) ||
         GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX);
 
     if (fAdditionalIndexes && GetArg("-checklevel", DEFAULT_CHECKLEVEL) < 4) {
@@ -1216,6 +1251,7 @@ bool AppInitParameterInteraction()
     }
     fCheckBlockIndex = GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
     fCheckpointsEnabled = GetBoolArg("-checkpoints", DEFAULT_CHECKPOINTS_ENABLED);
+    fCheckPoWOnDisk = GetBoolArg("-checkpowondisk", DEFAULT_CHECKPOWONDISK);
 
     hashAssumeValid = uint256S(GetArg("-assumevalid", chainparams.GetConsensus().defaultAssumeValid.GetHex()));
     if (!hashAssumeValid.IsNull())
@@ -1247,6 +1283,9 @@ bool AppInitParameterInteraction()
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 
+    RandomX_SetMaxCachedKeys(GetArg("-randomxcachekeys", DEFAULT_RANDOMX_CACHED_KEYS));
+    RandomX_SetFastMode(GetBoolArg("-randomxfastmode", DEFAULT_RANDOMX_FASTMODE), GetNumCores());
+
     // block pruning; get the amount of disk space (in MiB) to allot for block & undo files
     int64_t nPruneArg = GetArg("-prune", 0);
     if (nPruneArg < 0) {
@@ -1519,8 +1558,10 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         ShrinkDebugFile();
     }
 
-    if (fPrintToDebugLog)
+    if (fPrintToDebugLog) {
         OpenDebugLog();
+        StartDebugLogWriter(GetArg("-logflushinterval", DEFAULT_LOGFLUSHINTERVAL));
+    }
 
     if (!fLogTimestamps)
         LogPrintf("Startup time: %s\n", DateTimeStrFormat("%Y-%m-%d %H:%M:%S", GetTime()));
@@ -1537,6 +1578,7 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         for (int i=0; i<nScriptCheckThreads-1; i++)
             threadGroup.create_thread(&ThreadScriptCheck);
     }
+    StartHeaderVerifyThreads(GetNumCores());
 
     std::vector<std::string> vSporkAddresses;
     if (mapMultiArgs.count("-sporkaddr")) {
@@ -1899,6 +1941,12 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                     break;
                 }
 
+                // Check for changed -messageindex state
+                if (fMessageIndex != GetBoolArg("-messageindex", DEFAULT_MESSAGEINDEX)) {
+                    strLoadError = _("You need to rebuild the database using -reindex-chainstate to change -messageindex");
+                    break;
+                }
+
                 // Check for changed -prune state.  What we are concerned about is a user who has pruned blocks
                 // in the past, but is now trying to run unpruned.
                 if (fHavePruned && !fPruneMode) {
@@ -2251,6 +2299,17 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     connOptions.nMaxOutboundTimeframe = nMaxOutboundTimeframe;
     connOptions.nMaxOutboundLimit = nMaxOutboundLimit;
 
+    std::string strSocketEventsMode = GetArg("-socketevents", DEFAULT_SOCKETEVENTS);
+    if (strSocketEventsMode == "select") {
+        connOptions.socketEventsMode = CConnman::SOCKETEVENTS_SELECT;
+#ifdef HAVE_SYS_EPOLL_H
+    } else if (strSocketEventsMode == "epoll") {
+        connOptions.socketEventsMode = CConnman::SOCKETEVENTS_EPOLL;
+#endif
+    } else {
+        return InitError(strprintf(_("Invalid -socketevents ('%s') specified. Only these modes are supported: %s"), strSocketEventsMode, GetSupportedSocketEventsStr()));
+    }
+
     if (!connman.Start(scheduler, strNodeError, connOptions))
         return InitError(strNodeError);
 
@@ -2260,6 +2319,9 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     // Generate coins - Proof-of-Bible-Hash (POBH) - in the background
     GenerateCoins(GetBoolArg("-gen", false), GetArg("-genproclimit", 0), chainparams);
 
+    if (!StartStratumServer())
+        return InitError(_("Unable to start Stratum server. See debug log for details."));
+
     SetRPCWarmupFinished();
     uiInterface.InitMessage(_("Done loading"));
 
@@ -12,6 +12,7 @@
 #include "chain.h"
 #include "chainparams.h"
 #include "consensus/validation.h"
+#include "miner.h"
 #include "net.h"
 #include "net_processing.h"
 #include "primitives/block.h"
@@ -497,6 +498,8 @@ void CQuorumBlockProcessor::AddMinableCommitment(const CFinalCommitment& fqc)
 
     // We only relay the new commitment if it's new or better then the old one
     if (relay) {
+        // It goes into the next block, so a cached template without it is stale
+        InvalidateBlockTemplateCache();
         CInv inv(MSG_QUORUM_FINAL_COMMITMENT, commitmentHash);
         g_connman->RelayInv(inv, DMN_PROTO_VERSION);
     }
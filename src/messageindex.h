@@ -0,0 +1,107 @@
+// Copyright (c) 2014-2019 The Dash Core Developers, The DAC Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_MESSAGEINDEX_H
+#define BITCOIN_MESSAGEINDEX_H
+
+#include "serialize.h"
+
+#include <string>
+
+/**
+ * On-disk index of the application cache entries written by connected blocks (prayers, sporks, CPKs, DWS and
+ * DASH burns, coin-age votes, ...).  Entries sort by type (the cache section), key, then height and write order,
+ * so the last entry of a (type, key) run is its current value.
+ */
+struct CMessageIndexKey {
+    std::string type;
+    std::string key;
+    int blockHeight;
+    unsigned int sequence;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        s << type;
+        s << key;
+        // Heights are stored big-endian for key sorting in LevelDB
+        ser_writedata32be(s, blockHeight);
+        ser_writedata32be(s, sequence);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        s >> type;
+        s >> key;
+        blockHeight = ser_readdata32be(s);
+        sequence = ser_readdata32be(s);
+    }
+
+    CMessageIndexKey(const std::string& messageType, const std::string& messageKey, int height, unsigned int seq) {
+        type = messageType;
+        key = messageKey;
+        blockHeight = height;
+        sequence = seq;
+    }
+
+    CMessageIndexKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        type.clear();
+        key.clear();
+        blockHeight = 0;
+        sequence = 0;
+    }
+};
+
+struct CMessageIndexValue {
+    std::string value;
+    int64_t time;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(value);
+        READWRITE(time);
+    }
+
+    CMessageIndexValue(const std::string& messageValue, int64_t t) {
+        value = messageValue;
+        time = t;
+    }
+
+    CMessageIndexValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        value.clear();
+        time = 0;
+    }
+};
+
+/** Seek key for every entry of one type */
+struct CMessageIndexIteratorKey {
+    std::string type;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        s << type;
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        s >> type;
+    }
+
+    CMessageIndexIteratorKey(const std::string& messageType) {
+        type = messageType;
+    }
+
+    CMessageIndexIteratorKey() {
+        type.clear();
+    }
+};
+
+#endif // BITCOIN_MESSAGEINDEX_H
@@ -12,6 +12,7 @@
 #include "coins.h"
 #include "kjv.h"
 #include "consensus/consensus.h"
+#include "crypto/common.h"
 #include "consensus/merkle.h"
 #include "consensus/validation.h"
 #include "rpcpog.h"
@@ -21,6 +22,7 @@
 #include "net.h"
 #include "policy/policy.h"
 #include "pow.h"
+#include "randomx_bbp.h"
 #include "primitives/transaction.h"
 #include "script/standard.h"
 #include "timedata.h"
@@ -43,6 +45,7 @@
 #include "llmq/quorums_chainlocks.h"
 
 #include <algorithm>
+#include <atomic>
 #include <boost/thread.hpp>
 #include <boost/tuple/tuple.hpp>
 #include <queue>
@@ -138,10 +141,94 @@ void BlockAssembler::resetBlock()
 }
 
 BlockAssembler::BlockAssembler(const CChainParams& params) : BlockAssembler(params, DefaultOptions(params)) {}
-		
+
+// CreateNewBlock is called by every mining thread, the stratum server and every getblockforstratum poll, but the
+// package selection and coinbase only change when the tip, the mempool (its update counter) or one of the inputs
+// counted by nBlockTemplateInputsUpdated does.  A cache hit copies the last template (transactions are shared refs)
+// and only refreshes the header.
+struct CBlockTemplateCacheEntry
+{
+    uint256 hashPrevBlock;
+    unsigned int nTransactionsUpdated;
+    unsigned int nInputsUpdated;
+    CScript scriptPubKey;
+    std::string sPoolMiningPublicKey;
+    unsigned int nBlockMaxSize;
+    CFeeRate blockMinFeeRate;
+    int64_t nTimeCreated;
+    uint64_t nBlockTx;
+    uint64_t nBlockSize;
+    std::shared_ptr<const CBlockTemplate> pblocktemplate;
+};
+
+// Backstop for time dependent inputs (lock time cutoff, spork and trigger expiry): rebuild at least this often (seconds)
+static const int64_t MAX_BLOCK_TEMPLATE_CACHE_AGE = 30;
+
+static CCriticalSection cs_blocktemplatecache;
+static CBlockTemplateCacheEntry blockTemplateCache;
+// Bumped by InvalidateBlockTemplateCache.  A build reads it before it reads the commitments and payees, so if one of
+// them changes while the build runs, the template it caches carries the old count and is never served.
+static std::atomic<unsigned int> nBlockTemplateInputsUpdated(0);
+
+void InvalidateBlockTemplateCache()
+{
+    nBlockTemplateInputsUpdated++;
+}
+
+std::unique_ptr<CBlockTemplate> BlockAssembler::GetCachedBlockTemplate(const CBlockIndex* pindexPrev, unsigned int nTransactionsUpdated, unsigned int nInputsUpdated, const CScript& scriptPubKeyIn, const std::string& sPoolMiningPublicKey)
+{
+    LOCK(cs_blocktemplatecache);
+    const CBlockTemplateCacheEntry& entry = blockTemplateCache;
+    if (!entry.pblocktemplate || entry.hashPrevBlock != pindexPrev->GetBlockHash() || entry.nTransactionsUpdated != nTransactionsUpdated
+        || entry.nInputsUpdated != nInputsUpdated
+        || entry.scriptPubKey != scriptPubKeyIn || entry.sPoolMiningPublicKey != sPoolMiningPublicKey
+        || entry.nBlockMaxSize != nBlockMaxSize || !(entry.blockMinFeeRate == blockMinFeeRate)
+        || GetTime() - entry.nTimeCreated > MAX_BLOCK_TEMPLATE_CACHE_AGE)
+        return nullptr;
+    nLastBlockTx = entry.nBlockTx;
+    nLastBlockSize = entry.nBlockSize;
+    return std::unique_ptr<CBlockTemplate>(new CBlockTemplate(*entry.pblocktemplate));
+}
+
+void BlockAssembler::CacheBlockTemplate(const CBlockIndex* pindexPrev, unsigned int nTransactionsUpdated, unsigned int nInputsUpdated, const CScript& scriptPubKeyIn, const std::string& sPoolMiningPublicKey)
+{
+    LOCK(cs_blocktemplatecache);
+    CBlockTemplateCacheEntry& entry = blockTemplateCache;
+    entry.hashPrevBlock = pindexPrev->GetBlockHash();
+    entry.nTransactionsUpdated = nTransactionsUpdated;
+    entry.nInputsUpdated = nInputsUpdated;
+    entry.scriptPubKey = scriptPubKeyIn;
+    entry.sPoolMiningPublicKey = sPoolMiningPublicKey;
+    entry.nBlockMaxSize = nBlockMaxSize;
+    entry.blockMinFeeRate = blockMinFeeRate;
+    entry.nTimeCreated = GetTime();
+    entry.nBlockTx = nBlockTx;
+    entry.nBlockSize = nBlockSize;
+    entry.pblocktemplate = std::make_shared<const CBlockTemplate>(*pblocktemplate);
+}
+
 std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& scriptPubKeyIn, std::string sPoolMiningPublicKey, uint256 uRandomXKey, std::vector<unsigned char> vRandomXHeader)
 {
     int64_t nTimeStart = GetTimeMicros();
+    unsigned int nInputsUpdated = nBlockTemplateInputsUpdated;
+
+    {
+        LOCK2(cs_main, mempool.cs);
+        CBlockIndex* pindexPrev = chainActive.Tip();
+        std::unique_ptr<CBlockTemplate> pcached = GetCachedBlockTemplate(pindexPrev, mempool.GetTransactionsUpdated(), nInputsUpdated, scriptPubKeyIn, sPoolMiningPublicKey);
+        if (pcached)
+        {
+            CBlock* pblockCached = &pcached->block;
+            if (pindexPrev->nHeight + 1 >= chainparams.GetConsensus().RANDOMX_HEIGHT)
+            {
+                pblockCached->RandomXKey = uRandomXKey;
+                pblockCached->SetRandomXHeader(vRandomXHeader.data(), vRandomXHeader.data() + vRandomXHeader.size());
+            }
+            UpdateTime(pblockCached, chainparams.GetConsensus(), pindexPrev);
+            pblockCached->nNonce = 0;
+            return pcached;
+        }
+    }
 
     resetBlock();
 
@@ -159,6 +246,7 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     LOCK2(cs_main, mempool.cs);
 	    
     CBlockIndex* pindexPrev = chainActive.Tip();
+    unsigned int nTransactionsUpdated = mempool.GetTransactionsUpdated();
     nHeight = pindexPrev->nHeight + 1;
 	bool fDIP0003Active_context = nHeight >= chainparams.GetConsensus().DIP0003Height;	
     bool fDIP0008Active_context = nHeight >= chainparams.GetConsensus().DIP0008Height;
@@ -174,7 +262,7 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
 	if (nHeight >= chainparams.GetConsensus().RANDOMX_HEIGHT)
 	{
 		pblock->RandomXKey  = uRandomXKey;
-		pblock->RandomXData = "<rxheader>" + HexStr(vRandomXHeader.begin(), vRandomXHeader.end()) + "</rxheader>";
+		pblock->SetRandomXHeader(vRandomXHeader.data(), vRandomXHeader.data() + vRandomXHeader.size());
 	}
 
 	// End of RandomX Support
@@ -288,6 +376,8 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     }
     int64_t nTime2 = GetTimeMicros();
 
+    CacheBlockTemplate(pindexPrev, nTransactionsUpdated, nInputsUpdated, scriptPubKeyIn, sPoolMiningPublicKey);
+
 	if (fDebugSpam)
 		LogPrint("bench", "CreateNewBlock() packages: %.2fms (%d packages, %d updated descendants), validity: %.2fms (total %.2fms)\n", 0.001 * (nTime1 - nTimeStart), nPackagesSelected, nDescendantsUpdated, 0.001 * (nTime2 - nTime1), 0.001 * (nTime2 - nTimeStart));
 
@@ -600,6 +690,11 @@ bool CreateBlockForStratum(std::string sAddress, uint256 uRandomXKey, std::vecto
 	int iThreadID = 0;
 	boost::shared_ptr<CReserveScript> coinbaseScript;
     GetMainSignals().ScriptForMining(coinbaseScript);
+	if (!coinbaseScript || coinbaseScript->reserveScript.empty())
+	{
+		sError = "No coinbase script available (mining requires a wallet)";
+		return false;
+	}
 	std::unique_ptr<CBlockTemplate> pblocktemplate(BlockAssembler(Params()).CreateNewBlock(coinbaseScript->reserveScript, sAddress, uRandomXKey, vRandomXHeader));
 	if (!pblocktemplate.get())
     {
@@ -616,13 +711,37 @@ bool CreateBlockForStratum(std::string sAddress, uint256 uRandomXKey, std::vecto
 	return true;
 }	
 
-void static BibleMiner(const CChainParams& chainparams, int iThreadID, int iFeatureSet)
+// Solo-mining RandomX header: session id (32) | template extra nonce (8) | nonce (4) | zero padding
+static const size_t MINER_RXHEADER_SIZE = 64;
+static const size_t MINER_RXHEADER_NONCE_OFFSET = 40;
+
+static void InitMinerRandomXHeader(unsigned char* pch, const uint256& uSession, uint64_t nExtraNonce)
+{
+	memset(pch, 0, MINER_RXHEADER_SIZE);
+	memcpy(pch, uSession.begin(), uSession.size());
+	WriteLE64(pch + 32, nExtraNonce);
+}
+
+// Bumped on every new tip, so the mining threads can drop stale work without polling chainActive
+static std::atomic<uint64_t> nMinerTipGeneration(0);
+
+class CMinerTipListener : public CValidationInterface
+{
+protected:
+	void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override
+	{
+		nMinerTipGeneration++;
+	}
+};
+
+static CMinerTipListener minerTipListener;
+
+void static BibleMiner(const CChainParams& chainparams, int iThreadID, int nThreads)
 {
 	LogPrintf("BibleMiner -- started thread %f \n", (double)iThreadID);
     int64_t nThreadStart = GetTimeMillis();
 	int64_t nLastGUI = GetAdjustedTime() - 30;
 	int64_t nLastMiningBreak = 0;
-	unsigned int nExtraNonce = 0;
 	double nHashesDone = 0;
 	
 	// This allows the miner to dictate how much sleep will occur when distributed computing is enabled.  This will let PODC use the maximum CPU time.  NOTE: The default is 200ms per 256 hashes.
@@ -636,6 +755,14 @@ void static BibleMiner(const CChainParams& chainparams, int iThreadID, int iFeat
 	int iStart = rand() % 1000;
 	MilliSleep(iStart);
 
+	// Each thread searches its own slice of the 32 bit RandomX nonce space with its own VM
+	uint32_t nNonceRange = 0xFFFFFFFF / (uint32_t)std::max(nThreads, 1);
+	uint32_t nNonceStart = nNonceRange * (uint32_t)iThreadID;
+	uint32_t nNonceEnd = nNonceStart + nNonceRange - 1;
+	uint256 uSession = uint256S(msSessionID);
+	std::unique_ptr<CRandomXVM> pvm;
+	unsigned char vchRX[2][MINER_RXHEADER_SIZE];
+
 recover:
 	
     try {
@@ -670,9 +797,13 @@ recover:
             // Create new block
             //
             unsigned int nTransactionsUpdatedLast = mempool.GetTransactionsUpdated();
+			uint64_t nTipGeneration = nMinerTipGeneration;
             CBlockIndex* pindexPrev = chainActive.Tip();
             if(!pindexPrev) break;
-			bool fRandomX = (pindexPrev->nHeight >= chainparams.GetConsensus().RANDOMX_HEIGHT);
+			const Consensus::Params& consensusParams = chainparams.GetConsensus();
+			bool fRandomX = (pindexPrev->nHeight >= consensusParams.RANDOMX_HEIGHT);
+			bool fPhaseII = (pindexPrev->nHeight > consensusParams.POOM_PHASEOUT_HEIGHT);
+			uint256 hashPrev = pindexPrev->GetBlockHash();
 
 			if (!fProd && mempool.size() == 0 && GetSporkDouble("SLEEP_DURING_EMPTY_BLOCKS", 0) == 1)
                 MilliSleep(1000 * 60 * 7);
@@ -695,11 +826,22 @@ recover:
 			unsigned int nExtraNonce = GetAdjustedTime() + iStart + iThreadID;
 			
             IncrementExtraNonce(pblock, pindexPrev, nExtraNonce);
-			nHashesDone++;
-			UpdateHashesPerSec(nHashesDone);
 			if (fDebugSpam)
 				LogPrint("miner", "SoloMiner -- Running miner with %u transactions in block (%u bytes)\n", 
 				     pblock->vtx.size(), ::GetSerializeSize(*pblock, SER_NETWORK, PROTOCOL_VERSION));
+
+			if (fRandomX)
+			{
+				// The VM stays pinned to this thread until the key changes
+				if (!pvm || pvm->GetKey() != pblock->RandomXKey)
+				{
+					pvm.reset();
+					pvm.reset(new CRandomXVM(pblock->RandomXKey, true));
+				}
+				InitMinerRandomXHeader(vchRX[0], uSession, ((uint64_t)GetAdjustedTime() << 16) ^ (uint64_t)nExtraNonce);
+				memcpy(vchRX[1], vchRX[0], MINER_RXHEADER_SIZE);
+				pblock->nNonce = nNonceStart;
+			}
 		    //
             // Search
             //
@@ -710,16 +852,33 @@ recover:
 			bool f9000;
 			bool fTitheBlocksActive;
 			GetMiningParams(pindexPrev->nHeight, f7000, f8000, f9000, fTitheBlocksActive);
-			const Consensus::Params& consensusParams = Params().GetConsensus();
+			bool fFound = false;
 			
 			while (true)
 			{
+				// RandomX is pipelined: while the VM finishes the hash of vchRX[iCur] it starts on the next nonce in vchRX[iCur ^ 1]
+				int iCur = 0;
+				if (fRandomX)
+				{
+					WriteLE32(vchRX[iCur] + MINER_RXHEADER_NONCE_OFFSET, pblock->nNonce);
+					pvm->HashFirst(vchRX[iCur], MINER_RXHEADER_SIZE);
+				}
+
 				while (true)
 				{
-					// Use RandomX after the RandomX cutover height:
-					uint256 x11_hash = pblock->GetHash();
-					uint256 hash = BibleHashV2(x11_hash, pblock->GetBlockTime(), pindexPrev->nTime, true, pindexPrev->nHeight, pblock->RandomXData, pblock->RandomXKey, pindexPrev->GetBlockHash(), iThreadID + 1);
-					
+					uint256 hash;
+					if (fRandomX)
+					{
+						WriteLE32(vchRX[iCur ^ 1] + MINER_RXHEADER_NONCE_OFFSET, pblock->nNonce + 1);
+						uint256 rxhash;
+						pvm->HashNext(vchRX[iCur ^ 1], MINER_RXHEADER_SIZE, rxhash.begin());
+						hash = fPhaseII ? rxhash : GetRandomXBlakeHash(rxhash, hashPrev);
+					}
+					else
+					{
+						uint256 x11_hash = pblock->GetHash();
+						hash = BibleHashV2(x11_hash, pblock->GetBlockTime(), pindexPrev->nTime, true, pindexPrev->nHeight, pblock->RandomXData, pblock->RandomXKey, hashPrev, iThreadID + 1);
+					}
 					nHashesDone += 1;
 
 					if (UintToArith256(ComputeRandomXTarget(hash, pindexPrev->nTime, pblock->GetBlockTime())) <= hashTarget)
@@ -728,6 +887,8 @@ recover:
 						if (fNonce)
 						{
 							// Found a solution
+							if (fRandomX)
+								pblock->SetRandomXHeader(vchRX[iCur], vchRX[iCur] + MINER_RXHEADER_SIZE);
 							std::shared_ptr<const CBlock> shared_pblock = std::make_shared<const CBlock>(*pblock);
 							bool bAccepted = !ProcessNewBlock(Params(), shared_pblock, true, NULL);
 							if (!bAccepted)
@@ -740,17 +901,19 @@ recover:
 							// allows developers to controllably generate a block on demand.
 							if (chainparams.MineBlocksOnDemand())
 									throw boost::thread_interrupted();
+							fFound = true;
 							break;
 						}
 					}
 						
 					pblock->nNonce += 1;
-					// If RandomX 
-					if (fRandomX)
-					{
-						uint256 rxHeader = uint256S("0x" + RoundToString(GetAdjustedTime(), 0) + RoundToString(iThreadID, 0) + RoundToString(pblock->nNonce, 0));
-						pblock->RandomXData = "<rxheader>" + msSessionID + rxHeader.GetHex() + "</rxheader>";
-					}
+					iCur ^= 1;
+
+					if (nMinerTipGeneration != nTipGeneration)
+						break;
+
+					if (fRandomX && pblock->nNonce >= nNonceEnd)
+						break;
 
 					if ((pblock->nNonce & 0xFF) == 0)
 					{
@@ -783,16 +946,19 @@ recover:
 				boost::this_thread::interruption_point();
 				// Regtest mode doesn't require peers
                
+				if (fFound)
+					break;
+
 				if (!PeersExist() && chainparams.MiningRequiresPeers())
 					 break;
 
 				if (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 60)
 					break;
 		
-				if (pindexPrev != chainActive.Tip() || pindexPrev==NULL || chainActive.Tip()==NULL)
+				if (nMinerTipGeneration != nTipGeneration)
 					break;
 		
-				if (pblock->nNonce >= 0x9FFF)
+				if (fRandomX ? pblock->nNonce >= nNonceEnd : pblock->nNonce >= 0x9FFF)
 					break;
 	                        
 				// Update nTime every few seconds
@@ -844,26 +1010,26 @@ void GenerateCoins(bool fGenerate, int nThreads, const CChainParams& chainparams
 		minerThreads->join_all();
         delete minerThreads;
         minerThreads = NULL;
+		UnregisterValidationInterface(&minerTipListener);
 		LogPrintf("Destroyed all miner threads %f", GetAdjustedTime());
 
-		// We must be very careful here with RandomX, as we have one VM running per mining thread, so we need to let these threads exit
-
+		// Each mining thread hands its pinned RandomX VM back to the pool as it exits
     }
 
     if (nThreads == 0 || !fGenerate)
         return;
 
     minerThreads = new boost::thread_group();
+	RegisterValidationInterface(&minerTipListener);
 	ClearCache("poolcache");
 	
  	if (msSessionID.empty())
 		msSessionID = GetRandHash().GetHex();
 
-	int iBibleNumber = 0;			
     for (int i = 0; i < nThreads; i++)
 	{
 		ClearCache("poolthread" + RoundToString(i, 0));
-	    minerThreads->create_thread(boost::bind(&BibleMiner, boost::cref(chainparams), boost::cref(i), boost::cref(iBibleNumber)));
+	    minerThreads->create_thread(boost::bind(&BibleMiner, boost::cref(chainparams), i, nThreads));
 	    MilliSleep(100); 
 	}
 	iMinerThreadCount = nThreads;
@@ -873,5 +1039,3 @@ void GenerateCoins(bool fGenerate, int nThreads, const CChainParams& chainparams
 	nHashCounter = 0;
 	LogPrintf(" ** Started %f BibleMiner threads. ** \r\n",(double)nThreads);
 }
-
-
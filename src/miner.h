@@ -178,6 +178,10 @@ private:
     // utility functions
     /** Clear the block's state and prepare for assembling a new block */
     void resetBlock();
+    /** Copy of the last template if the tip, mempool and coinbase destination are unchanged */
+    std::unique_ptr<CBlockTemplate> GetCachedBlockTemplate(const CBlockIndex* pindexPrev, unsigned int nTransactionsUpdated, unsigned int nInputsUpdated, const CScript& scriptPubKeyIn, const std::string& sPoolMiningPublicKey);
+    /** Remember the template just built for GetCachedBlockTemplate */
+    void CacheBlockTemplate(const CBlockIndex* pindexPrev, unsigned int nTransactionsUpdated, unsigned int nInputsUpdated, const CScript& scriptPubKeyIn, const std::string& sPoolMiningPublicKey);
     /** Add a tx to the block */
     void AddToBlock(CTxMemPool::txiter iter);
 
@@ -211,5 +215,8 @@ private:
 /** Modify the extranonce in a block */
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
+/** Drop the cached block template; called when an input of CreateNewBlock other than the tip and the mempool changes
+ *  (minable LLMQ commitments, superblock triggers and their votes, sporks) */
+void InvalidateBlockTemplateCache();
 
 #endif // BITCOIN_MINER_H
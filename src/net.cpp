@@ -37,6 +37,10 @@
 #include <fcntl.h>
 #endif
 
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
 #ifdef USE_UPNP
 #include <miniupnpc/miniupnpc.h>
 #include <miniupnpc/miniwget.h>
@@ -53,6 +57,9 @@
 // We add a random period time (0 to 1 seconds) to feeler connections to prevent synchronization.
 #define FEELER_SLEEP_WINDOW 1
 
+// Maximum number of events collected by one epoll_wait() call
+#define EPOLL_MAX_EVENTS 256
+
 #if !defined(HAVE_MSG_NOSIGNAL) && !defined(MSG_NOSIGNAL)
 #define MSG_NOSIGNAL 0
 #endif
@@ -441,7 +448,7 @@ void CConnman::DumpBanlist()
         banmap.size(), GetTimeMillis() - nStart);
 }
 
-void CNode::CloseSocketDisconnect()
+void CNode::CloseSocketDisconnect(CConnman* connman)
 {
     fDisconnect = true;
     LOCK(cs_hSocket);
@@ -449,6 +456,7 @@ void CNode::CloseSocketDisconnect()
     {
         if (fDebugSpam)
 			LogPrint("net", "disconnecting peer=%d\n", id);
+        connman->UnregisterEvents(this);
         CloseSocket(hSocket);
     }
 }
@@ -914,6 +922,9 @@ size_t CConnman::SocketSendData(CNode *pnode) const
     if (it == pnode->vSendMsg.end()) {
         assert(pnode->nSendOffset == 0);
         assert(pnode->nSendSize == 0);
+    } else {
+        // stopped short: with epoll, wait for EPOLLOUT before trying again
+        pnode->fCanSendData = false;
     }
     pnode->vSendMsg.erase(pnode->vSendMsg.begin(), it);
     return nSentSize;
@@ -1127,7 +1138,8 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
         return;
     }
 
-    if (!IsSelectableSocket(hSocket))
+    // Only select() is limited by FD_SETSIZE
+    if (socketEventsMode != SOCKETEVENTS_EPOLL && !IsSelectableSocket(hSocket))
     {
         if (fDebugSpam)
 			LogPrintf("connection from %s dropped: non-selectable socket\n", addr.ToString());
@@ -1186,18 +1198,24 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
+        RegisterEvents(pnode);
     }
 }
 
 void CConnman::ThreadSocketHandler()
 {
     unsigned int nPrevNodeCount = 0;
+    int64_t nLastDisconnectCheck = 0;
     while (!interruptNet)
     {
         //
         // Disconnect nodes
         //
+        // With epoll a round only visits the nodes that have work, so the scan for fDisconnect runs once a second
+        int64_t nTime = GetSystemTimeInSeconds();
+        if (socketEventsMode != SOCKETEVENTS_EPOLL || nTime != nLastDisconnectCheck)
         {
+            nLastDisconnectCheck = nTime;
             LOCK(cs_vNodes);
             // Disconnect unused nodes
             std::vector<CNode*> vNodesCopy = vNodes;
@@ -1217,7 +1235,7 @@ void CConnman::ThreadSocketHandler()
                     pnode->grantMasternodeOutbound.Release();
 
                     // close socket and cleanup
-                    pnode->CloseSocketDisconnect();
+                    pnode->CloseSocketDisconnect(this);
 
                     // hold in disconnected pool until all refs are released
                     pnode->Release();
@@ -1244,6 +1262,11 @@ void CConnman::ThreadSocketHandler()
                     }
                     if (fDelete) {
                         vNodesDisconnected.remove(pnode);
+                        setReceivableNodes.erase(pnode);
+                        {
+                            LOCK(cs_setSendableNodes);
+                            setSendableNodes.erase(pnode);
+                        }
                         DeleteNode(pnode);
                     }
                 }
@@ -1260,6 +1283,11 @@ void CConnman::ThreadSocketHandler()
                 clientInterface->NotifyNumConnectionsChanged(nPrevNodeCount);
         }
 
+        if (socketEventsMode == SOCKETEVENTS_EPOLL) {
+            SocketHandlerEpoll();
+            continue;
+        }
+
         //
         // Find which sockets have data to receive
         //
@@ -1386,6 +1414,7 @@ void CConnman::ThreadSocketHandler()
         //
         // Service each socket
         //
+        bool fWakeMessageHandler = false;
         std::vector<CNode*> vNodesCopy = CopyNodeVector();
         BOOST_FOREACH(CNode* pnode, vNodesCopy)
         {
@@ -1407,68 +1436,7 @@ void CConnman::ThreadSocketHandler()
                 errorSet = FD_ISSET(pnode->hSocket, &fdsetError);
             }
             if (recvSet || errorSet)
-            {
-                {
-                    {
-                        // typical socket buffer is 8K-64K
-                        char pchBuf[0x10000];
-                        int nBytes = 0;
-                        {
-                            LOCK(pnode->cs_hSocket);
-                            if (pnode->hSocket == INVALID_SOCKET)
-                                continue;
-                            nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
-                        }
-                        if (nBytes > 0)
-                        {
-                            bool notify = false;
-                            if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, notify))
-                                pnode->CloseSocketDisconnect();
-                            RecordBytesRecv(nBytes);
-                            if (notify) {
-                                size_t nSizeAdded = 0;
-                                auto it(pnode->vRecvMsg.begin());
-                                for (; it != pnode->vRecvMsg.end(); ++it) {
-                                    if (!it->complete())
-                                        break;
-                                    nSizeAdded += it->vRecv.size() + CMessageHeader::HEADER_SIZE;
-                                }
-                                {
-                                    LOCK(pnode->cs_vProcessMsg);
-                                    pnode->vProcessMsg.splice(pnode->vProcessMsg.end(), pnode->vRecvMsg, pnode->vRecvMsg.begin(), it);
-                                    pnode->nProcessQueueSize += nSizeAdded;
-                                    pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
-                                }
-                                WakeMessageHandler();
-                            }
-                        }
-                        else if (nBytes == 0)
-                        {
-                            // socket closed gracefully
-                            if (!pnode->fDisconnect)
-							{
-                                if (fDebugSpam)
-									LogPrint("net", "socket closed\n");
-							}
-                            pnode->CloseSocketDisconnect();
-                        }
-                        else if (nBytes < 0)
-                        {
-                            // error
-                            int nErr = WSAGetLastError();
-                            if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
-                            {
-                                if (!pnode->fDisconnect)
-								{
-                                    if (fDebugSpam)
-										LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
-								}
-                                pnode->CloseSocketDisconnect();
-                            }
-                        }
-                    }
-                }
-            }
+                ReceiveSocketData(pnode, fWakeMessageHandler);
 
             //
             // Send
@@ -1485,38 +1453,293 @@ void CConnman::ThreadSocketHandler()
             //
             // Inactivity checking
             //
-            int64_t nTime = GetSystemTimeInSeconds();
-            if (nTime - pnode->nTimeConnected > 60)
+            InactivityCheck(pnode);
+        }
+        ReleaseNodeVector(vNodesCopy);
+        if (fWakeMessageHandler)
+            WakeMessageHandler();
+    }
+}
+
+bool CConnman::ReceiveSocketData(CNode* pnode, bool& fWakeMessageHandler)
+{
+    // typical socket buffer is 8K-64K
+    char pchBuf[0x10000];
+    int nBytes = 0;
+    {
+        LOCK(pnode->cs_hSocket);
+        if (pnode->hSocket == INVALID_SOCKET)
+            return false;
+        nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
+    }
+    if (nBytes > 0)
+    {
+        bool notify = false;
+        if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, notify))
+            pnode->CloseSocketDisconnect(this);
+        RecordBytesRecv(nBytes);
+        if (notify) {
+            size_t nSizeAdded = 0;
+            auto it(pnode->vRecvMsg.begin());
+            for (; it != pnode->vRecvMsg.end(); ++it) {
+                if (!it->complete())
+                    break;
+                nSizeAdded += it->vRecv.size() + CMessageHeader::HEADER_SIZE;
+            }
             {
-                if (pnode->nLastRecv == 0 || pnode->nLastSend == 0)
-                {
-                    LogPrint("net", "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
-                    pnode->fDisconnect = true;
-                }
-                else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL)
-                {
-                    LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
-                    pnode->fDisconnect = true;
-                }
-                else if (nTime - pnode->nLastRecv > (pnode->nVersion > BIP0031_VERSION ? TIMEOUT_INTERVAL : 90*60))
-                {
-                    LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
-                    pnode->fDisconnect = true;
-                }
-                else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros())
-                {
-                    LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
-                    pnode->fDisconnect = true;
-                }
-                else if (!pnode->fSuccessfullyConnected)
-                {
-                    LogPrintf("version handshake timeout from %d\n", pnode->id);
-                    pnode->fDisconnect = true;
-                }
+                LOCK(pnode->cs_vProcessMsg);
+                pnode->vProcessMsg.splice(pnode->vProcessMsg.end(), pnode->vRecvMsg, pnode->vRecvMsg.begin(), it);
+                pnode->nProcessQueueSize += nSizeAdded;
+                pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
             }
+            fWakeMessageHandler = true;
+        }
+        return true;
+    }
+    else if (nBytes == 0)
+    {
+        // socket closed gracefully
+        if (!pnode->fDisconnect)
+        {
+            if (fDebugSpam)
+                LogPrint("net", "socket closed\n");
+        }
+        pnode->CloseSocketDisconnect(this);
+    }
+    else if (nBytes < 0)
+    {
+        // error
+        int nErr = WSAGetLastError();
+        if (nErr == WSAEINTR)
+            return true;
+        if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINPROGRESS)
+        {
+            if (!pnode->fDisconnect)
+            {
+                if (fDebugSpam)
+                    LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
+            }
+            pnode->CloseSocketDisconnect(this);
+        }
+    }
+    return false;
+}
+
+void CConnman::InactivityCheck(CNode* pnode)
+{
+    int64_t nTime = GetSystemTimeInSeconds();
+    if (nTime - pnode->nTimeConnected > 60)
+    {
+        if (pnode->nLastRecv == 0 || pnode->nLastSend == 0)
+        {
+            LogPrint("net", "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
+            pnode->fDisconnect = true;
+        }
+        else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL)
+        {
+            LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
+            pnode->fDisconnect = true;
+        }
+        else if (nTime - pnode->nLastRecv > (pnode->nVersion > BIP0031_VERSION ? TIMEOUT_INTERVAL : 90*60))
+        {
+            LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
+            pnode->fDisconnect = true;
+        }
+        else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros())
+        {
+            LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
+            pnode->fDisconnect = true;
+        }
+        else if (!pnode->fSuccessfullyConnected)
+        {
+            LogPrintf("version handshake timeout from %d\n", pnode->id);
+            pnode->fDisconnect = true;
+        }
+    }
+}
+
+void CConnman::SocketHandlerEpoll()
+{
+#ifdef HAVE_SYS_EPOLL_H
+    // Don't wait for new events while a node still has unread data or can take its queued messages
+    bool fPending = false;
+    for (CNode* pnode : setReceivableNodes) {
+        if (!pnode->fPauseRecv) {
+            fPending = true;
+            break;
+        }
+    }
+    if (!fPending) {
+        LOCK(cs_setSendableNodes);
+        for (CNode* pnode : setSendableNodes) {
+            if (pnode->fCanSendData) {
+                fPending = true;
+                break;
+            }
+        }
+    }
+
+    epoll_event events[EPOLL_MAX_EVENTS];
+    wakeupSelectNeeded = true;
+    int nEvents = epoll_wait(epollfd, events, EPOLL_MAX_EVENTS, fPending ? 0 : 50);
+    wakeupSelectNeeded = false;
+    if (interruptNet)
+        return;
+
+    if (nEvents < 0) {
+        if (errno != EINTR) {
+            LogPrintf("socket epoll_wait error %s\n", NetworkErrorString(errno));
+            if (!interruptNet.sleep_for(std::chrono::milliseconds(50)))
+                return;
+        }
+        nEvents = 0;
+    }
+
+    for (int i = 0; i < nEvents; i++) {
+        int fd = events[i].data.fd;
+        if (fd == wakeupPipe[0]) {
+            // drain the wakeup pipe
+            char buf[128];
+            while (read(wakeupPipe[0], buf, sizeof(buf)) > 0) {}
+            continue;
+        }
+
+        // Listen sockets are level-triggered, so a backlog of connections is accepted one per round
+        bool fListenSocket = false;
+        BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket) {
+            if (hListenSocket.socket == (SOCKET)fd) {
+                AcceptConnection(hListenSocket);
+                fListenSocket = true;
+                break;
+            }
+        }
+        if (fListenSocket)
+            continue;
+
+        // Nodes are only deleted by this thread, so the pointer stays valid after the lookup
+        CNode* pnode = nullptr;
+        {
+            LOCK(cs_mapSocketToNode);
+            auto it = mapSocketToNode.find(fd);
+            if (it != mapSocketToNode.end())
+                pnode = it->second;
+        }
+        if (pnode == nullptr)
+            continue;
+        // Errors and hang-ups are reported by the next recv(), as with select()
+        if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP | EPOLLRDHUP))
+            setReceivableNodes.insert(pnode);
+        if (events[i].events & EPOLLOUT) {
+            LOCK(pnode->cs_vSend);
+            pnode->fCanSendData = true;
+            if (!pnode->vSendMsg.empty()) {
+                LOCK(cs_setSendableNodes);
+                setSendableNodes.insert(pnode);
+            }
+        }
+    }
+
+    //
+    // Receive: one recv() per node and round, so that a busy peer cannot starve the others
+    //
+    bool fWakeMessageHandler = false;
+    std::vector<CNode*> vReceivable(setReceivableNodes.begin(), setReceivableNodes.end());
+    for (CNode* pnode : vReceivable) {
+        if (interruptNet)
+            return;
+        if (pnode->fPauseRecv)
+            continue;
+        if (!ReceiveSocketData(pnode, fWakeMessageHandler))
+            setReceivableNodes.erase(pnode);
+    }
+    if (fWakeMessageHandler)
+        WakeMessageHandler();
+
+    //
+    // Send; once a second every node with queued data is tried again, in case an EPOLLOUT raced with a short send
+    //
+    int64_t nTime = GetSystemTimeInSeconds();
+    bool fPeriodic = nTime != nLastInactivityCheck;
+    std::vector<CNode*> vSendable;
+    {
+        LOCK(cs_setSendableNodes);
+        for (CNode* pnode : setSendableNodes) {
+            if (pnode->fCanSendData || fPeriodic)
+                vSendable.push_back(pnode);
+        }
+    }
+    for (CNode* pnode : vSendable) {
+        size_t nBytes = 0;
+        {
+            LOCK(pnode->cs_vSend);
+            if (!pnode->fDisconnect)
+                nBytes = SocketSendData(pnode);
+            if (pnode->vSendMsg.empty() || pnode->fDisconnect) {
+                LOCK(cs_setSendableNodes);
+                setSendableNodes.erase(pnode);
+            }
+        }
+        if (nBytes)
+            RecordBytesSent(nBytes);
+    }
+
+    //
+    // Inactivity checking: the timeouts are in seconds, so there is no need to visit every node more often
+    //
+    if (fPeriodic) {
+        nLastInactivityCheck = nTime;
+        std::vector<CNode*> vNodesCopy = CopyNodeVector();
+        for (CNode* pnode : vNodesCopy) {
+            InactivityCheck(pnode);
         }
         ReleaseNodeVector(vNodesCopy);
     }
+#endif
+}
+
+void CConnman::RegisterEvents(CNode* pnode)
+{
+#ifdef HAVE_SYS_EPOLL_H
+    if (socketEventsMode != SOCKETEVENTS_EPOLL)
+        return;
+
+    LOCK(pnode->cs_hSocket);
+    if (pnode->hSocket == INVALID_SOCKET)
+        return;
+
+    LOCK(cs_mapSocketToNode);
+    // A socket that is already readable or writable when it is added reports that once, so nothing is missed
+    epoll_event e;
+    e.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    e.data.fd = pnode->hSocket;
+    if (epoll_ctl(epollfd, EPOLL_CTL_ADD, pnode->hSocket, &e) != 0) {
+        LogPrintf("epoll_ctl failed for peer=%d: %s\n", pnode->id, NetworkErrorString(errno));
+        pnode->fDisconnect = true;
+        return;
+    }
+    mapSocketToNode[pnode->hSocket] = pnode;
+#endif
+}
+
+void CConnman::UnregisterEvents(CNode* pnode)
+{
+#ifdef HAVE_SYS_EPOLL_H
+    if (socketEventsMode != SOCKETEVENTS_EPOLL)
+        return;
+
+    AssertLockHeld(pnode->cs_hSocket);
+    if (pnode->hSocket == INVALID_SOCKET)
+        return;
+
+    LOCK(cs_mapSocketToNode);
+    auto it = mapSocketToNode.find(pnode->hSocket);
+    if (it == mapSocketToNode.end() || it->second != pnode)
+        return;
+    mapSocketToNode.erase(it);
+    if (epoll_ctl(epollfd, EPOLL_CTL_DEL, pnode->hSocket, nullptr) != 0) {
+        LogPrintf("epoll_ctl failed for peer=%d: %s\n", pnode->id, NetworkErrorString(errno));
+    }
+#endif
 }
 
 void CConnman::WakeMessageHandler()
@@ -2208,6 +2431,7 @@ bool CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
+        RegisterEvents(pnode);
     }
 
     return true;
@@ -2421,7 +2645,7 @@ void CConnman::SetNetworkActive(bool active)
         LOCK(cs_vNodes);
         // Close sockets to all nodes
         BOOST_FOREACH(CNode* pnode, vNodes) {
-            pnode->CloseSocketDisconnect();
+            pnode->CloseSocketDisconnect(this);
         }
     } else {
         fNetworkActive = true;
@@ -2440,6 +2664,7 @@ CConnman::CConnman(uint64_t nSeed0In, uint64_t nSeed1In) :
     nLastNodeId = 0;
     nSendBufferMaxSize = 0;
     nReceiveFloodSize = 0;
+    socketEventsMode = SOCKETEVENTS_SELECT;
     semOutbound = NULL;
     semAddnode = NULL;
     semMasternodeOutbound = NULL;
@@ -2476,6 +2701,8 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
     nMaxOutboundLimit = connOptions.nMaxOutboundLimit;
     nMaxOutboundTimeframe = connOptions.nMaxOutboundTimeframe;
 
+    socketEventsMode = connOptions.socketEventsMode;
+
     SetBestHeight(connOptions.nBestHeight);
 
     clientInterface = connOptions.uiInterface;
@@ -2559,6 +2786,36 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
     }
 #endif
 
+#ifdef HAVE_SYS_EPOLL_H
+    if (socketEventsMode == SOCKETEVENTS_EPOLL) {
+        epollfd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollfd == -1) {
+            LogPrintf("epoll_create1 failed (%s), using select()\n", NetworkErrorString(errno));
+            socketEventsMode = SOCKETEVENTS_SELECT;
+        }
+    }
+    if (socketEventsMode == SOCKETEVENTS_EPOLL) {
+        // The wakeup pipe and the listen sockets stay level-triggered
+        std::vector<SOCKET> vSockets;
+        if (wakeupPipe[0] != -1)
+            vSockets.push_back(wakeupPipe[0]);
+        BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket) {
+            vSockets.push_back(hListenSocket.socket);
+        }
+        for (SOCKET hSocket : vSockets) {
+            epoll_event e;
+            e.events = EPOLLIN;
+            e.data.fd = hSocket;
+            if (epoll_ctl(epollfd, EPOLL_CTL_ADD, hSocket, &e) != 0) {
+                LogPrintf("epoll_ctl failed: %s\n", NetworkErrorString(errno));
+            }
+        }
+        LogPrintf("Using epoll for socket events\n");
+    }
+#else
+    socketEventsMode = SOCKETEVENTS_SELECT;
+#endif
+
     // Send and receive from sockets, accept connections
     threadSocketHandler = std::thread(&TraceThread<std::function<void()> >, "net", std::function<void()>(std::bind(&CConnman::ThreadSocketHandler, this)));
 
@@ -2663,7 +2920,7 @@ void CConnman::Stop()
 
     // Close sockets
     BOOST_FOREACH(CNode* pnode, vNodes)
-        pnode->CloseSocketDisconnect();
+        pnode->CloseSocketDisconnect(this);
     BOOST_FOREACH(ListenSocket& hListenSocket, vhListenSocket)
         if (hListenSocket.socket != INVALID_SOCKET)
             if (!CloseSocket(hListenSocket.socket))
@@ -2691,6 +2948,16 @@ void CConnman::Stop()
     if (wakeupPipe[1] != -1) close(wakeupPipe[1]);
     wakeupPipe[0] = wakeupPipe[1] = -1;
 #endif
+
+    setReceivableNodes.clear();
+    {
+        LOCK(cs_setSendableNodes);
+        setSendableNodes.clear();
+    }
+#ifdef HAVE_SYS_EPOLL_H
+    if (epollfd != -1) close(epollfd);
+    epollfd = -1;
+#endif
 }
 
 void CConnman::DeleteNode(CNode* pnode)
@@ -3291,6 +3558,11 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg, bool allowOpti
         // wake up select() call in case there was no pending data before (so it was not selecting this socket for sending)
         else if (!hasPendingData && wakeupSelectNeeded)
             WakeSelect();
+        // with epoll, the socket thread only sends to the nodes in setSendableNodes
+        if (socketEventsMode == SOCKETEVENTS_EPOLL && !pnode->vSendMsg.empty()) {
+            LOCK(cs_setSendableNodes);
+            setSendableNodes.insert(pnode);
+        }
     }
     if (nBytesSent)
         RecordBytesSent(nBytesSent);
@@ -29,6 +29,7 @@
 #include <thread>
 #include <memory>
 #include <condition_variable>
+#include <unordered_map>
 #include <unordered_set>
 
 #ifndef WIN32
@@ -109,6 +110,12 @@ static const bool DEFAULT_BLOCKSONLY = false;
 static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
+/** -socketevents default: epoll where the system has it */
+#ifdef HAVE_SYS_EPOLL_H
+static const char* const DEFAULT_SOCKETEVENTS = "epoll";
+#else
+static const char* const DEFAULT_SOCKETEVENTS = "select";
+#endif
 
 static const ServiceFlags REQUIRED_SERVICES = NODE_NETWORK;
 
@@ -154,6 +161,11 @@ public:
         CONNECTIONS_ALL = (CONNECTIONS_IN | CONNECTIONS_OUT),
     };
 
+    enum SocketEventsMode {
+        SOCKETEVENTS_SELECT = 0,
+        SOCKETEVENTS_EPOLL = 1,
+    };
+
     struct Options
     {
         ServiceFlags nLocalServices = NODE_NONE;
@@ -168,6 +180,7 @@ public:
         unsigned int nReceiveFloodSize = 0;
         uint64_t nMaxOutboundTimeframe = 0;
         uint64_t nMaxOutboundLimit = 0;
+        SocketEventsMode socketEventsMode = SOCKETEVENTS_SELECT;
     };
     CConnman(uint64_t seed0, uint64_t seed1);
     ~CConnman();
@@ -425,6 +438,11 @@ public:
     void WakeMessageHandler();
     void WakeSelect();
 
+    /** Add a node's socket to the epoll set (no-op with select) */
+    void RegisterEvents(CNode* pnode);
+    /** Remove a node's socket from the epoll set; called with pnode->cs_hSocket held, before the socket is closed */
+    void UnregisterEvents(CNode* pnode);
+
 private:
     struct ListenSocket {
         SOCKET socket;
@@ -439,6 +457,11 @@ private:
     void ThreadMessageHandler();
     void AcceptConnection(const ListenSocket& hListenSocket);
     void ThreadSocketHandler();
+    void SocketHandlerSelect();
+    void SocketHandlerEpoll();
+    /** One recv() from the node's socket; returns false once there is nothing more to read right now */
+    bool ReceiveSocketData(CNode* pnode, bool& fWakeMessageHandler);
+    void InactivityCheck(CNode* pnode);
     void ThreadDNSAddressSeed();
     void ThreadOpenMasternodeConnections();
 
@@ -548,6 +571,20 @@ private:
 #endif
     std::atomic<bool> wakeupSelectNeeded{false};
 
+    SocketEventsMode socketEventsMode;
+    /**
+     * epoll backend: node sockets are registered once, edge-triggered.  Readiness reported by an event is remembered
+     * until a read or write would block: setReceivableNodes holds the nodes that may have unread data (only used by the
+     * socket thread), setSendableNodes the nodes with queued messages, which are sent while CNode::fCanSendData is set.
+     */
+    int epollfd{-1};
+    CCriticalSection cs_mapSocketToNode;
+    std::unordered_map<SOCKET, CNode*> mapSocketToNode;
+    std::set<CNode*> setReceivableNodes;
+    CCriticalSection cs_setSendableNodes;
+    std::set<CNode*> setSendableNodes;
+    int64_t nLastInactivityCheck{0};
+
     std::thread threadDNSAddressSeed;
     std::thread threadSocketHandler;
     std::thread threadOpenAddedConnections;
@@ -781,6 +818,8 @@ public:
 
     std::atomic_bool fPauseRecv;
     std::atomic_bool fPauseSend;
+    // epoll only: the socket can take more data (cleared when a send stops short, set again by EPOLLOUT)
+    std::atomic_bool fCanSendData{false};
 protected:
 
     mapMsgCmdSize mapSendBytesPerMsgCmd;
@@ -993,7 +1032,7 @@ public:
     void AskFor(const CInv& inv, int64_t doubleRequestDelay = 2 * 60 * 1000000);
     void RemoveAskFor(const uint256& hash);
 
-    void CloseSocketDisconnect();
+    void CloseSocketDisconnect(CConnman* connman);
 
     void copyStats(CNodeStats &stats);
 
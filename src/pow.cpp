@@ -12,6 +12,11 @@
 #include "chainparams.h"
 #include "primitives/block.h"
 #include "uint256.h"
+#include "hash.h"
+#include "sync.h"
+#include "txdb.h"
+#include "unordered_lru_cache.h"
+#include "saltedhasher.h"
 #include <math.h>
 
 unsigned int static KimotoGravityWell(const CBlockIndex* pindexLast, const Consensus::Params& params) {
@@ -285,10 +290,120 @@ unsigned int CalculateNextWorkRequired(const CBlockIndex* pindexLast, int64_t nF
     return bnNew.GetCompact();
 }
 
-bool CheckProofOfWork(uint256 hash, unsigned int nBits, const Consensus::Params& params, 
-	int64_t nBlockTime, int64_t nPrevBlockTime, int nPrevHeight, unsigned int nNonce, const CBlockIndex* pindexPrev, std::string sHeaderHex,
-	uint256 uRXKey, int iThreadID, bool bLoadingBlockIndex)
+// Recently verified results; older ones are read back from the block tree DB on demand
+static CCriticalSection cs_rxpow;
+static unordered_lru_cache<uint256, CRandomXPoWRecord, StaticSaltedHasher> mapRandomXPoW(RANDOMX_POW_CACHE_SIZE, RANDOMX_POW_CACHE_SIZE * 2);
+// Results not written to the block tree DB yet, kept apart from the LRU so that eviction cannot lose them.
+// The count is the number of flushes a result has waited for its header to be indexed.
+static std::map<uint256, std::pair<CRandomXPoWRecord, int> > mapRandomXPoWDirty;
+
+bool GetRandomXPoWRecord(const uint256& hashBlock, CRandomXPoWRecord& record, bool fReadDB)
+{
+    {
+        LOCK(cs_rxpow);
+        if (mapRandomXPoW.get(hashBlock, record))
+            return true;
+        auto it = mapRandomXPoWDirty.find(hashBlock);
+        if (it != mapRandomXPoWDirty.end()) {
+            record = it->second.first;
+            return true;
+        }
+    }
+    if (!fReadDB || !pblocktree || !pblocktree->ReadRandomXPoWRecord(hashBlock, record))
+        return false;
+    LOCK(cs_rxpow);
+    mapRandomXPoW.insert(hashBlock, record);
+    return true;
+}
+
+void AddRandomXPoWRecord(const uint256& hashBlock, const CRandomXPoWRecord& record)
+{
+    LOCK(cs_rxpow);
+    CRandomXPoWRecord recordKnown;
+    // Re-checks of a known header pass the same result in again; it is already in the DB or queued for it
+    if (mapRandomXPoW.get(hashBlock, recordKnown) && recordKnown.hashRXData == record.hashRXData && recordKnown.hashRandomX == record.hashRandomX)
+        return;
+    mapRandomXPoW.insert(hashBlock, record);
+    mapRandomXPoWDirty[hashBlock] = std::make_pair(record, 0);
+}
+
+void ForgetRandomXPoWRecord(const uint256& hashBlock)
+{
+    LOCK(cs_rxpow);
+    mapRandomXPoW.erase(hashBlock);
+    mapRandomXPoWDirty.erase(hashBlock);
+}
+
+void TakeRandomXPoWRecordsToFlush(std::vector<std::pair<uint256, CRandomXPoWRecord>>& vRecords)
+{
+    AssertLockHeld(cs_main);
+    LOCK(cs_rxpow);
+    for (auto it = mapRandomXPoWDirty.begin(); it != mapRandomXPoWDirty.end(); ) {
+        BlockMap::iterator mi = mapBlockIndex.find(it->first);
+        if (mi != mapBlockIndex.end()) {
+            if (!(mi->second->nStatus & BLOCK_FAILED_MASK))
+                vRecords.emplace_back(it->first, it->second.first);
+            it = mapRandomXPoWDirty.erase(it);
+        } else if (++it->second.second >= RANDOMX_POW_DIRTY_FLUSHES) {
+            // The header never made it into the index, it failed a later check
+            it = mapRandomXPoWDirty.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+static uint256 GetRandomXPoWDataHash(const CBlockHeader& block)
 {
+    return SerializeHash(std::make_pair(block.RandomXKey, block.RandomXHeader));
+}
+
+static bool HaveRandomXPoWRecord(const uint256& hash, const uint256& hashRXData, CRandomXPoWRecord& recordKnown)
+{
+    return GetRandomXPoWRecord(hash, recordKnown) && recordKnown.hashRXData == hashRXData;
+}
+
+// Returns the RandomX result for this header, from the verified record if we have one for the same RandomX data,
+// else from the raw RandomX output in pRandomXHash if the caller already computed it, else by hashing now
+static uint256 GetRandomXPoWHash(const uint256& hash, const CBlockHeader& block, int iThreadID, bool fPhaseII, bool fUseRecord, const uint256* pRandomXHash, CRandomXPoWRecord& record)
+{
+    record.hashRXData = GetRandomXPoWDataHash(block);
+    CRandomXPoWRecord recordKnown;
+    if (fUseRecord && HaveRandomXPoWRecord(hash, record.hashRXData, recordKnown))
+    {
+        record.hashRandomX = recordKnown.hashRandomX;
+        return record.hashRandomX;
+    }
+    if (pRandomXHash)
+        record.hashRandomX = fPhaseII ? *pRandomXHash : GetRandomXBlakeHash(*pRandomXHash, block.hashPrevBlock);
+    else
+        record.hashRandomX = fPhaseII ? GetRandomXHash2(block.RandomXHeader, block.RandomXKey, block.hashPrevBlock, iThreadID)
+            : GetRandomXHash(block.RandomXHeader, block.RandomXKey, block.hashPrevBlock, iThreadID);
+    return record.hashRandomX;
+}
+
+// RandomX performance: old headers are not re-hashed
+static bool IsPoWCheckSkipped(int64_t nPrevBlockTime, bool bLoadingBlockIndex)
+{
+	int64_t nElapsed = GetAdjustedTime() - nPrevBlockTime;
+	return (nElapsed > (60 * 60 * 8) && bLoadingBlockIndex && !fCheckPoWOnDisk) || (nElapsed > (60 * 60 * 24));
+}
+
+bool IsRandomXPoWHashNeeded(const CBlockHeader& block, const uint256& hash, const Consensus::Params& params,
+	int64_t nPrevBlockTime, int nPrevHeight, bool bLoadingBlockIndex)
+{
+	if (nPrevHeight < params.RANDOMX_HEIGHT || IsPoWCheckSkipped(nPrevBlockTime, bLoadingBlockIndex))
+		return false;
+	bool fUseRecord = !(bLoadingBlockIndex && fCheckPoWOnDisk);
+	CRandomXPoWRecord recordKnown;
+	return !(fUseRecord && HaveRandomXPoWRecord(hash, GetRandomXPoWDataHash(block), recordKnown));
+}
+
+bool CheckProofOfWork(const CBlockHeader& block, const uint256& hash, const Consensus::Params& params, 
+	int64_t nBlockTime, int64_t nPrevBlockTime, int nPrevHeight, int iThreadID, bool bLoadingBlockIndex, const uint256* pRandomXHash)
+{
+    unsigned int nBits = block.nBits;
+    unsigned int nNonce = block.nNonce;
     bool fNegative;
     bool fOverflow;
     arith_uint256 bnTarget;
@@ -296,10 +411,11 @@ bool CheckProofOfWork(uint256 hash, unsigned int nBits, const Consensus::Params&
     // Check range
     if (fNegative || bnTarget == 0 || fOverflow || bnTarget > UintToArith256(params.powLimit))
         return false;
-	// RandomX performance:
-	int64_t nElapsed = GetAdjustedTime() - nPrevBlockTime;
-	if ((nElapsed > (60 * 60 * 8) && bLoadingBlockIndex) || (nElapsed > (60 * 60 * 24)))
+	if (IsPoWCheckSkipped(nPrevBlockTime, bLoadingBlockIndex))
 		return true;
+	// Results recorded in the block index are trusted on disk reads unless -checkpowondisk is set
+	bool fUseRecord = !(bLoadingBlockIndex && fCheckPoWOnDisk);
+	CRandomXPoWRecord record;
 
 	if (nPrevHeight < params.EVOLUTION_CUTOVER_HEIGHT)
 	{
@@ -328,7 +444,7 @@ bool CheckProofOfWork(uint256 hash, unsigned int nBits, const Consensus::Params&
 		}
 		
 		
-		uint256 uBibleHash = BibleHashV2(hash, nBlockTime, nPrevBlockTime, true, nPrevHeight, sHeaderHex, uRXKey, pindexPrev->GetBlockHash(), iThreadID);
+		uint256 uBibleHash = BibleHashV2(hash, nBlockTime, nPrevBlockTime, true, nPrevHeight, block.RandomXData, block.RandomXKey, block.hashPrevBlock, iThreadID);
 		if (UintToArith256(uBibleHash) > bnTarget && nPrevBlockTime > 0) 
 		{
 			LogPrintf("\nCheckBlockHeader::ERROR-FAILED[1] height %f, nonce %f", nPrevHeight, nNonce);
@@ -338,24 +454,26 @@ bool CheckProofOfWork(uint256 hash, unsigned int nBits, const Consensus::Params&
 	else if (nPrevHeight >= params.RANDOMX_HEIGHT && nPrevHeight <= params.POOM_PHASEOUT_HEIGHT)
 	{
 		// RandomX Era:
-		uint256 rxhash = GetRandomXHash(sHeaderHex, uRXKey, pindexPrev->GetBlockHash(), iThreadID);
+		uint256 rxhash = GetRandomXPoWHash(hash, block, iThreadID, false, fUseRecord, pRandomXHash, record);
 		if (UintToArith256(ComputeRandomXTarget(rxhash, nPrevBlockTime, nBlockTime)) > bnTarget) 
 		{
 			LogPrintf("\nCheckBlockHeader::ERROR-FAILED[2] height %f, nonce %f", nPrevHeight, nNonce);
 			return error("CheckProofOfWork Failed:ERROR: RandomX high-hash, Height %f, PrevTime %f, Time %f, Nonce %f ", (double)nPrevHeight, 
 				(double)nPrevBlockTime, (double)nBlockTime, (double)nNonce);
 		}
+		AddRandomXPoWRecord(hash, record);
 	}
 	else if (nPrevHeight > params.POOM_PHASEOUT_HEIGHT)
 	{
 		// RandomX Era (Phase II):
-		uint256 rxhash = GetRandomXHash2(sHeaderHex, uRXKey, pindexPrev->GetBlockHash(), iThreadID);
+		uint256 rxhash = GetRandomXPoWHash(hash, block, iThreadID, true, fUseRecord, pRandomXHash, record);
 		if (UintToArith256(ComputeRandomXTarget(rxhash, nPrevBlockTime, nBlockTime)) > bnTarget) 
 		{
 			LogPrintf("\nCheckBlockHeader::ERROR-FAILED[4] height %f, nonce %f", nPrevHeight, nNonce);
      		return error("CheckProofOfWork Failed:ERROR: RandomX high-hash, Height %f, PrevTime %f, Time %f, Nonce %f ", (double)nPrevHeight, 
 				(double)nPrevBlockTime, (double)nBlockTime, (double)nNonce);
 		}
+		AddRandomXPoWRecord(hash, record);
 	}
 	
     return true;
@@ -7,20 +7,57 @@
 #define BITCOIN_POW_H
 
 #include "consensus/params.h"
+#include "serialize.h"
+#include "uint256.h"
 
 #include <stdint.h>
+#include <utility>
+#include <vector>
 
 class CBlockHeader;
 class CBlockIndex;
-class uint256;
+
+/** Number of verified RandomX results kept in memory; older ones are read from the block tree DB on demand */
+static const size_t RANDOMX_POW_CACHE_SIZE = 10000;
+/** Flushes an unwritten result waits for its header to enter the block index before it is dropped */
+static const int RANDOMX_POW_DIRTY_FLUSHES = 2;
+
+/** A verified RandomX proof of work result, stored next to the block index entry in CBlockTreeDB.
+ *  hashRXData commits to the RandomX key and header the result was computed from. */
+struct CRandomXPoWRecord
+{
+    uint256 hashRXData;
+    uint256 hashRandomX;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(hashRXData);
+        READWRITE(hashRandomX);
+    }
+};
 
 unsigned int GetNextWorkRequired(const CBlockIndex* pindexLast, const CBlockHeader *pblock, const Consensus::Params&);
 unsigned int CalculateNextWorkRequired(const CBlockIndex* pindexLast, int64_t nFirstBlockTime, const Consensus::Params&);
 
 
-/** Check whether a block hash satisfies the proof-of-work requirement specified by nBits */
-bool CheckProofOfWork(uint256 hash, unsigned int nBits, const Consensus::Params& params, 
-	int64_t nBlockTime, int64_t nPrevBlockTime, int nPrevHeight, unsigned int nNonce, const CBlockIndex* pindexPrev, std::string sHeaderHex,
-	uint256 uRXKey, int iThreadID, bool bLoadingBlockIndex);
+/** Check whether a block header (whose X11 hash is passed in) satisfies the proof-of-work requirement specified by its nBits */
+/** pRandomXHash optionally supplies the raw RandomX output for the header, already computed by the caller (e.g. in a batch) */
+bool CheckProofOfWork(const CBlockHeader& block, const uint256& hash, const Consensus::Params& params, 
+	int64_t nBlockTime, int64_t nPrevBlockTime, int nPrevHeight, int iThreadID, bool bLoadingBlockIndex, const uint256* pRandomXHash = NULL);
+
+/** Whether CheckProofOfWork would have to run RandomX for this header (RandomX era, recent enough, no verified record) */
+bool IsRandomXPoWHashNeeded(const CBlockHeader& block, const uint256& hash, const Consensus::Params& params,
+	int64_t nPrevBlockTime, int nPrevHeight, bool bLoadingBlockIndex);
+
+/** Look up / remember verified RandomX results by block hash so they are not recomputed.
+ *  A new result is kept as unwritten until the next block index flush, independently of the in-memory LRU. */
+bool GetRandomXPoWRecord(const uint256& hashBlock, CRandomXPoWRecord& record, bool fReadDB = true);
+void AddRandomXPoWRecord(const uint256& hashBlock, const CRandomXPoWRecord& record);
+void ForgetRandomXPoWRecord(const uint256& hashBlock);
+/** Move the unwritten results of headers in the block index (and not failed) into vRecords for CBlockTreeDB::WriteBatchSync.
+ *  Results of headers that are still not indexed after RANDOMX_POW_DIRTY_FLUSHES flushes are dropped.  Requires cs_main. */
+void TakeRandomXPoWRecordsToFlush(std::vector<std::pair<uint256, CRandomXPoWRecord>>& vRecords);
 
 #endif // BITCOIN_POW_H
@@ -73,6 +73,44 @@ uint256 CBlockHeader::GetHashBible() const
 
 
 
+void DecodeRandomXHeader(const std::string& sRandomXData, RandomXHeaderBytes& vchHeader)
+{
+	vchHeader.clear();
+	static const std::string sStart = "<rxheader>";
+	std::string::size_type nStart = sRandomXData.find(sStart);
+	if (nStart == std::string::npos)
+		return;
+	nStart += sStart.length();
+	std::string::size_type nEnd = sRandomXData.find("</rxheader>", nStart);
+	if (nEnd == std::string::npos)
+		return;
+	// Same rules as ParseHex: skip whitespace, stop at the first non-hex digit
+	const char* psz = sRandomXData.data() + nStart;
+	const char* pszEnd = sRandomXData.data() + nEnd;
+	while (psz < pszEnd)
+	{
+		while (psz < pszEnd && isspace(*psz))
+			psz++;
+		if (psz + 1 >= pszEnd)
+			break;
+		signed char c = HexDigit(*psz++);
+		if (c == (signed char)-1)
+			break;
+		unsigned char n = (c << 4);
+		c = HexDigit(*psz++);
+		if (c == (signed char)-1)
+			break;
+		n |= c;
+		vchHeader.push_back(n);
+	}
+}
+
+void CBlockHeader::SetRandomXHeader(const unsigned char* pbegin, const unsigned char* pend)
+{
+	RandomXHeader.assign(pbegin, pend);
+	RandomXData = "<rxheader>" + HexStr(pbegin, pend) + "</rxheader>";
+}
+
 std::string CBlock::ToString() const
 {
     std::stringstream s;
@@ -7,9 +7,17 @@
 #define BITCOIN_PRIMITIVES_BLOCK_H
 
 #include "primitives/transaction.h"
+#include "prevector.h"
 #include "serialize.h"
 #include "uint256.h"
 
+/** Inline capacity of the decoded RandomX header; a Monero hashing blob is around 76 bytes */
+static const unsigned int RANDOMX_HEADER_PREALLOC = 128;
+typedef prevector<RANDOMX_HEADER_PREALLOC, unsigned char> RandomXHeaderBytes;
+
+/** Decode the hex between <rxheader></rxheader> in a RandomXData string */
+void DecodeRandomXHeader(const std::string& sRandomXData, RandomXHeaderBytes& vchHeader);
+
 
 /** Nodes collect new transactions into a block, hash them into a hash tree,
  * and scan through nonce values to make the block's hash satisfy proof-of-work
@@ -30,6 +38,8 @@ public:
     uint32_t nNonce;
 	uint256 RandomXKey;
 	std::string RandomXData;
+	// memory only: RandomXData's header decoded to binary, kept in sync by SetRandomXData/SetRandomXHeader and deserialization
+	RandomXHeaderBytes RandomXHeader;
 
     CBlockHeader()
     {
@@ -50,6 +60,8 @@ public:
 		{
 			READWRITE(RandomXKey);
 			READWRITE(RandomXData);
+			if (ser_action.ForRead())
+				DecodeRandomXHeader(RandomXData, RandomXHeader);
 		}
     }
 
@@ -62,9 +74,19 @@ public:
         nBits = 0;
         nNonce = 0;
 		RandomXData = std::string();
+		RandomXHeader.clear();
 		RandomXKey.SetNull();
     }
 
+	void SetRandomXData(const std::string& sRandomXData)
+	{
+		RandomXData = sRandomXData;
+		DecodeRandomXHeader(RandomXData, RandomXHeader);
+	}
+
+	// Sets the binary header and re-encodes the wire form (<rxheader>HEX</rxheader>) from it
+	void SetRandomXHeader(const unsigned char* pbegin, const unsigned char* pend);
+
     bool IsNull() const
     {
         return (nBits == 0);
@@ -126,6 +148,7 @@ public:
         block.nBits          = nBits;
         block.nNonce         = nNonce;
 		block.RandomXData    = RandomXData;
+		block.RandomXHeader  = RandomXHeader;
 		block.RandomXKey     = RandomXKey;
 		return block;
     }
@@ -60,6 +60,43 @@ std::string CTxOut::ToString() const
     return strprintf("CTxOut(nValue=%d.%08d, scriptPubKey=%s)", nValue / COIN, nValue % COIN, HexStr(scriptPubKey).substr(0, 30));
 }
 
+CTxMessage::CTxMessage(const std::string& sMessageIn) : sMessage(sMessageIn), nTypes(TXMESSAGE_NONE)
+{
+	if (sMessage.empty())
+		return;
+	if (sMessage.find("<MT>GSCTransmission") != std::string::npos)
+		nTypes |= TXMESSAGE_GSC_TRANSMISSION;
+	if (sMessage.find("<MT>CPK") != std::string::npos)
+		nTypes |= TXMESSAGE_CPK;
+	if (sMessage.find("<MT>DWS") != std::string::npos)
+		nTypes |= TXMESSAGE_DWS;
+	if (sMessage.find("<MT>DASHSTAKE") != std::string::npos)
+		nTypes |= TXMESSAGE_DASHSTAKE;
+	if (sMessage.find("<MT>ABN</MT>") != std::string::npos)
+		nTypes |= TXMESSAGE_ABN;
+
+	// Index the first occurrence of every <tag>, closing it the same way ExtractXML does
+	for (std::string::size_type loc = sMessage.find('<'); loc != std::string::npos; loc = sMessage.find('<', loc + 1))
+	{
+		if (loc + 1 < sMessage.size() && sMessage[loc + 1] == '/')
+			continue;
+		std::string::size_type locName = sMessage.find('>', loc + 1);
+		if (locName == std::string::npos)
+			break;
+		std::string sTag = sMessage.substr(loc + 1, locName - loc - 1);
+		if (mapTags.count(sTag))
+			continue;
+		std::string::size_type loc_end = sMessage.find("</" + sTag + ">", loc + 3);
+		mapTags.emplace(sTag, (loc_end == std::string::npos || loc_end <= locName) ? std::string() : sMessage.substr(locName + 1, loc_end - locName - 1));
+	}
+}
+
+std::string CTxMessage::GetTag(const std::string& sTag) const
+{
+	auto it = mapTags.find(sTag);
+	return it == mapTags.end() ? std::string() : it->second;
+}
+
 CMutableTransaction::CMutableTransaction() : nVersion(CTransaction::CURRENT_VERSION), nType(TRANSACTION_NORMAL), nLockTime(0) {}
 CMutableTransaction::CMutableTransaction(const CTransaction& tx) : nVersion(tx.nVersion), nType(tx.nType), vin(tx.vin), vout(tx.vout), nLockTime(tx.nLockTime), vExtraPayload(tx.vExtraPayload) {}
 
@@ -113,6 +150,21 @@ unsigned int CTransaction::GetTotalSize() const
     return ::GetSerializeSize(*this, SER_NETWORK, PROTOCOL_VERSION);
 }
 
+const CTxMessage& CTransaction::GetParsedTxMessage() const
+{
+    std::shared_ptr<const CTxMessage> p = std::atomic_load(&ptxMessage);
+    if (p)
+        return *p;
+    std::string sMsg;
+    for (const CTxOut& txout : vout)
+        sMsg += txout.sTxOutMessage;
+    std::shared_ptr<const CTxMessage> pNew = std::make_shared<const CTxMessage>(sMsg);
+    // Another thread may have parsed it meanwhile; keep whichever was stored first so references stay valid
+    if (std::atomic_compare_exchange_strong(&ptxMessage, &p, pNew))
+        return *pNew;
+    return *p;
+}
+
 std::string CTransaction::ToString() const
 {
     std::string str;
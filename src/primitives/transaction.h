@@ -11,6 +11,8 @@
 #include "serialize.h"
 #include "uint256.h"
 #include <math.h>   // For floor
+#include <map>
+#include <memory>
 
 /** Transaction types */
 enum {
@@ -218,6 +220,36 @@ public:
 
 struct CMutableTransaction;
 
+/** BiblePay message types, found by their <MT> marker; a message may carry more than one */
+enum TxMessageType
+{
+	TXMESSAGE_NONE = 0,
+	TXMESSAGE_GSC_TRANSMISSION = (1 << 0),
+	TXMESSAGE_CPK = (1 << 1),
+	TXMESSAGE_DWS = (1 << 2),
+	TXMESSAGE_DASHSTAKE = (1 << 3),
+	TXMESSAGE_ABN = (1 << 4),
+};
+
+/**
+ * The vout messages of a transaction, concatenated and parsed in one pass.
+ * GetTag(x) returns what ExtractXML(sMessage, "<x>", "</x>") would, without rescanning the message.
+ */
+class CTxMessage
+{
+public:
+	std::string sMessage;
+	int nTypes;
+
+	explicit CTxMessage(const std::string& sMessageIn);
+
+	bool IsType(TxMessageType nType) const { return (nTypes & nType) != 0; }
+	std::string GetTag(const std::string& sTag) const;
+
+private:
+	std::map<std::string, std::string> mapTags;
+};
+
 /** The basic transaction that is broadcasted on the network and contained in
  * blocks.  A transaction can contain multiple inputs and outputs.
  */
@@ -253,6 +285,8 @@ private:
 	/** Memory only. */
     const uint256 hash;
     uint256 ComputeHash() const;
+	/** Memory only. Parsed vout messages, built on first use */
+	mutable std::shared_ptr<const CTxMessage> ptxMessage;
 
 public:
     /** Construct a CTransaction that qualifies as IsNull() */
@@ -345,27 +379,22 @@ public:
 		return false;
     }
 
-	std::string GetTxMessage() const
+	const CTxMessage& GetParsedTxMessage() const;
+
+	const std::string& GetTxMessage() const
 	{
-		std::string sMsg;
-		for (unsigned int i = 0; i < vout.size(); i++) 
-		{
-			sMsg += vout[i].sTxOutMessage;
-		}
-		return sMsg;
+		return GetParsedTxMessage().sMessage;
 	}
 
 	bool IsGSCTransmission() const
 	{
 		// Is this a GSC-Stake-Transmission?
-		std::string sMyData = GetTxMessage();
-		return (sMyData.find("<MT>GSCTransmission") != std::string::npos);
+		return GetParsedTxMessage().IsType(TXMESSAGE_GSC_TRANSMISSION);
 	}
 
 	std::string GetCampaignName() const
 	{
-		std::string sData = GetTxMessage();
-		std::string sCampaign = ExtractXMLValue(sData, "<gsccampaign>", "</gsccampaign>");
+		std::string sCampaign = GetParsedTxMessage().GetTag("gsccampaign");
 		if (sCampaign.empty()) 
 			sCampaign = "Unknown";
 		return sCampaign;
@@ -374,27 +403,23 @@ public:
 	bool IsCPKAssociation() const
 	{
 		// Is this a Christian Public Keypair association tx?
-		std::string sMyData = GetTxMessage();
-		return (sMyData.find("<MT>CPK") != std::string::npos);
+		return GetParsedTxMessage().IsType(TXMESSAGE_CPK);
 	}
 
 	bool IsWhaleStake() const
 	{
-		std::string sMyData = GetTxMessage();
-		return (sMyData.find("<MT>DWS") != std::string::npos);
+		return GetParsedTxMessage().IsType(TXMESSAGE_DWS);
 	}
 
 	bool IsDashStake() const
 	{
-		std::string sMyData = GetTxMessage();
-		return (sMyData.find("<MT>DASHSTAKE") != std::string::npos);
+		return GetParsedTxMessage().IsType(TXMESSAGE_DASHSTAKE);
 	}
 
 	bool IsABN() const
 	{
 		// Is this an Anti-Bot-Net Transaction?
-		std::string sMyData = GetTxMessage();
-		return (sMyData.find("<MT>ABN</MT>") != std::string::npos);
+		return GetParsedTxMessage().IsType(TXMESSAGE_ABN);
 	}
 
     friend bool operator==(const CTransaction& a, const CTransaction& b)
@@ -6,87 +6,350 @@
 #include "randomx_bbp.h"
 #include "hash.h"
 
-static std::map<int, randomx_cache*> rxcache;
-static std::map<int, randomx_vm*> myvm;
-static std::map<int, bool> fInitialized;
-static std::map<int, bool> fBusy;
-static std::map<int, uint256> msGlobalKey;
+#include <list>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
 
-void init(uint256 uKey, int iThreadID)
+static bool fRandomXFastMode = DEFAULT_RANDOMX_FASTMODE;
+static int nRandomXInitThreads = 1;
+
+// One entry per RandomX key.  The Argon2 cache is built once (under csInit) and is then read-only, so any number of VMs
+// may hash against it concurrently.  In fast mode the ~2GB dataset is added only while the key is hot (see IsHotRandomXKey)
+// and dropped again once it has cooled down and no VM is checked out.  Idle VMs are parked in vFreeVM for reuse;
+// flags, dataset and vFreeVM change together under csVM, so the parked VMs always match the current mode.
+struct RandomXCacheEntry
 {
-	std::vector<unsigned char> hashKey = std::vector<unsigned char>(uKey.begin(), uKey.end());
-	randomx_flags flags = randomx_get_flags();
-	rxcache[iThreadID] = randomx_alloc_cache(flags);
-	randomx_init_cache(rxcache[iThreadID], hashKey.data(), hashKey.size());
-	myvm[iThreadID] = randomx_create_vm(flags, rxcache[iThreadID], NULL);
-	fInitialized[iThreadID] = true;
-	msGlobalKey[iThreadID] = uKey;
+	uint256 uKey;
+	randomx_flags flags;
+	randomx_cache* cache;
+	randomx_dataset* dataset;
+	// The dataset allocation failed once; stay in light mode for this key
+	bool fDatasetFailed;
+	int nRefs;
+	std::mutex csInit;
+	std::mutex csVM;
+	std::vector<randomx_vm*> vFreeVM;
+
+	RandomXCacheEntry(const uint256& uKeyIn) : uKey(uKeyIn), flags(randomx_get_flags()), cache(NULL), dataset(NULL), fDatasetFailed(false), nRefs(0) {}
+
+	~RandomXCacheEntry()
+	{
+		for (auto vm : vFreeVM)
+			randomx_destroy_vm(vm);
+		if (dataset)
+			randomx_release_dataset(dataset);
+		if (cache)
+			randomx_release_cache(cache);
+	}
+};
+
+static std::mutex cs_rxpool;
+static std::map<uint256, std::shared_ptr<RandomXCacheEntry>> mapRXCache;
+// Most recently used key first
+static std::list<uint256> lRXCacheLRU;
+static size_t nRXMaxCachedKeys = DEFAULT_RANDOMX_CACHED_KEYS;
+// The keys that get the full dataset in fast mode: the one being mined on and the one of the active tip
+static uint256 uRXMiningKey;
+static uint256 uRXTipKey;
+
+// Caller must hold cs_rxpool
+static bool IsHotRandomXKey(const uint256& uKey)
+{
+	return fRandomXFastMode && !uKey.IsNull() && (uKey == uRXMiningKey || uKey == uRXTipKey);
 }
 
-void destroy(int iThreadID)
+// Drop the least recently used caches that nobody holds a VM on, and the datasets of idle keys that are no longer hot.
+// Caller must hold cs_rxpool; what is dropped is returned so the (large) deallocation can happen after the lock is released.
+static std::vector<std::shared_ptr<RandomXCacheEntry>> TrimRandomXCache(std::vector<randomx_dataset*>& vDatasets)
 {
-	randomx_destroy_vm(myvm[iThreadID]);
-	randomx_release_cache(rxcache[iThreadID]);
-	fInitialized[iThreadID] = false;
-	fBusy[iThreadID] = false;
+	std::vector<std::shared_ptr<RandomXCacheEntry>> vEvicted;
+	auto it = lRXCacheLRU.end();
+	while (mapRXCache.size() > nRXMaxCachedKeys && it != lRXCacheLRU.begin())
+	{
+		--it;
+		auto mi = mapRXCache.find(*it);
+		if (mi != mapRXCache.end() && mi->second->nRefs == 0)
+		{
+			vEvicted.push_back(mi->second);
+			mapRXCache.erase(mi);
+			it = lRXCacheLRU.erase(it);
+		}
+	}
+	for (auto& item : mapRXCache)
+	{
+		RandomXCacheEntry& entry = *item.second;
+		if (entry.nRefs > 0 || IsHotRandomXKey(entry.uKey))
+			continue;
+		// Nobody holds a VM, so nobody is building either (Acquire takes a reference before csInit)
+		std::unique_lock<std::mutex> lockVM(entry.csVM);
+		if (!entry.dataset)
+			continue;
+		for (auto vm : entry.vFreeVM)
+			randomx_destroy_vm(vm);
+		entry.vFreeVM.clear();
+		vDatasets.push_back(entry.dataset);
+		entry.dataset = NULL;
+		entry.flags = (randomx_flags)(entry.flags & ~RANDOMX_FLAG_FULL_MEM);
+	}
+	return vEvicted;
 }
 
-uint256 RandomX_Hash(uint256 hash, uint256 uKey, int iThreadID)
+static void ReleaseRandomXDatasets(const std::vector<randomx_dataset*>& vDatasets)
 {
-		if (fInitialized[iThreadID] && msGlobalKey[iThreadID] != uKey)
+	for (auto dataset : vDatasets)
+		randomx_release_dataset(dataset);
+}
+
+// Expand the cache into the full dataset, splitting the item range across nRandomXInitThreads threads.
+// Returns NULL if the ~2GB allocation fails, in which case the caller stays in light mode.
+static randomx_dataset* BuildRandomXDataset(randomx_cache* cache, randomx_flags flags)
+{
+	randomx_dataset* dataset = randomx_alloc_dataset(flags);
+	if (!dataset)
+		return NULL;
+	unsigned long nItems = randomx_dataset_item_count();
+	unsigned long nThreads = nRandomXInitThreads < 1 ? 1 : nRandomXInitThreads;
+	unsigned long nPerThread = nItems / nThreads;
+	std::vector<std::thread> vThreads;
+	for (unsigned long i = 1; i < nThreads; i++)
+	{
+		vThreads.emplace_back(randomx_init_dataset, dataset, cache, i * nPerThread, (i + 1 == nThreads) ? nItems - i * nPerThread : nPerThread);
+	}
+	// The calling thread takes the first slice
+	randomx_init_dataset(dataset, cache, 0, nThreads == 1 ? nItems : nPerThread);
+	for (auto& t : vThreads)
+		t.join();
+	return dataset;
+}
+
+static std::shared_ptr<RandomXCacheEntry> AcquireRandomXCache(const uint256& uKey, bool fMining)
+{
+	std::shared_ptr<RandomXCacheEntry> entry;
+	bool fFullMem;
+	{
+		std::unique_lock<std::mutex> lock(cs_rxpool);
+		if (fMining)
+			uRXMiningKey = uKey;
+		auto mi = mapRXCache.find(uKey);
+		if (mi == mapRXCache.end())
+		{
+			entry = std::make_shared<RandomXCacheEntry>(uKey);
+			mapRXCache.emplace(uKey, entry);
+		}
+		else
 		{
-			destroy(iThreadID);
+			entry = mi->second;
+			lRXCacheLRU.remove(uKey);
 		}
+		lRXCacheLRU.push_front(uKey);
+		entry->nRefs++;
+		fFullMem = IsHotRandomXKey(uKey);
+	}
 
-		if (!fInitialized[iThreadID] || uKey != msGlobalKey[iThreadID])
+	// Build outside the pool lock so that callers on other keys are not stalled behind Argon2
+	std::unique_lock<std::mutex> lockInit(entry->csInit);
+	if (!entry->cache)
+	{
+		randomx_cache* cache = randomx_alloc_cache(entry->flags);
+		if (!cache)
 		{
-			init(uKey, iThreadID);
+			std::unique_lock<std::mutex> lock(cs_rxpool);
+			entry->nRefs--;
+			throw std::runtime_error("RandomX: unable to allocate cache");
 		}
-		std::vector<unsigned char> hashIn = std::vector<unsigned char>(hash.begin(), hash.end());
-		char *hashOut1 = (char*)malloc(RANDOMX_HASH_SIZE + 1);
-		fBusy[iThreadID] = true;
-		randomx_calculate_hash(myvm[iThreadID], hashIn.data(), hashIn.size(), hashOut1);
-		std::vector<unsigned char> data1(hashOut1, hashOut1 + RANDOMX_HASH_SIZE);
-		free(hashOut1);
-		fBusy[iThreadID] = false;
-		return uint256(data1);
+		randomx_init_cache(cache, uKey.begin(), uKey.size());
+		entry->cache = cache;
+	}
+	if (fFullMem && !entry->dataset && !entry->fDatasetFailed)
+	{
+		// A key verified in light mode earlier (e.g. during header sync) is upgraded once it becomes hot
+		randomx_dataset* dataset = BuildRandomXDataset(entry->cache, entry->flags);
+		std::unique_lock<std::mutex> lockVM(entry->csVM);
+		if (dataset)
+		{
+			for (auto vm : entry->vFreeVM)
+				randomx_destroy_vm(vm);
+			entry->vFreeVM.clear();
+			entry->dataset = dataset;
+			entry->flags = (randomx_flags)(entry->flags | RANDOMX_FLAG_FULL_MEM);
+		}
+		else
+		{
+			entry->fDatasetFailed = true;
+		}
+	}
+	return entry;
 }
 
-uint256 RandomX_Hash(std::vector<unsigned char> data0, uint256 uKey, int iThreadID)
+static void ReleaseRandomXCache(std::shared_ptr<RandomXCacheEntry>& entry)
 {
-		if (fInitialized[iThreadID] && msGlobalKey[iThreadID] != uKey)
-		{
-			destroy(iThreadID);
-		}
+	std::vector<std::shared_ptr<RandomXCacheEntry>> vEvicted;
+	std::vector<randomx_dataset*> vDatasets;
+	{
+		std::unique_lock<std::mutex> lock(cs_rxpool);
+		entry->nRefs--;
+		vEvicted = TrimRandomXCache(vDatasets);
+	}
+	entry.reset();
+	ReleaseRandomXDatasets(vDatasets);
+}
+
+void RandomX_SetMaxCachedKeys(int nKeys)
+{
+	std::vector<std::shared_ptr<RandomXCacheEntry>> vEvicted;
+	std::vector<randomx_dataset*> vDatasets;
+	{
+		std::unique_lock<std::mutex> lock(cs_rxpool);
+		nRXMaxCachedKeys = nKeys < 1 ? 1 : nKeys;
+		vEvicted = TrimRandomXCache(vDatasets);
+	}
+	ReleaseRandomXDatasets(vDatasets);
+}
+
+int RandomX_GetMaxCachedKeys()
+{
+	std::unique_lock<std::mutex> lock(cs_rxpool);
+	return (int)nRXMaxCachedKeys;
+}
+
+void RandomX_SetFastMode(bool fFastMode, int nInitThreads)
+{
+	std::unique_lock<std::mutex> lock(cs_rxpool);
+	fRandomXFastMode = fFastMode;
+	nRandomXInitThreads = nInitThreads;
+}
+
+void RandomX_SetTipKey(const uint256& uKey)
+{
+	std::vector<std::shared_ptr<RandomXCacheEntry>> vEvicted;
+	std::vector<randomx_dataset*> vDatasets;
+	{
+		std::unique_lock<std::mutex> lock(cs_rxpool);
+		if (uRXTipKey == uKey)
+			return;
+		uRXTipKey = uKey;
+		vEvicted = TrimRandomXCache(vDatasets);
+	}
+	ReleaseRandomXDatasets(vDatasets);
+}
 
-		if (!fInitialized[iThreadID] || uKey != msGlobalKey[iThreadID])
+CRandomXVM::CRandomXVM(const uint256& uKey, bool fMining) : entry(AcquireRandomXCache(uKey, fMining)), vm(NULL), fFullMem(false)
+{
+	std::unique_lock<std::mutex> lock(entry->csVM);
+	fFullMem = entry->dataset != NULL;
+	if (!entry->vFreeVM.empty())
+	{
+		vm = entry->vFreeVM.back();
+		entry->vFreeVM.pop_back();
+		return;
+	}
+	vm = randomx_create_vm(entry->flags, entry->cache, entry->dataset);
+	if (!vm)
+	{
+		lock.unlock();
+		ReleaseRandomXCache(entry);
+		throw std::runtime_error("RandomX: unable to create vm");
+	}
+}
+
+CRandomXVM::~CRandomXVM()
+{
+	{
+		std::unique_lock<std::mutex> lock(entry->csVM);
+		if (fFullMem == (entry->dataset != NULL))
 		{
-			init(uKey, iThreadID);
+			entry->vFreeVM.push_back(vm);
+			vm = NULL;
 		}
-		char *hashOut0 = (char*)malloc(RANDOMX_HASH_SIZE + 1);
-		fBusy[iThreadID] = true;
-		randomx_calculate_hash(myvm[iThreadID], data0.data(), data0.size(), hashOut0);
-		std::vector<unsigned char> data1(hashOut0, hashOut0 + RANDOMX_HASH_SIZE);
-		free(hashOut0);
-		fBusy[iThreadID] = false;
-		return uint256(data1);
+	}
+	if (vm)
+		randomx_destroy_vm(vm);
+	ReleaseRandomXCache(entry);
+}
+
+const uint256& CRandomXVM::GetKey() const
+{
+	return entry->uKey;
+}
+
+void CRandomXVM::Hash(const void* pInput, size_t nInputSize, void* pOutput)
+{
+	randomx_calculate_hash(vm, pInput, nInputSize, pOutput);
+}
+
+uint256 CRandomXVM::Hash(const std::vector<unsigned char>& vInput)
+{
+	uint256 hashOut;
+	Hash(vInput.data(), vInput.size(), hashOut.begin());
+	return hashOut;
+}
+
+void CRandomXVM::HashFirst(const void* pInput, size_t nInputSize)
+{
+	randomx_calculate_hash_first(vm, pInput, nInputSize);
+}
+
+void CRandomXVM::HashNext(const void* pNextInput, size_t nNextInputSize, void* pOutput)
+{
+	randomx_calculate_hash_next(vm, pNextInput, nNextInputSize, pOutput);
+}
+
+void CRandomXVM::HashLast(void* pOutput)
+{
+	randomx_calculate_hash_last(vm, pOutput);
+}
+
+void CRandomXVM::HashBatch(const RandomXInput* pInputs, size_t nCount, uint256* pOutputs)
+{
+	if (nCount == 0)
+		return;
+	if (nCount == 1)
+	{
+		Hash(pInputs[0].pData, pInputs[0].nSize, pOutputs[0].begin());
+		return;
+	}
+	HashFirst(pInputs[0].pData, pInputs[0].nSize);
+	for (size_t i = 1; i < nCount; i++)
+		HashNext(pInputs[i].pData, pInputs[i].nSize, pOutputs[i - 1].begin());
+	HashLast(pOutputs[nCount - 1].begin());
+}
+
+uint256 RandomX_Hash(uint256 hash, uint256 uKey)
+{
+	CRandomXVM vm(uKey);
+	uint256 hashOut;
+	vm.Hash(hash.begin(), hash.size(), hashOut.begin());
+	return hashOut;
 }
 
+uint256 RandomX_Hash(const std::vector<unsigned char>& data0, uint256 uKey)
+{
+	CRandomXVM vm(uKey);
+	return vm.Hash(data0);
+}
+
+uint256 RandomX_Hash(const unsigned char* pData, size_t nSize, uint256 uKey)
+{
+	CRandomXVM vm(uKey);
+	uint256 hashOut;
+	vm.Hash(pData, nSize, hashOut.begin());
+	return hashOut;
+}
 
 uint256 RandomX_Hash(std::vector<unsigned char> data0, std::vector<unsigned char> datakey)
 {
-	int iThreadID = 101;
+	// Arbitrary length keys are not pooled
 	randomx_flags flags = randomx_get_flags();
-	rxcache[iThreadID] = randomx_alloc_cache(flags);
-	randomx_init_cache(rxcache[iThreadID], datakey.data(), datakey.size());
-	myvm[iThreadID] = randomx_create_vm(flags, rxcache[iThreadID], NULL);
-	char *hashOut0 = (char*)malloc(RANDOMX_HASH_SIZE + 1);
-	randomx_calculate_hash(myvm[iThreadID], data0.data(), data0.size(), hashOut0);
-	std::vector<unsigned char> data1(hashOut0, hashOut0 + RANDOMX_HASH_SIZE);
-	free(hashOut0);
-	randomx_destroy_vm(myvm[iThreadID]);
-	randomx_release_cache(rxcache[iThreadID]);
-	return uint256(data1);
+	randomx_cache* rxc = randomx_alloc_cache(flags);
+	randomx_init_cache(rxc, datakey.data(), datakey.size());
+	randomx_vm* vm1 = randomx_create_vm(flags, rxc, NULL);
+	uint256 hashOut;
+	randomx_calculate_hash(vm1, data0.data(), data0.size(), hashOut.begin());
+	randomx_destroy_vm(vm1);
+	randomx_release_cache(rxc);
+	return hashOut;
 }
 
 
@@ -99,11 +362,9 @@ uint256 RandomX_SlowHash(std::vector<unsigned char> data0, uint256 uKey)
 	rxc = randomx_alloc_cache(flags);
 	randomx_init_cache(rxc, hashKey.data(), hashKey.size());
 	vm1 = randomx_create_vm(flags, rxc, NULL);
-	char *hashOut0 = (char*)malloc(RANDOMX_HASH_SIZE + 1);
-	randomx_calculate_hash(vm1, data0.data(), data0.size(), hashOut0);
-	std::vector<unsigned char> data1(hashOut0, hashOut0 + RANDOMX_HASH_SIZE);
+	uint256 hashOut;
+	randomx_calculate_hash(vm1, data0.data(), data0.size(), hashOut.begin());
 	randomx_destroy_vm(vm1);
 	randomx_release_cache(rxc);
-	return uint256(data1);
+	return hashOut;
 }
-
@@ -8,8 +8,73 @@
 #include "crypto/RandomX/src/randomx.h"
 #include "uint256.h"
 
-uint256 RandomX_Hash(uint256 hash, uint256 uKey, int iThreadID);
-uint256 RandomX_Hash(std::vector<unsigned char> data0, uint256 uKey, int iThreadID);
+#include <memory>
+#include <vector>
+
+/**
+ * Number of RandomX keys whose Argon2 caches (~256MB each) are kept resident.
+ * In fast mode at most two keys (the mining key and the active tip's key) also hold a ~2GB dataset on top of that,
+ * so the worst case is about DEFAULT_RANDOMX_CACHED_KEYS * 256MB + 2 * 2GB (4.5GB with the defaults).
+ */
+static const int DEFAULT_RANDOMX_CACHED_KEYS = 2;
+/** Default for -randomxfastmode */
+static const bool DEFAULT_RANDOMX_FASTMODE = false;
+
+struct RandomXCacheEntry;
+
+/** One input to CRandomXVM::HashBatch */
+struct RandomXInput
+{
+	const void* pData;
+	size_t nSize;
+};
+
+/**
+ * A RandomX virtual machine checked out of the shared pool for one key.
+ * The cache (and in fast mode the full dataset) for a key is built once and shared read-only by
+ * every VM checked out against it; the VM is handed back to the pool (not destroyed) when this object goes out of scope.
+ * Only the mining key (fMining) and the active tip's key (RandomX_SetTipKey) get a dataset; every other key is light mode.
+ */
+class CRandomXVM
+{
+public:
+	explicit CRandomXVM(const uint256& uKey, bool fMining = false);
+	~CRandomXVM();
+
+	CRandomXVM(const CRandomXVM&) = delete;
+	CRandomXVM& operator=(const CRandomXVM&) = delete;
+
+	const uint256& GetKey() const;
+	void Hash(const void* pInput, size_t nInputSize, void* pOutput);
+	uint256 Hash(const std::vector<unsigned char>& vInput);
+	// Pipelined hashing: HashNext outputs the hash of the previous input while starting on the next one, HashLast ends the run
+	void HashFirst(const void* pInput, size_t nInputSize);
+	void HashNext(const void* pNextInput, size_t nNextInputSize, void* pOutput);
+	void HashLast(void* pOutput);
+	// Hash nCount inputs into pOutputs[0..nCount) without allocating, pipelined through HashFirst/HashNext/HashLast
+	void HashBatch(const RandomXInput* pInputs, size_t nCount, uint256* pOutputs);
+
+private:
+	std::shared_ptr<RandomXCacheEntry> entry;
+	randomx_vm* vm;
+	// Whether vm was created against the dataset; a VM from before an upgrade or downgrade is not pooled again
+	bool fFullMem;
+};
+
+/** Set how many keyed caches are retained after their last VM is released (LRU) */
+void RandomX_SetMaxCachedKeys(int nKeys);
+int RandomX_GetMaxCachedKeys();
+/**
+ * Enable full-dataset (RANDOMX_FLAG_FULL_MEM) hashing for the mining key and the tip key.  Each of those ~2GB datasets is
+ * built with nInitThreads threads and dropped once its key is neither mined on nor the tip's any more.
+ */
+void RandomX_SetFastMode(bool fFastMode, int nInitThreads);
+/** The RandomX key of the active tip, called whenever the tip changes */
+void RandomX_SetTipKey(const uint256& uKey);
+
+uint256 RandomX_Hash(uint256 hash, uint256 uKey);
+uint256 RandomX_Hash(const std::vector<unsigned char>& data0, uint256 uKey);
+uint256 RandomX_Hash(const unsigned char* pData, size_t nSize, uint256 uKey);
 uint256 RandomX_Hash(std::vector<unsigned char> data0, std::vector<unsigned char> datakey);
 uint256 RandomX_SlowHash(std::vector<unsigned char> data0, uint256 uKey);
 
@@ -0,0 +1,112 @@
+// Copyright (c) 2014-2019 The Dash Core Developers, The DAC Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_RINGBUFFER_H
+#define BITCOIN_RINGBUFFER_H
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Bounded lock-free queue (D. Vyukov's array queue): any number of threads may push and pop without taking a lock.
+ * Every cell carries a sequence number telling whether it is free for the push of a given round or holds the value
+ * for the pop of that round, so producers and consumers only contend on the two position counters.
+ * The capacity is rounded up to a power of two.  TryPush fails when the buffer is full; TryPop fails when it is empty,
+ * or when the oldest push has claimed its cell but not finished writing it yet.
+ */
+template <typename T>
+class CLockFreeRingBuffer
+{
+public:
+    explicit CLockFreeRingBuffer(size_t nCapacityIn) : nCapacity(RoundUp(nCapacityIn)), nMask(nCapacity - 1), cells(new Cell[nCapacity])
+    {
+        for (size_t i = 0; i < nCapacity; i++)
+            cells[i].nSequence.store(i, std::memory_order_relaxed);
+        nPushPos.store(0, std::memory_order_relaxed);
+        nPopPos.store(0, std::memory_order_relaxed);
+    }
+    CLockFreeRingBuffer(const CLockFreeRingBuffer&) = delete;
+    CLockFreeRingBuffer& operator=(const CLockFreeRingBuffer&) = delete;
+
+    bool TryPush(T&& value)
+    {
+        Cell* cell;
+        size_t nPos = nPushPos.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells[nPos & nMask];
+            size_t nSequence = cell->nSequence.load(std::memory_order_acquire);
+            intptr_t nDiff = (intptr_t)nSequence - (intptr_t)nPos;
+            if (nDiff == 0) {
+                if (nPushPos.compare_exchange_weak(nPos, nPos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (nDiff < 0) {
+                return false;
+            } else {
+                nPos = nPushPos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(value);
+        cell->nSequence.store(nPos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool TryPop(T& value)
+    {
+        Cell* cell;
+        size_t nPos = nPopPos.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells[nPos & nMask];
+            size_t nSequence = cell->nSequence.load(std::memory_order_acquire);
+            intptr_t nDiff = (intptr_t)nSequence - (intptr_t)(nPos + 1);
+            if (nDiff == 0) {
+                if (nPopPos.compare_exchange_weak(nPos, nPos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (nDiff < 0) {
+                return false;
+            } else {
+                nPos = nPopPos.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(cell->value);
+        cell->value = T();
+        cell->nSequence.store(nPos + nMask + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t Capacity() const { return nCapacity; }
+
+    /** Number of queued values; only a hint while other threads push or pop */
+    size_t SizeApprox() const
+    {
+        size_t nPop = nPopPos.load(std::memory_order_relaxed);
+        size_t nPush = nPushPos.load(std::memory_order_relaxed);
+        return nPush > nPop ? nPush - nPop : 0;
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> nSequence;
+        T value;
+    };
+
+    static size_t RoundUp(size_t n)
+    {
+        size_t nResult = 2;
+        while (nResult < n)
+            nResult <<= 1;
+        return nResult;
+    }
+
+    const size_t nCapacity;
+    const size_t nMask;
+    std::unique_ptr<Cell[]> cells;
+    // Kept on separate cache lines, so that producers and the consumer do not invalidate each other's counter
+    alignas(64) std::atomic<size_t> nPushPos;
+    alignas(64) std::atomic<size_t> nPopPos;
+};
+
+#endif // BITCOIN_RINGBUFFER_H
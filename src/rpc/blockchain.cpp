@@ -2048,6 +2048,13 @@ UniValue exec(const JSONRPCRequest& request)
 		bool fDryRun = nDryRun == 0 ? true : false;
 		std::string sTXID;
 		if (!fDryRun)
+			sTXID = BIPFS_GetResumeTXID(sDirPath, sWebPath, false, nTargetDensity, nDurationDays, fEncrypted);
+		if (!sTXID.empty())
+		{
+			// An interrupted upload with the same parameters was already paid for: send only its missing parts
+			results.push_back(Pair("Resumed", sTXID));
+		}
+		else if (!fDryRun)
 		{
 			// Persist TXID
 			DACResult dDry = BIPFS_UploadFile(sDirPath, sWebPath, sTXID, nTargetDensity, nDurationDays, true, fEncrypted);
@@ -2116,6 +2123,13 @@ UniValue exec(const JSONRPCRequest& request)
 
 		std::string sTXID;
 		if (!fDryRun)
+			sTXID = BIPFS_GetResumeTXID(sDirPath, sWebPath, true, nTargetDensity, nDurationDays, fEncrypted);
+		if (!sTXID.empty())
+		{
+			// An interrupted upload with the same parameters was already paid for: send only its missing parts
+			results.push_back(Pair("Resumed", sTXID));
+		}
+		else if (!fDryRun)
 		{
 			// Persist TXID
 			DACResult dDry = BIPFS_UploadFolder(sDirPath, sWebPath, sTXID, nTargetDensity, nDurationDays, true, fEncrypted);
@@ -3119,7 +3133,7 @@ UniValue exec(const JSONRPCRequest& request)
 		}
 
 		results.push_back(Pair("cpid", sCPID));
-		Researcher r = mvResearchers[sCPID];
+		Researcher r = GetResearcher(sCPID);
 		if (!r.found && sCPID.length() != 32)
 		{
 			results.push_back(Pair("Error", "Not Linked.  First, you must link your researcher CPID in the chain using 'exec associate'."));
@@ -3197,7 +3211,7 @@ UniValue exec(const JSONRPCRequest& request)
 
 			std::string sRevKey = ReverseHex(sKey);
 			uint256 uKey = uint256S("0x" + sRevKey);
-			uint256 uRXMined = RandomX_Hash(v, uKey, 90);
+			uint256 uRXMined = RandomX_Hash(v, uKey);
 
 			std::vector<unsigned char> vch(160);
 			CVectorWriter ss(SER_NETWORK, PROTOCOL_VERSION, vch, 0);
@@ -3216,7 +3230,7 @@ UniValue exec(const JSONRPCRequest& request)
 		std::string sRevKey = ReverseHex(sKey);
 		uint256 uKey = uint256S("0x" + sRevKey);
 		std::vector<unsigned char> v = ParseHex(sHeader);
-		uint256 uRX3 = RandomX_Hash(v, uKey, 99);
+		uint256 uRX3 = RandomX_Hash(v, uKey);
 		results.push_back(Pair("hash2", uRX3.GetHex()));
 		uint256 uRX4 = HashBlake(v.begin(), v.end());
 		results.push_back(Pair("hashBlakeInSz", (int)v.size()));
@@ -371,7 +371,7 @@ UniValue getblockforstratum(const JSONRPCRequest& request)
    	results.push_back(Pair("merkleroot", blockX.hashMerkleRoot.GetHex()));
 	results.push_back(Pair("key", blockX.RandomXKey.GetHex()));
 	
-	std::string rxHeader = ExtractXML(blockX.RandomXData, "<rxheader>", "</rxheader>");
+	std::string rxHeader = HexStr(blockX.RandomXHeader.begin(), blockX.RandomXHeader.end());
 		
 	results.push_back(Pair("header", rxHeader));
 
@@ -1853,7 +1853,7 @@ UniValue hexblocktocoinbase(const JSONRPCRequest& request)
 	// RandomX
 	if (dDetails == 1)
 	{
-		results.push_back(Pair("rxheader", ExtractXML(block.RandomXData, "<rxheader>", "</rxheader>")));
+		results.push_back(Pair("rxheader", HexStr(block.RandomXHeader.begin(), block.RandomXHeader.end())));
 		results.push_back(Pair("rxkey", block.RandomXKey.GetHex()));
 	} 
 	return results;
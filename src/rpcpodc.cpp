@@ -11,6 +11,7 @@
 #include "masternode-sync.h"
 #include "smartcontract-server.h"
 #include "rpcpog.h"
+#include "appcache.h"
 #include <boost/lexical_cast.hpp>
 #include <boost/algorithm/string/case_conv.hpp> // for to_lower()
 #include <boost/algorithm/string.hpp> // for trim()
@@ -192,20 +193,59 @@ bool VerifySigner(std::string sXML)
 	return fValid;
 }
 
+/**
+ * Block time and amount of outputs that have already been spent, so coin-age (ABN weight, GSC points, coin-age votes) does
+ * not read the same transactions from disk again.  Guarded by cs_main; an entry is only used while its block is in the
+ * active chain.
+ */
+struct CoinAgeInput
+{
+	int64_t nTime;
+	CAmount nAmount;
+	const CBlockIndex* pindex;
+};
+static const size_t MAX_COIN_AGE_INPUT_CACHE_SIZE = 200000;
+static std::map<COutPoint, CoinAgeInput> mapCoinAgeInputs;
+
 bool GetTransactionTimeAndAmount(uint256 txhash, int nVout, int64_t& nTime, CAmount& nAmount)
 {
+	COutPoint outpoint(txhash, nVout);
+	LOCK(cs_main);
+	// Unspent outputs: the UTXO set has the amount and the height of the block that created them
+	Coin coin;
+	if (pcoinsTip && pcoinsTip->GetCoin(outpoint, coin) && (int)coin.nHeight <= chainActive.Height())
+	{
+		nTime = chainActive[coin.nHeight]->GetBlockTime();
+		nAmount = coin.out.nValue;
+		return true;
+	}
+
+	std::map<COutPoint, CoinAgeInput>::const_iterator it = mapCoinAgeInputs.find(outpoint);
+	if (it != mapCoinAgeInputs.end() && chainActive.Contains(it->second.pindex))
+	{
+		nTime = it->second.nTime;
+		nAmount = it->second.nAmount;
+		return true;
+	}
+
 	uint256 hashBlock = uint256();
 	CTransactionRef tx2;
 	if (GetTransaction(txhash, tx2, Params().GetConsensus(), hashBlock, true))
 	{
-		   BlockMap::iterator mi = mapBlockIndex.find(hashBlock);
-           if (mi != mapBlockIndex.end() && (*mi).second) 
-		   {
-              CBlockIndex* pMNIndex = (*mi).second; 
-			  nTime = pMNIndex->GetBlockTime();
-		      nAmount = tx2->vout[nVout].nValue;
-			  return true;
-		   }
+		BlockMap::iterator mi = mapBlockIndex.find(hashBlock);
+		if (mi != mapBlockIndex.end() && (*mi).second) 
+		{
+			CBlockIndex* pMNIndex = (*mi).second; 
+			nTime = pMNIndex->GetBlockTime();
+			nAmount = tx2->vout[nVout].nValue;
+			if (chainActive.Contains(pMNIndex))
+			{
+				if (mapCoinAgeInputs.size() >= MAX_COIN_AGE_INPUT_CACHE_SIZE)
+					mapCoinAgeInputs.clear();
+				mapCoinAgeInputs[outpoint] = CoinAgeInput{nTime, nAmount, pMNIndex};
+			}
+			return true;
+		}
 	}
 	return false;
 }
@@ -242,11 +282,12 @@ int GetWCGMemberID(std::string sMemberName, std::string sAuthCode, double& nPoin
 
 Researcher GetResearcherByID(int nID)
 {
-    BOOST_FOREACH(const PAIRTYPE(const std::string, Researcher)& myResearcher, mvResearchers)
+	std::shared_ptr<const std::map<std::string, Researcher>> researchers = GetResearchers();
+    BOOST_FOREACH(const PAIRTYPE(const std::string, Researcher)& myResearcher, *researchers)
     {
 		if (myResearcher.second.found && myResearcher.second.id == nID)
 		{
-			return mvResearchers[myResearcher.second.cpid];
+			return myResearcher.second;
 		}
 	}
 	Researcher r;
@@ -266,15 +307,16 @@ std::map<std::string, Researcher> GetPayableResearchers()
 	// The CPID is Unbanked if the RAC < 250
 	// Unbanked researchers do not need to post daily stake collateral
 	// Banked researchers do need to post daily stake collateral:  RAC^1.30 in COIN-AGE per day
+	std::shared_ptr<const std::map<std::string, Researcher>> researchers = GetResearchers();
 	std::vector<std::tuple<int64_t, std::string, std::string> > vFIFO;
-	vFIFO.reserve(mvResearchers.size() * 2);
+	vFIFO.reserve(researchers->size() * 2);
 	std::map<std::string, Researcher> r;
 	std::map<std::string, std::string> cpid_reverse_lookup;
-	for (auto ii : mvApplicationCache)
+	for (const std::string& sSection : mvApplicationCache.GetSectionNames("CPK-WCG"))
 	{
-		if (Contains(ii.first.first, "CPK-WCG"))
+		for (const auto& ii : mvApplicationCache.GetSection(sSection))
 		{
-			std::string sData = ii.second.first;
+			const std::string& sData = ii.second.first;
 			int64_t nLockTime = ii.second.second;
 			std::string cpid = GetCPIDElementByData(sData, 8);
 			std::string sCPK = GetCPIDElementByData(sData, 0);
@@ -298,7 +340,7 @@ std::map<std::string, Researcher> GetPayableResearchers()
 	}
 	
 	// Payable Researchers
-	BOOST_FOREACH(const PAIRTYPE(const std::string, Researcher)& myResearcher, mvResearchers)
+	BOOST_FOREACH(const PAIRTYPE(const std::string, Researcher)& myResearcher, *researchers)
     {
 		if (myResearcher.second.found)
 		{
@@ -3,6 +3,9 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "rpcpog.h"
+#include "appcache.h"
+#include "ctpl.h"
+#include "txdb.h"
 #include "spork.h"
 #include "util.h"
 #include "utilmoneystr.h"
@@ -26,6 +29,10 @@
 #include <boost/algorithm/string.hpp> // for trim()
 #include <boost/date_time/posix_time/posix_time.hpp> // for StringToUnixTime()
 #include <math.h>       /* round, floor, ceil, trunc */
+#include <algorithm>
+#include <deque>
+#include <list>
+#include <future>
 #include <boost/asio.hpp>
 #include <boost/thread.hpp>
 #include <openssl/crypto.h>
@@ -47,6 +54,11 @@
 #include "wallet/wallet.h"
 #include <sstream>
 #include "randomx_bbp.h"
+#include "crypto/aes.h"
+#include "crypto/hmac_sha256.h"
+#include "crypto/sha256.h"
+#include "random.h"
+#include "support/cleanse.h"
 
 #ifdef ENABLE_WALLET
 extern CWallet* pwalletMain;
@@ -192,8 +204,7 @@ std::string GetElement(std::string sIn, std::string sDelimiter, int iPos)
 std::string GetSporkValue(std::string sKey)
 {
 	boost::to_upper(sKey);
-    std::pair<std::string, int64_t> v = mvApplicationCache[std::make_pair("SPORK", sKey)];
-	return v.first;
+	return mvApplicationCache.Read("SPORK", sKey).first;
 }
 
 double GetSporkDouble(std::string sName, double nDefault)
@@ -209,7 +220,7 @@ std::map<std::string, std::string> GetSporkMap(std::string sPrimaryKey, std::str
 	boost::to_upper(sPrimaryKey);
 	boost::to_upper(sSecondaryKey);
 	std::string sDelimiter = "|";
-    std::pair<std::string, int64_t> v = mvApplicationCache[std::make_pair(sPrimaryKey, sSecondaryKey)];
+	CAppCacheEntry v = mvApplicationCache.Read(sPrimaryKey, sSecondaryKey);
 	std::vector<std::string> vSporks = Split(v.first, sDelimiter);
 	std::map<std::string, std::string> mSporkMap;
 	for (int i = 0; i < vSporks.size(); i++)
@@ -302,9 +313,9 @@ std::map<std::string, CPK> GetChildMap(std::string sGSCObjType)
 	std::map<std::string, CPK> mCPKMap;
 	boost::to_upper(sGSCObjType);
 	int i = 0;
-	for (auto ii : mvApplicationCache)
+	for (const std::string& sSection : mvApplicationCache.GetSectionNames(sGSCObjType))
 	{
-		if (Contains(ii.first.first, sGSCObjType))
+		for (const auto& ii : mvApplicationCache.GetSection(sSection))
 		{
 			CPK k = GetCPK(ii.second.first);
 			i++;
@@ -318,17 +329,14 @@ std::map<std::string, CPK> GetGSCMap(std::string sGSCObjType, std::string sSearc
 {
 	std::map<std::string, CPK> mCPKMap;
 	boost::to_upper(sGSCObjType);
-	for (auto ii : mvApplicationCache)
+	for (const auto& ii : mvApplicationCache.GetSection(sGSCObjType))
 	{
-    	if (ii.first.first == sGSCObjType)
+		CPK k = GetCPK(ii.second.first);
+		if (!k.sAddress.empty() && k.fValid)
 		{
-			CPK k = GetCPK(ii.second.first);
-			if (!k.sAddress.empty() && k.fValid)
+			if ((!sSearch.empty() && (sSearch == k.sAddress || sSearch == k.sNickName)) || sSearch.empty())
 			{
-				if ((!sSearch.empty() && (sSearch == k.sAddress || sSearch == k.sNickName)) || sSearch.empty())
-				{
-					mCPKMap.insert(std::make_pair(k.sAddress, k));
-				}
+				mCPKMap.insert(std::make_pair(k.sAddress, k));
 			}
 		}
 	}
@@ -344,39 +352,35 @@ CAmount CAmountFromValue(const UniValue& value)
     return amount;
 }
 
-static CCriticalSection csReadWait;
-std::string ReadCache(std::string sSection, std::string sKey)
+// Cache sections and keys are stored in upper case; only make a copy when the caller's string is not already upper case
+static const std::string& UpperCacheKey(const std::string& s, std::string& sUpper)
+{
+	if (std::none_of(s.begin(), s.end(), [](char c) { return c >= 'a' && c <= 'z'; }))
+		return s;
+	sUpper = boost::to_upper_copy(s);
+	return sUpper;
+}
+
+std::string ReadCache(const std::string& sSection, const std::string& sKey)
 {
-	LOCK(csReadWait);
-	std::string sLookupSection = sSection;
-	std::string sLookupKey = sKey;
-	boost::to_upper(sLookupSection);
-	boost::to_upper(sLookupKey);
-	// NON-CRITICAL TODO : Find a way to eliminate this to_upper while we transition to non-financial transactions
-	if (sLookupSection.empty() || sLookupKey.empty())
+	if (sSection.empty() || sKey.empty())
 		return std::string();
-	std::pair<std::string, int64_t> t = mvApplicationCache[std::make_pair(sLookupSection, sLookupKey)];
-	return t.first;
+	std::string sUpperSection, sUpperKey;
+	return mvApplicationCache.Read(UpperCacheKey(sSection, sUpperSection), UpperCacheKey(sKey, sUpperKey)).first;
 }
 
-std::string ReadCacheWithMaxAge(std::string sSection, std::string sKey, int64_t nSeconds)
+std::string ReadCacheWithMaxAge(const std::string& sSection, const std::string& sKey, int64_t nSeconds)
 {
-	LOCK(csReadWait);
-	
-	std::string sLookupSection = sSection;
-	std::string sLookupKey = sKey;
-	boost::to_upper(sLookupSection);
-	boost::to_upper(sLookupKey);
-	int64_t nAge = GetCacheEntryAge(sLookupSection, sLookupKey);
-	
+	if (sSection.empty() || sKey.empty())
+		return std::string();
+	std::string sUpperSection, sUpperKey;
+	CAppCacheEntry t = mvApplicationCache.Read(UpperCacheKey(sSection, sUpperSection), UpperCacheKey(sKey, sUpperKey));
+	int64_t nAge = GetAdjustedTime() - t.second;
 	if (nAge > nSeconds)
 	{
 		// Invalidate the cache
 		return std::string();
 	}
-	if (sLookupSection.empty() || sLookupKey.empty())
-		return std::string();
-	std::pair<std::string, int64_t> t = mvApplicationCache[std::make_pair(sLookupSection, sLookupKey)];
 	return t.first;
 }
 
@@ -1046,34 +1050,29 @@ bool CheckNonce(bool f9000, unsigned int nNonce, int nPrevHeight, int64_t nPrevB
 	return (nNonce > nMaxNonce) ? false : true;
 }
 
-static CCriticalSection csClearWait;
-void ClearCache(std::string sSection)
+void ClearCache(const std::string& sSection)
 {
-	LOCK(csClearWait);
-	boost::to_upper(sSection);
-	for (auto ii : mvApplicationCache) 
-	{
-		if (ii.first.first == sSection)
-		{
-			mvApplicationCache[std::make_pair(ii.first.first, ii.first.second)] = std::make_pair(std::string(), 0);
-		}
-	}
+	std::string sUpperSection;
+	mvApplicationCache.ClearSection(UpperCacheKey(sSection, sUpperSection));
 }
 
-static CCriticalSection csWriteWait;
-void WriteCache(std::string sSection, std::string sKey, std::string sValue, int64_t locktime, bool IgnoreCase)
+// While a block is being indexed (see IndexBlockMessages) every cache write made on this thread is also recorded here
+static thread_local std::vector<std::pair<CMessageIndexKey, CMessageIndexValue>>* pMessageIndexRecorder = NULL;
+static thread_local int nMessageIndexHeight = 0;
+
+void WriteCache(const std::string& sSection, const std::string& sKey, const std::string& sValue, int64_t locktime, bool IgnoreCase)
 {
-	LOCK(csWriteWait);
 	if (sSection.empty() || sKey.empty()) return;
-	if (IgnoreCase)
+	std::string sUpperSection, sUpperKey;
+	const std::string& sWriteSection = IgnoreCase ? UpperCacheKey(sSection, sUpperSection) : sSection;
+	const std::string& sWriteKey = IgnoreCase ? UpperCacheKey(sKey, sUpperKey) : sKey;
+	// Record Cache Entry timestamp
+	mvApplicationCache.Write(sWriteSection, sWriteKey, sValue, locktime);
+	if (pMessageIndexRecorder)
 	{
-		boost::to_upper(sSection);
-		boost::to_upper(sKey);
+		CMessageIndexKey key(sWriteSection, sWriteKey, nMessageIndexHeight, pMessageIndexRecorder->size());
+		pMessageIndexRecorder->push_back(std::make_pair(key, CMessageIndexValue(sValue, locktime)));
 	}
-	std::pair<std::string, std::string> s1 = std::make_pair(sSection, sKey);
-	// Record Cache Entry timestamp
-	std::pair<std::string, int64_t> v1 = std::make_pair(sValue, locktime);
-	mvApplicationCache[s1] = v1;
 }
 
 void WriteCacheDouble(std::string sKey, double dValue)
@@ -1234,11 +1233,11 @@ UniValue GetDataList(std::string sType, int iMaxAgeInDays, int& iSpecificEntry,
 	ret.push_back(Pair("DataList",sType));
 	int iPos = 0;
 	int iTotalRecords = 0;
-	for (auto ii : mvApplicationCache) 
+	for (const std::string& sSection : mvApplicationCache.GetSectionNames(sType))
 	{
-		if (ii.first.first == sType || Contains(ii.first.first, sType))
+		for (const auto& ii : mvApplicationCache.GetSection(sSection))
 		{
-			std::pair<std::string, int64_t> v = mvApplicationCache[std::make_pair(ii.first.first, ii.first.second)];
+			const CAppCacheEntry& v = ii.second;
 			int64_t nTimestamp = v.second;
 			if (nTimestamp > nEpoch || nTimestamp == 0)
 			{
@@ -1248,14 +1247,14 @@ UniValue GetDataList(std::string sType, int iMaxAgeInDays, int& iSpecificEntry,
 				std::string sTimestamp = TimestampToHRDate((double)nTimestamp);
 				if (!sSearch.empty())
 				{
-					if (boost::iequals(ii.first.first, sSearch) || Contains(ii.first.second, sSearch))
+					if (boost::iequals(sSection, sSearch) || Contains(ii.first, sSearch))
 					{
-						ret.push_back(Pair(ii.first.second + " (" + sTimestamp + ")", v.first));
+						ret.push_back(Pair(ii.first + " (" + sTimestamp + ")", v.first));
 					}
 				}
 				else
 				{
-					ret.push_back(Pair(ii.first.second + " (" + sTimestamp + ")", v.first));
+					ret.push_back(Pair(ii.first + " (" + sTimestamp + ")", v.first));
 				}
 				iPos++;
 			}
@@ -1325,35 +1324,62 @@ UniValue ContributionReport()
 	return ret;
 }
 
+static std::string GetPrayerSnapshotPath()
+{
+	std::string sSuffix = fProd ? "_prod" : "_testnet";
+	return GetSANDirectory2() + "appcache" + sSuffix + ".dat";
+}
+
+// Records in the last full snapshot, and records appended to it since
+static size_t nPrayerSnapshotRecords = 0;
+static size_t nPrayerAppendedRecords = 0;
+
 void SerializePrayersToFile(int nHeight)
 {
 	if (nHeight < 100) return;
-	std::string sSuffix = fProd ? "_prod" : "_testnet";
-	std::string sTarget = GetSANDirectory2() + "prayers2" + sSuffix;
-	FILE *outFile = fopen(sTarget.c_str(), "w");
-	LogPrintf("Serializing Prayers... %f ", GetAdjustedTime());
-	for (auto ii : mvApplicationCache) 
-	{
-		std::pair<std::string, int64_t> v = mvApplicationCache[std::make_pair(ii.first.first, ii.first.second)];
-	   	int64_t nTimestamp = v.second;
-		std::string sValue = v.first;
-		bool bSkip = false;
-		if (ii.first.first == "MESSAGE" && (sValue == std::string() || sValue == std::string()))
-			bSkip = true;
-		if (!bSkip)
-		{
-			std::string sRow = RoundToString(nTimestamp, 0) + "<colprayer>" + RoundToString(nHeight, 0) + "<colprayer>" + ii.first.first + ";" 
-				+ ii.first.second + "<colprayer>" + sValue + "<rowprayer>\r\n";
-			fputs(sRow.c_str(), outFile);
-		}
+	// Entries written from here on are appended to this snapshot block by block (see AppendPrayersToFile)
+	mvApplicationCache.StartJournal();
+	mvApplicationCache.TakeJournal();
+	std::vector<CAppCacheRecord> vRecords = mvApplicationCache.GetAll();
+	vRecords.erase(std::remove_if(vRecords.begin(), vRecords.end(),
+		[](const CAppCacheRecord& r) { return r.sSection == "MESSAGE" && r.entry.first.empty(); }), vRecords.end());
+	LogPrintf("Serializing Prayers... %f records at height %f ", vRecords.size(), nHeight);
+	nPrayerSnapshotRecords = vRecords.size();
+	nPrayerAppendedRecords = 0;
+	QueueAppCacheSnapshot(GetPrayerSnapshotPath(), std::move(vRecords), nHeight, true);
+}
+
+void AppendPrayersToFile(int nHeight)
+{
+	if (nHeight < 100 || !mvApplicationCache.IsJournaling()) return;
+	// Compact the snapshot once a day, or as soon as the journal overflowed or the appended chunks outgrow the full dump
+	if (nHeight % BLOCKS_PER_DAY == 0 || mvApplicationCache.IsJournalOverflowed())
+	{
+		SerializePrayersToFile(nHeight);
+		return;
 	}
-	LogPrintf("...Done Serializing Prayers... %f ", GetAdjustedTime());
-    fclose(outFile);
+	std::vector<CAppCacheRecord> vRecords = mvApplicationCache.TakeJournal();
+	if (nPrayerAppendedRecords + vRecords.size() > std::max(nPrayerSnapshotRecords, MAX_APPCACHE_JOURNAL / 10))
+	{
+		SerializePrayersToFile(nHeight);
+		return;
+	}
+	nPrayerAppendedRecords += vRecords.size();
+	if (!vRecords.empty())
+		QueueAppCacheSnapshot(GetPrayerSnapshotPath(), std::move(vRecords), nHeight, false);
 }
 
 int DeserializePrayersFromFile()
 {
 	LogPrintf("\nDeserializing prayers from file %f", GetAdjustedTime());
+	int nSnapshotRecords = 0;
+	int nSnapshotHeight = LoadAppCacheSnapshot(GetPrayerSnapshotPath(), mvApplicationCache, nSnapshotRecords);
+	if (nSnapshotHeight >= 0)
+	{
+		LogPrintf(" Loaded %f records from the prayer snapshot at height %f - %f\n", nSnapshotRecords, nSnapshotHeight, GetAdjustedTime());
+		return nSnapshotHeight;
+	}
+	// Fall back to the text format written by older versions
 	std::string sSuffix = fProd ? "_prod" : "_testnet";
 	std::string sSource = GetSANDirectory2() + "prayers2" + sSuffix;
 
@@ -1529,24 +1555,25 @@ bool CheckBusinessObjectSig(TxMessage t)
 }
 
 
-TxMessage GetTxMessage(std::string sMessage, int64_t nTime, int iPosition, std::string sTxId, double dAmount, double dFoundationDonation, int nHeight)
+TxMessage GetTxMessage(const CTxMessage& txMessage, int64_t nTime, int iPosition, std::string sTxId, double dAmount, double dFoundationDonation, int nHeight)
 {
+	const std::string& sMessage = txMessage.sMessage;
 	TxMessage t;
-	t.sMessageType = ExtractXML(sMessage,"<MT>","</MT>");
-	t.sMessageKey  = ExtractXML(sMessage,"<MK>","</MK>");
-	t.sMessageValue= ExtractXML(sMessage,"<MV>","</MV>");
-	t.sSig         = ExtractXML(sMessage,"<MS>","</MS>");
-	t.sNonce       = ExtractXML(sMessage,"<NONCE>","</NONCE>");
+	t.sMessageType = txMessage.GetTag("MT");
+	t.sMessageKey  = txMessage.GetTag("MK");
+	t.sMessageValue= txMessage.GetTag("MV");
+	t.sSig         = txMessage.GetTag("MS");
+	t.sNonce       = txMessage.GetTag("NONCE");
 	t.nNonce       = cdbl(t.sNonce, 0);
-	t.sSporkSig    = ExtractXML(sMessage,"<SPORKSIG>","</SPORKSIG>");
-	t.sIPFSHash    = ExtractXML(sMessage,"<IPFSHASH>", "</IPFSHASH>");
-	t.sBOSig       = ExtractXML(sMessage,"<BOSIG>", "</BOSIG>");
-	t.sBOSigner    = ExtractXML(sMessage,"<BOSIGNER>", "</BOSIGNER>");
-	t.sIPFSHash    = ExtractXML(sMessage,"<ipfshash>", "</ipfshash>");
-	t.sIPFSSize    = ExtractXML(sMessage,"<ipfssize>", "</ipfssize>");
-	t.sCPIDSig     = ExtractXML(sMessage,"<cpidsig>","</cpidsig>");
+	t.sSporkSig    = txMessage.GetTag("SPORKSIG");
+	t.sIPFSHash    = txMessage.GetTag("IPFSHASH");
+	t.sBOSig       = txMessage.GetTag("BOSIG");
+	t.sBOSigner    = txMessage.GetTag("BOSIGNER");
+	t.sIPFSHash    = txMessage.GetTag("ipfshash");
+	t.sIPFSSize    = txMessage.GetTag("ipfssize");
+	t.sCPIDSig     = txMessage.GetTag("cpidsig");
 	t.sCPID        = GetElement(t.sCPIDSig, ";", 0);
-	t.sPODCTasks   = ExtractXML(sMessage, "<PODC_TASKS>", "</PODC_TASKS>");
+	t.sPODCTasks   = txMessage.GetTag("PODC_TASKS");
 	t.sTxId        = sTxId;
 	t.nTime        = nTime;
 	t.dAmount      = dAmount;
@@ -1693,15 +1720,15 @@ bool IsCPKWL(std::string sCPK, std::string sNN)
 	return (Contains(sWL, sNN));
 }
 
-void MemorizePrayer(std::string sMessage, int64_t nTime, double dAmount, int iPosition, std::string sTxID, int nHeight, double dFoundationDonation, double dAge, double dMinCoinAge)
+void MemorizePrayer(const CTxMessage& txMessage, int64_t nTime, double dAmount, int iPosition, std::string sTxID, int nHeight, double dFoundationDonation, double dAge, double dMinCoinAge)
 {
-	if (sMessage.empty()) return;
-	TxMessage t = GetTxMessage(sMessage, nTime, iPosition, sTxID, dAmount, dFoundationDonation, nHeight);
-	std::string sDiary = ExtractXML(sMessage, "<diary>", "</diary>");
+	if (txMessage.sMessage.empty()) return;
+	TxMessage t = GetTxMessage(txMessage, nTime, iPosition, sTxID, dAmount, dFoundationDonation, nHeight);
+	std::string sDiary = txMessage.GetTag("diary");
 	
 	if (!sDiary.empty())
 	{
-		std::string sCPK = ExtractXML(sMessage, "<abncpk>", "</abncpk>");
+		std::string sCPK = txMessage.GetTag("abncpk");
 		CPK oPrimary = GetCPKFromProject("cpk", sCPK);
 		std::string sNickName = Caption(oPrimary.sNickName, 10);
 		bool fWL = IsCPKWL(sCPK, sNickName);
@@ -1724,6 +1751,182 @@ void MemorizePrayer(std::string sMessage, int64_t nTime, double dAmount, int iPo
 	}
 }
 
+// Number of blocks below which MemorizeBlockChainPrayers stays on the calling thread
+static const size_t PRAYER_REBUILD_PIPELINE_MIN_BLOCKS = 1000;
+static const int MAX_PRAYER_REBUILD_THREADS = 8;
+// How many blocks each worker may have read ahead of the committer
+static const size_t PRAYER_REBUILD_BLOCKS_PER_THREAD = 16;
+
+// What MemorizeBlockChainPrayers needs from one transaction that does not depend on the cache
+struct PrayerTx
+{
+	double dTotalSent = 0;
+	double dFoundationDonation = 0;
+	std::string sDWS;
+	std::string sDashStake;
+};
+
+struct PrayerBlock
+{
+	CBlock block;
+	int nHeight = 0;
+	bool fRead = false;
+	std::vector<PrayerTx> vTx;
+};
+
+// Extract the per-transaction data of a block.  Touches nothing but the block, so it may run on any thread.
+static void PreparePrayerBlock(PrayerBlock& b, const Consensus::Params& consensusParams)
+{
+	b.vTx.resize(b.block.vtx.size());
+	for (unsigned int n = 0; n < b.block.vtx.size(); n++)
+	{
+		PrayerTx& p = b.vTx[n];
+		const CTxMessage& txMessage = b.block.vtx[n]->GetParsedTxMessage();
+		const std::string& sPrayer = txMessage.sMessage;
+		// Length of the message up to and including the last burn output (DWS data must precede the burn)
+		std::string::size_type nBurnPrefix = std::string::npos;
+		std::string::size_type nPrefix = 0;
+		for (unsigned int i = 0; i < b.block.vtx[n]->vout.size(); i++)
+		{
+			nPrefix += b.block.vtx[n]->vout[i].sTxOutMessage.size();
+			double dAmount = b.block.vtx[n]->vout[i].nValue / COIN;
+			p.dTotalSent += dAmount;
+			// The following 3 lines are used for PODS (Proof of document storage); allowing persistence of paid documents in IPFS
+			std::string sPK = PubKeyToAddress(b.block.vtx[n]->vout[i].scriptPubKey);
+			if (sPK == consensusParams.FoundationAddress || sPK == consensusParams.FoundationPODSAddress)
+			{
+				p.dFoundationDonation += dAmount;
+			}
+			if (sPK == consensusParams.BurnAddress)
+				nBurnPrefix = nPrefix;
+		}
+		// This is for Dynamic-Whale-Staking (DWS):
+		if (nBurnPrefix != std::string::npos)
+		{
+			if (nBurnPrefix == sPrayer.size())
+			{
+				p.sDWS = txMessage.GetTag("dws");
+				p.sDashStake = txMessage.GetTag("dashstake");
+			}
+			else
+			{
+				std::string sBurnMessage = sPrayer.substr(0, nBurnPrefix);
+				p.sDWS = ExtractXML(sBurnMessage, "<dws>", "</dws>");
+				p.sDashStake = ExtractXML(sBurnMessage, "<dashstake>", "</dashstake>");
+			}
+		}
+	}
+}
+
+static void ReadPrayerBlock(PrayerBlock& b, const CBlockIndex* pindex, const Consensus::Params& consensusParams)
+{
+	b.nHeight = pindex->nHeight;
+	b.fRead = ReadBlockFromDisk(b.block, pindex, consensusParams);
+	if (b.fRead)
+		PreparePrayerBlock(b, consensusParams);
+}
+
+// Apply one prepared block to the cache.  Must be called in height order from a single thread.
+static void CommitPrayerBlock(const PrayerBlock& b)
+{
+	if (!b.fRead)
+		return;
+	const CBlock& block = b.block;
+	if (b.nHeight % 25000 == 0)
+		LogPrintf(" MBCP %f @ %f, ", b.nHeight, GetAdjustedTime());
+	for (unsigned int n = 0; n < block.vtx.size(); n++)
+	{
+		const PrayerTx& p = b.vTx[n];
+		const CTxMessage& txMessage = block.vtx[n]->GetParsedTxMessage();
+		// Memorize each DWS txid-vout and burn amount (later the sancs will audit each one to ensure they are mature and in the main chain). 
+		// NOTE:  This data is automatically persisted during shutdowns and reboots and loaded efficiently into memory.
+		if (!p.sDWS.empty())
+		{
+			WriteCache("dws-burn", block.vtx[n]->GetHash().GetHex(), p.sDWS, GetAdjustedTime());
+			RegisterWhaleStake(block.vtx[n]);
+		}
+		if (!p.sDashStake.empty())
+		{
+			WriteCache("dash-burn", block.vtx[n]->GetHash().GetHex(), p.sDashStake, GetAdjustedTime());
+			RegisterDashStake(block.vtx[n]);
+		}
+		// For Coin-Age voting:  This vote cannot be falsified because we require the user to vote with coin-age (they send the stake back to their own address):
+		std::string sGobjectID = txMessage.GetTag("gobject");
+		std::string sType = txMessage.GetTag("MT");
+		std::string sGSCCampaign = txMessage.GetTag("gsccampaign");
+		std::string sCPK = txMessage.GetTag("abncpk");
+		if (!sGobjectID.empty() && sType == "GSCTransmission" && sGSCCampaign == "COINAGEVOTE" && !sCPK.empty())
+		{
+			// This user voted on a poll with coin-age:
+			CTransactionRef tx = block.vtx[n];
+			double nCoinAge = GetVINCoinAge(block.GetBlockTime(), tx, false);
+			//Todo make this pass the age into 
+			// At this point we can do two cool things to extend the sanctuary gobject vote:
+			// 1: Increment the vote count by distinct voter (1 vote per distinct GobjectID-CPK), and, 2: increment the vote coin-age-tally by coin-age spent (sum(coinage(gobjectid-cpk))):
+			std::string sOutcome = txMessage.GetTag("outcome");
+			if (sOutcome == "YES" || sOutcome == "NO" || sOutcome == "ABSTAIN")
+			{
+				WriteCache("coinage-vote-count-" + sGobjectID, sCPK, sOutcome, GetAdjustedTime());
+				// Note, if someone votes more than once, we only count it once (see above line), but, we do tally coin-age (within the duration of the poll start-end).  This means a whale who accidentally voted with 10% of the coin-age on Monday may vote with the rest of their 90% of coin age as long as the poll is not expired and the coin-age will be counted in total.  But, we will display one vote for the cpk, with the sum of the coinage spent.
+				WriteCache("coinage-vote-sum-" + sOutcome + "-" + sGobjectID, sCPK + "-" + tx->GetHash().GetHex(), RoundToString(nCoinAge, 2), GetAdjustedTime());
+				// TODO - limit voting to start date and end date here
+				LogPrintf("\nVoted with %f coinage outcome %s for %s from %s ", nCoinAge, sOutcome, sGobjectID, sCPK);
+			}
+		}
+		double dAge = GetAdjustedTime() - block.GetBlockTime();
+		MemorizePrayer(txMessage, block.GetBlockTime(), p.dTotalSent, 0, block.vtx[n]->GetHash().GetHex(), b.nHeight, p.dFoundationDonation, dAge, 0);
+	}
+}
+
+void IndexBlockMessages(const CBlock& block, int nHeight, std::vector<std::pair<CMessageIndexKey, CMessageIndexValue>>& vEntries)
+{
+	PrayerBlock b;
+	b.block = block;
+	b.nHeight = nHeight;
+	b.fRead = true;
+	PreparePrayerBlock(b, Params().GetConsensus());
+	pMessageIndexRecorder = &vEntries;
+	nMessageIndexHeight = nHeight;
+	try
+	{
+		CommitPrayerBlock(b);
+	}
+	catch (...)
+	{
+		pMessageIndexRecorder = NULL;
+		throw;
+	}
+	pMessageIndexRecorder = NULL;
+}
+
+void RestoreIndexedMessages(const std::vector<CMessageIndexKey>& vErased)
+{
+	std::set<std::pair<std::string, std::string>> setRestored;
+	for (const CMessageIndexKey& erased : vErased)
+	{
+		if (!setRestored.insert(std::make_pair(erased.type, erased.key)).second)
+			continue;
+		// The last remaining entry for the key is the value it had before the disconnected block
+		std::vector<std::pair<CMessageIndexKey, CMessageIndexValue>> vEntries;
+		pblocktree->ReadMessageIndex(erased.type, erased.key, vEntries);
+		if (vEntries.empty())
+			mvApplicationCache.Erase(erased.type, erased.key);
+		else
+			mvApplicationCache.Write(erased.type, erased.key, vEntries.back().second.value, vEntries.back().second.time);
+	}
+}
+
+static int LoadCacheFromMessageIndex()
+{
+	int nEntries = 0;
+	// Entries sort by height within each key, so the last write of each key wins
+	pblocktree->LoadMessageIndex([&nEntries](const CMessageIndexKey& key, const CMessageIndexValue& value) {
+		mvApplicationCache.Write(key.type, key.key, value.value, value.time);
+		nEntries++;
+	});
+	return nEntries;
+}
+
 void MemorizeBlockChainPrayers(bool fDuringConnectBlock, bool fSubThread, bool fColdBoot, bool fDuringSanctuaryQuorum)
 {
 	int nDeserializedHeight = 0;
@@ -1735,6 +1938,13 @@ void MemorizeBlockChainPrayers(bool fDuringConnectBlock, bool fSubThread, bool f
 			LogPrintf(" Chain Height %f, Loading entire prayer index\n", chainActive.Tip()->nHeight);
 			nDeserializedHeight = 0;
 		}
+		if (fMessageIndex)
+		{
+			// Every connected block is already in the message index, so there is nothing to rescan
+			int nEntries = LoadCacheFromMessageIndex();
+			LogPrintf(" Loaded %f entries from the message index\n", nEntries);
+			nDeserializedHeight = chainActive.Tip()->nHeight;
+		}
 	}
 	if (fDebugSpam && fDebug)
 		LogPrintf("Memorizing prayers tip height %f @ time %f deserialized height %f ", chainActive.Tip()->nHeight, GetAdjustedTime(), nDeserializedHeight);
@@ -1742,10 +1952,11 @@ void MemorizeBlockChainPrayers(bool fDuringConnectBlock, bool fSubThread, bool f
 	int nMaxDepth = chainActive.Tip()->nHeight;
 	int nMinDepth = fDuringConnectBlock ? nMaxDepth - 2 : nMaxDepth - (BLOCKS_PER_DAY * 30 * 12 * 7);  // Seven years
 	if (fDuringSanctuaryQuorum) nMinDepth = nMaxDepth - (BLOCKS_PER_DAY * 14); // Two Weeks
-	if (nDeserializedHeight > 0 && nDeserializedHeight < nMaxDepth) nMinDepth = nDeserializedHeight;
+	if (nDeserializedHeight > 0 && nDeserializedHeight <= nMaxDepth) nMinDepth = nDeserializedHeight;
 	if (nMinDepth < 0) nMinDepth = 0;
 	CBlockIndex* pindex = FindBlockByHeight(nMinDepth);
 	const Consensus::Params& consensusParams = Params().GetConsensus();
+	std::vector<const CBlockIndex*> vIndexes;
 	while (pindex && pindex->nHeight < nMaxDepth)
 	{
 		if (pindex) 
@@ -1753,71 +1964,42 @@ void MemorizeBlockChainPrayers(bool fDuringConnectBlock, bool fSubThread, bool f
 				pindex = chainActive.Next(pindex);
 		if (!pindex)
 			break;
-		CBlock block;
-		if (ReadBlockFromDisk(block, pindex, consensusParams)) 
+		vIndexes.push_back(pindex);
+	}
+
+	int nThreads = std::min(GetNumCores(), MAX_PRAYER_REBUILD_THREADS);
+	if (vIndexes.size() < PRAYER_REBUILD_PIPELINE_MIN_BLOCKS || nThreads < 2)
+	{
+		for (const CBlockIndex* pindexRead : vIndexes)
 		{
-			if (pindex->nHeight % 25000 == 0)
-				LogPrintf(" MBCP %f @ %f, ", pindex->nHeight, GetAdjustedTime());
-			for (unsigned int n = 0; n < block.vtx.size(); n++)
-    		{
-				double dTotalSent = 0;
-				std::string sPrayer = "";
-				double dFoundationDonation = 0;
-				for (unsigned int i = 0; i < block.vtx[n]->vout.size(); i++)
-				{
-					sPrayer += block.vtx[n]->vout[i].sTxOutMessage;
-					double dAmount = block.vtx[n]->vout[i].nValue / COIN;
-					dTotalSent += dAmount;
-					// The following 3 lines are used for PODS (Proof of document storage); allowing persistence of paid documents in IPFS
-					std::string sPK = PubKeyToAddress(block.vtx[n]->vout[i].scriptPubKey);
-					if (sPK == consensusParams.FoundationAddress || sPK == consensusParams.FoundationPODSAddress)
-					{
-						dFoundationDonation += dAmount;
-					}
-					// This is for Dynamic-Whale-Staking (DWS):
-					if (sPK == consensusParams.BurnAddress)
-					{
-						// Memorize each DWS txid-vout and burn amount (later the sancs will audit each one to ensure they are mature and in the main chain). 
-						// NOTE:  This data is automatically persisted during shutdowns and reboots and loaded efficiently into memory.
-						std::string sXML = ExtractXML(sPrayer, "<dws>", "</dws>");
-						if (!sXML.empty())
-						{
-							WriteCache("dws-burn", block.vtx[n]->GetHash().GetHex(), sXML, GetAdjustedTime());
-						}
-						std::string sDashStake = ExtractXML(sPrayer, "<dashstake>", "</dashstake>");
-						if (!sDashStake.empty())
-						{
-							WriteCache("dash-burn", block.vtx[n]->GetHash().GetHex(), sDashStake, GetAdjustedTime());
-						}
-					}
-					// For Coin-Age voting:  This vote cannot be falsified because we require the user to vote with coin-age (they send the stake back to their own address):
-					std::string sGobjectID = ExtractXML(sPrayer, "<gobject>", "</gobject>");
-					std::string sType = ExtractXML(sPrayer, "<MT>", "</MT>");
-					std::string sGSCCampaign = ExtractXML(sPrayer, "<gsccampaign>", "</gsccampaign>");
-					std::string sCPK = ExtractXML(sPrayer, "<abncpk>", "</abncpk>");
-					if (!sGobjectID.empty() && sType == "GSCTransmission" && sGSCCampaign == "COINAGEVOTE" && !sCPK.empty())
-					{
-						// This user voted on a poll with coin-age:
-						CTransactionRef tx = block.vtx[n];
-						double nCoinAge = GetVINCoinAge(block.GetBlockTime(), tx, false);
-						//Todo make this pass the age into 
-						// At this point we can do two cool things to extend the sanctuary gobject vote:
-						// 1: Increment the vote count by distinct voter (1 vote per distinct GobjectID-CPK), and, 2: increment the vote coin-age-tally by coin-age spent (sum(coinage(gobjectid-cpk))):
-						std::string sOutcome = ExtractXML(sPrayer, "<outcome>", "</outcome>");
-						if (sOutcome == "YES" || sOutcome == "NO" || sOutcome == "ABSTAIN")
-						{
-							WriteCache("coinage-vote-count-" + sGobjectID, sCPK, sOutcome, GetAdjustedTime());
-							// Note, if someone votes more than once, we only count it once (see above line), but, we do tally coin-age (within the duration of the poll start-end).  This means a whale who accidentally voted with 10% of the coin-age on Monday may vote with the rest of their 90% of coin age as long as the poll is not expired and the coin-age will be counted in total.  But, we will display one vote for the cpk, with the sum of the coinage spent.
-							WriteCache("coinage-vote-sum-" + sOutcome + "-" + sGobjectID, sCPK + "-" + tx->GetHash().GetHex(), RoundToString(nCoinAge, 2), GetAdjustedTime());
-							// TODO - limit voting to start date and end date here
-							LogPrintf("\nVoted with %f coinage outcome %s for %s from %s ", nCoinAge, sOutcome, sGobjectID, sCPK);
-						}
-					}
-				}
-				double dAge = GetAdjustedTime() - block.GetBlockTime();
-				MemorizePrayer(sPrayer, block.GetBlockTime(), dTotalSent, 0, block.vtx[n]->GetHash().GetHex(), pindex->nHeight, dFoundationDonation, dAge, 0);
+			PrayerBlock b;
+			ReadPrayerBlock(b, pindexRead, consensusParams);
+			CommitPrayerBlock(b);
+		}
+	}
+	else
+	{
+		// Workers read and prepare blocks ahead of the committer; the cache writes are applied here, strictly in height order
+		ctpl::thread_pool workers(nThreads);
+		RenameThreadPool(workers, "dac-mbcp");
+		size_t nWindow = nThreads * PRAYER_REBUILD_BLOCKS_PER_THREAD;
+		std::deque<std::future<std::shared_ptr<PrayerBlock>>> dqPending;
+		size_t nNext = 0;
+		while (nNext < vIndexes.size() || !dqPending.empty())
+		{
+			while (nNext < vIndexes.size() && dqPending.size() < nWindow)
+			{
+				const CBlockIndex* pindexRead = vIndexes[nNext++];
+				dqPending.push_back(workers.push([pindexRead, &consensusParams](int) {
+					std::shared_ptr<PrayerBlock> b = std::make_shared<PrayerBlock>();
+					ReadPrayerBlock(*b, pindexRead, consensusParams);
+					return b;
+				}));
 			}
-	 	}
+			std::shared_ptr<PrayerBlock> b = dqPending.front().get();
+			dqPending.pop_front();
+			CommitPrayerBlock(*b);
+		}
 	}
 	if (fColdBoot) 
 	{
@@ -1826,6 +2008,10 @@ void MemorizeBlockChainPrayers(bool fDuringConnectBlock, bool fSubThread, bool f
 			SerializePrayersToFile(nMaxDepth - 1);
 		}
 	}
+	else if (fDuringConnectBlock)
+	{
+		AppendPrayersToFile(nMaxDepth - 1);
+	}
 	if (fDebugSpam && fDebug)
 		LogPrintf("...Finished MemorizeBlockChainPrayers @ %f ", GetAdjustedTime());
 }
@@ -1957,26 +2143,7 @@ bool TermPeekFound(std::string sData, int iBOEType)
 	return bFound;
 }
 
-std::string PrepareHTTPPost(bool bPost, std::string sPage, std::string sHostHeader, const std::string& sMsg, const std::map<std::string,std::string>& mapRequestHeaders)
-{
-	std::ostringstream s;
-	std::string sUserAgent = "Mozilla/5.0 (Macintosh; Intel Mac OS X 10_11_2) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/47.0.2526.80 Safari/537.36";
-	std::string sMethod = bPost ? "POST" : "GET";
-
-	s << sMethod + " /" + sPage + " HTTP/1.1\r\n"
-		<< "User-Agent: " + sUserAgent + "/" << FormatFullVersion() << "\r\n"
-		<< "Host: " + sHostHeader + "" << "\r\n"
-		<< "Content-Length: " << sMsg.size() << "\r\n";
-
-	for (auto item : mapRequestHeaders) 
-	{
-        s << item.first << ": " << item.second << "\r\n";
-	}
-    s << "\r\n" << sMsg;
-    return s.str();
-}
-
-DACResult SubmitIPFSPart(int iPort, std::string sWebPath, std::string sTXID, std::string sBaseURL, std::string sPage, std::string sOriginalName, std::string sFileName, int iPartNumber, int iTotalParts, int iDensity, int iDuration, bool fEncrypted, CAmount nFee)
+DACHttpRequest PrepareIPFSPartRequest(int iPort, std::string sWebPath, std::string sTXID, std::string sBaseURL, std::string sPage, std::string sOriginalName, const BIPFSPart& part, int iPartNumber, int iTotalParts, int iDensity, int iDuration, CAmount nFee)
 {
 	std::map<std::string, std::string> mapRequestHeaders;
 	mapRequestHeaders["PartNumber"] = RoundToString(iPartNumber, 0);
@@ -1985,19 +2152,22 @@ DACResult SubmitIPFSPart(int iPort, std::string sWebPath, std::string sTXID, std
 	mapRequestHeaders["WebPath"] = sWebPath;
 	mapRequestHeaders["Density"] = RoundToString(iDensity, 0);
 	mapRequestHeaders["Duration"] = RoundToString(iDuration, 0);
-	mapRequestHeaders["Part"] = sFileName;
+	mapRequestHeaders["Part"] = part.sPath;
+	mapRequestHeaders["PartHash"] = part.sHash;
 	mapRequestHeaders["OriginalName"] = sOriginalName;
 	mapRequestHeaders["TotalParts"] = RoundToString(iTotalParts, 0);
-	mapRequestHeaders["BlockHash"] = chainActive.Tip()->GetBlockHash().GetHex();
-	mapRequestHeaders["BlockHeight"] = RoundToString(chainActive.Tip()->nHeight, 0);
+	{
+		LOCK(cs_main);
+		mapRequestHeaders["BlockHash"] = chainActive.Tip()->GetBlockHash().GetHex();
+		mapRequestHeaders["BlockHeight"] = RoundToString(chainActive.Tip()->nHeight, 0);
+	}
 	std::string sCPK = DefaultRecAddress("Christian-Public-Key");
 	mapRequestHeaders["CPK"] = sCPK;
-	std::string sData = GetAttachmentData(sFileName, fEncrypted);
+	// SplitFile has already encrypted the part when the upload is encrypted
+	std::string sData = GetAttachmentData(part.sPath, false);
 	LogPrintf("IPFS::SubmitIPFSPart Part # %f, DataLen %s", iPartNumber, sData.size());
 
-	DACResult b;
-	b.Response = Uplink(true, sData, sBaseURL, sPage, iPort, 600, 1, mapRequestHeaders);
-	return b;
+	return PrepareUplinkRequest(true, sData, sBaseURL, sPage, iPort, 600, 1, mapRequestHeaders);
 }
 
 std::vector<char> ReadAllBytesFromFile(char const* filename)
@@ -2023,29 +2193,44 @@ DACResult DownloadFile(std::string sBaseURL, std::string sPage, int iPort, int i
 	dResult.Response = Uplink(false, "", sBaseURL, sPage, iPort, iTimeoutSecs, 1, mapRequestHeaders, sTargetFileName);
 	if (fEncrypted)
 	{
-		DecryptFile(sTargetFileName, sTargetPath);
+		if (!DecryptFile(sTargetFileName, sTargetPath))
+			dResult.ErrorCode = "DECRYPT_FAILED";
+		boost::filesystem::remove(sTargetFileName);
 	}
 	return dResult;
 }
 	
 static double HTTP_PROTO_VERSION = 2.0;
-std::string Uplink(bool bPost, std::string sPayload, std::string sBaseURL, std::string sPage, int iPort, int iTimeoutSecs, int iBOE, std::map<std::string, std::string> mapRequestHeaders, std::string TargetFileName)
+DACHttpRequest PrepareUplinkRequest(bool bPost, std::string sPayload, std::string sBaseURL, std::string sPage, int iPort, int iTimeoutSecs, int iBOE, std::map<std::string, std::string> mapRequestHeaders, std::string TargetFileName)
 {
-	std::string sData;
-	int iRead = 0;
-	int iMaxSize = 20000000;
-	double dMaxSize = 0;
-	std::ofstream OutFile;
-
-	if (!TargetFileName.empty())
-	{
-		OutFile.open(TargetFileName, std::ios::out | std::ios::binary);
-		iMaxSize = 300000000;
-	}
-
-	bool fContentLengthFound = false;
+	mapRequestHeaders["Agent"] = FormatFullVersion();
+	// Supported pool Network Chain modes: main, test, regtest
+	const CChainParams& chainparams = Params();
+	mapRequestHeaders["NetworkID"] = chainparams.NetworkIDString();
+	mapRequestHeaders["OS"] = sOS;
+	mapRequestHeaders["SessionID"] = msSessionID;
+	if (sPayload.length() < 1000)
+		mapRequestHeaders["Action"] = sPayload;
+	mapRequestHeaders["HTTP_PROTO_VERSION"] = RoundToString(HTTP_PROTO_VERSION, 0);
+	if (bPost)
+		mapRequestHeaders["Content-Type"] = "application/octet-stream";
+
+	DACHttpRequest request;
+	request.fPost = bPost;
+	request.fSSL = true;
+	request.sHost = GetDomainFromURL(sBaseURL);
+	request.iPort = iPort;
+	request.sPage = sPage;
+	request.sPayload = sPayload;
+	request.mapRequestHeaders = mapRequestHeaders;
+	request.iTimeoutSecs = iTimeoutSecs;
+	request.iBOE = iBOE;
+	request.sTargetFileName = TargetFileName;
+	return request;
+}
 
-	// The OpenSSL version of Post *only* works with SSL websites, hence the need for HTTPPost(2) (using BOOST).  The dev team is working on cleaning this up before the end of 2019 to have one standard version with cleaner code and less internal parts. //
+std::string Uplink(bool bPost, std::string sPayload, std::string sBaseURL, std::string sPage, int iPort, int iTimeoutSecs, int iBOE, std::map<std::string, std::string> mapRequestHeaders, std::string TargetFileName)
+{
 	try
 	{
 		double dDebugLevel = cdbl(GetArg("-devdebuglevel", "0"), 0);
@@ -2053,151 +2238,23 @@ std::string Uplink(bool bPost, std::string sPayload, std::string sBaseURL, std::
 		if (dDebugLevel == 1)
 			LogPrintf("\r\nUplink::Connecting to %s [/] %s ", sBaseURL, sPage);
 
-		mapRequestHeaders["Agent"] = FormatFullVersion();
-		// Supported pool Network Chain modes: main, test, regtest
-		const CChainParams& chainparams = Params();
-		mapRequestHeaders["NetworkID"] = chainparams.NetworkIDString();
-		mapRequestHeaders["OS"] = sOS;
-		mapRequestHeaders["SessionID"] = msSessionID;
-		if (sPayload.length() < 1000)
-			mapRequestHeaders["Action"] = sPayload;
-		mapRequestHeaders["HTTP_PROTO_VERSION"] = RoundToString(HTTP_PROTO_VERSION, 0);
-		if (bPost)
-			mapRequestHeaders["Content-Type"] = "application/octet-stream";
-
-		BIO* bio;
-		// Todo add connection timeout here to bio object
-
-		SSL_CTX* ctx;
-		//   Registers the SSL/TLS ciphers and digests and starts the security layer.
-		SSL_library_init();
-		ctx = SSL_CTX_new(SSLv23_client_method());
-		if (ctx == NULL)
-		{
-			if (!TargetFileName.empty())
-				OutFile.close();
-			return "<ERROR>CTX_IS_NULL</ERROR>";
-		}
-		bio = BIO_new_ssl_connect(ctx);
-		std::string sDomain = GetDomainFromURL(sBaseURL);
-		std::string sDomainWithPort = sDomain + ":" + RoundToString(iPort, 0);
-
-		// Compatibility with strict d-dos prevention rules (like cloudflare)
-		SSL * ssl(nullptr);
-		BIO_get_ssl(bio, &ssl);
-		SSL_set_mode(ssl, SSL_MODE_AUTO_RETRY);
-		SSL_set_tlsext_host_name(ssl, const_cast<char *>(sDomain.c_str()));
-		BIO_set_conn_hostname(bio, sDomainWithPort.c_str());
-		BIO_set_conn_int_port(bio, &iPort);
-
+		// The pooled client keeps the connection (and the TLS session) alive for the next call to the same host
+		DACHttpRequest request = PrepareUplinkRequest(bPost, sPayload, sBaseURL, sPage, iPort, iTimeoutSecs, iBOE, mapRequestHeaders, TargetFileName);
+		DACHttpResponse response;
+		bool fOk = DACHttpExecute(request, response);
 		if (dDebugLevel == 1)
-			LogPrintf("Connecting to %s", sDomainWithPort.c_str());
-		int nRet = 0;
-		if (sDomain.empty()) 
-			return "<ERROR>DOMAIN_MISSING</ERROR>";
-		
-		nRet = BIO_do_connect(bio);
-		if (nRet <= 0)
-		{
-			if (dDebugLevel == 1)
-				LogPrintf("Failed connection to %s ", sDomainWithPort);
-			if (!TargetFileName.empty())
-				OutFile.close();
-
-			return "<ERROR>Failed connection to " + sDomainWithPort + "</ERROR>";
-		}
-
-		// Evo requires 2 args instead of 3, the last used to be true for DNS resolution=true
-
-		std::string sPost = PrepareHTTPPost(bPost, sPage, sDomain, sPayload, mapRequestHeaders);
-		const char* write_buf = sPost.c_str();
-		if (dDebugLevel==1)
-			LogPrintf("BioPost %f", 801);
-		if(BIO_write(bio, write_buf, strlen(write_buf)) <= 0)
-		{
-			if (!TargetFileName.empty())
-				OutFile.close();
-
-			return "<ERROR>FAILED_HTTPS_POST</ERROR>";
-		}
-		//  Variables used to read the response from the server
-		int size;
-		clock_t begin = clock();
-		char buf[16384];
-		for(;;)
-		{
-			if (dDebugLevel == 1)
-				LogPrintf("BioRead %f", 803);
-			
-			size = BIO_read(bio, buf, 16384);
-			if(size <= 0)
-			{
-				break;
-			}
-			iRead += (int)size;
-			buf[size] = 0;
-			std::string MyData(buf);
-			int iOffset = 0;
-
-			if (!TargetFileName.empty())
-			{
-
-				if (!fContentLengthFound)
-				{
-					if (MyData.find("Content-Length:") != std::string::npos)
-					{
-						std::size_t iFoundPos = MyData.find("\r\n\r\n");
-						if ((int)iFoundPos > 1)
-						{
-							iOffset = (int)iFoundPos + 4;
-							size -= iOffset;
-						}
-					}
-				}
-
-				OutFile.write(&buf[iOffset], size);
-			}
-			else
-			{
-				sData += MyData;
-			}
-
-			if (dDebugLevel == 1)
-				LogPrintf(" BioReadFinished maxsize %f datasize %f ", dMaxSize, iRead);
-
-			clock_t end = clock();
-			double elapsed_secs = double(end - begin) / (CLOCKS_PER_SEC + .01);
-			if (elapsed_secs > iTimeoutSecs) break;
-			if (TermPeekFound(sData, iBOE)) break;
-
-			if (!fContentLengthFound)
-			{
-				if (MyData.find("Content-Length:") != std::string::npos)
-				{
-					dMaxSize = cdbl(ExtractXML(MyData, "Content-Length: ","\n"), 0);
-					std::size_t foundPos = MyData.find("Content-Length:");
-					if (dMaxSize > 0)
-					{
-						iMaxSize = dMaxSize + (int)foundPos + 16;
-						fContentLengthFound = true;
-					}
-				}
-			}
-
-			if (iRead >= iMaxSize) 
-				break;
-		}
-		// Free bio resources
-		BIO_free_all(bio);
+			LogPrintf("Uplink::Status %d, %d bytes %s", response.nStatus, response.sBody.size(), response.sError);
+		if (!fOk && response.sHeaders.empty())
+			return "<ERROR>" + response.sError + "</ERROR>";
 		if (!TargetFileName.empty())
-			OutFile.close();
-
-		return sData;
+			return std::string();
+		// Callers extract their XML from the raw response, so the headers stay in front of the body
+		return response.sHeaders + response.sBody;
 	}
 	catch (std::exception &e)
 	{
-        return "<ERROR>WEB_EXCEPTION</ERROR>";
-    }
+		return "<ERROR>WEB_EXCEPTION</ERROR>";
+	}
 	catch (...)
 	{
 		return "<ERROR>GENERAL_WEB_EXCEPTION</ERROR>";
@@ -2400,18 +2457,13 @@ bool AdvertiseChristianPublicKeypair(std::string sProjectId, std::string sNickNa
 
 std::string GetTransactionMessage(CTransactionRef tx)
 {
-	std::string sMsg;
-	for (unsigned int i = 0; i < tx->vout.size(); i++) 
-	{
-		sMsg += tx->vout[i].sTxOutMessage;
-	}
-	return sMsg;
+	return tx->GetTxMessage();
 }
 
 void ProcessBLSCommand(CTransactionRef tx)
 {
-	std::string sXML = GetTransactionMessage(tx);
-	std::string sEnc = ExtractXML(sXML, "<blscommand>", "</blscommand>");
+	const std::string& sXML = tx->GetTxMessage();
+	std::string sEnc = tx->GetParsedTxMessage().GetTag("blscommand");
 	if (fDebugSpam)
 		LogPrintf("\nBLS Command %s %s ", sXML, sEnc);
 
@@ -2440,9 +2492,9 @@ void ProcessBLSCommand(CTransactionRef tx)
 
 bool CheckAntiBotNetSignature(CTransactionRef tx, std::string sType, std::string sSolver)
 {
-	std::string sXML = GetTransactionMessage(tx);
-	std::string sSig = ExtractXML(sXML, "<" + sType + "sig>", "</" + sType + "sig>");
-	std::string sMessage = ExtractXML(sXML, "<abnmsg>", "</abnmsg>");
+	const CTxMessage& txMessage = tx->GetParsedTxMessage();
+	std::string sSig = txMessage.GetTag(sType + "sig");
+	std::string sMessage = txMessage.GetTag("abnmsg");
 	std::string sPPK = ExtractXML(sMessage, "<ppk>", "</ppk>");
 	double dCheckPoolSigs = GetSporkDouble("checkpoolsigs", 0);
 
@@ -2466,17 +2518,25 @@ bool CheckAntiBotNetSignature(CTransactionRef tx, std::string sType, std::string
 	return false;
 }
 
+static double GetCoinAgeInDays(int64_t nBlockTime, int64_t nTime)
+{
+	double nAge = (nBlockTime - nTime) / (86400 + .01);
+	if (nAge > 365) nAge = 365;
+	if (nAge < 0)   nAge = 0;
+	return nAge;
+}
+
 double GetVINCoinAge(int64_t nBlockTime, CTransactionRef tx, bool fDebug)
 {
 	double dTotal = 0;
 	std::string sDebugData = "\nGetVINCoinAge: ";
+	double nSancScalpingDisabled = GetSporkDouble("preventsanctuaryscalping", 0);
 	for (int i = 0; i < (int)tx->vin.size(); i++) 
 	{
     	int n = tx->vin[i].prevout.n;
 		CAmount nAmount = 0;
 		int64_t nTime = 0;
 		bool fOK = GetTransactionTimeAndAmount(tx->vin[i].prevout.hash, n, nTime, nAmount);
-		double nSancScalpingDisabled = GetSporkDouble("preventsanctuaryscalping", 0);
 		if (nSancScalpingDisabled == 1 && nAmount == (SANCTUARY_COLLATERAL * COIN)) 
 		{
 			LogPrintf("\nGetVinCoinAge, Detected unlocked sanctuary in txid %s, Amount %f ", tx->GetHash().GetHex(), nAmount/COIN);
@@ -2484,9 +2544,7 @@ double GetVINCoinAge(int64_t nBlockTime, CTransactionRef tx, bool fDebug)
 		}
 		if (fOK && nTime > 0 && nAmount > 0)
 		{
-			double nAge = (nBlockTime - nTime) / (86400 + .01);
-			if (nAge > 365) nAge = 365;           
-			if (nAge < 0)   nAge = 0;
+			double nAge = GetCoinAgeInDays(nBlockTime, nTime);
 			double dWeight = nAge * (nAmount / COIN);
 			dTotal += dWeight;
 			if (fDebug)
@@ -2499,6 +2557,26 @@ double GetVINCoinAge(int64_t nBlockTime, CTransactionRef tx, bool fDebug)
 	return dTotal;
 }
 
+void GetVINCoinAge(int64_t nBlockTime, CTransactionRef tx, double& dCoinAge, double& dCoinAgeWithoutSanctuaries)
+{
+	// Both totals are summed in input order, exactly as GetVINCoinAge does with the preventsanctuaryscalping spork off and on
+	dCoinAge = 0;
+	dCoinAgeWithoutSanctuaries = 0;
+	for (int i = 0; i < (int)tx->vin.size(); i++) 
+	{
+		CAmount nAmount = 0;
+		int64_t nTime = 0;
+		bool fOK = GetTransactionTimeAndAmount(tx->vin[i].prevout.hash, tx->vin[i].prevout.n, nTime, nAmount);
+		if (fOK && nTime > 0 && nAmount > 0)
+		{
+			double dWeight = GetCoinAgeInDays(nBlockTime, nTime) * (nAmount / COIN);
+			dCoinAge += dWeight;
+			if (nAmount != (SANCTUARY_COLLATERAL * COIN))
+				dCoinAgeWithoutSanctuaries += dWeight;
+		}
+	}
+}
+
 double GetAntiBotNetWeight(int64_t nBlockTime, CTransactionRef tx, bool fDebug, std::string sSolver)
 {
 	double nCoinAge = GetVINCoinAge(nBlockTime, tx, fDebug);
@@ -2611,9 +2689,8 @@ CWalletTx CreateAntiBotNetTx(CBlockIndex* pindexLast, double nMinCoinAge, CReser
 double GetABNWeight(const CBlock& block, bool fMining)
 {
 	if (block.vtx.size() < 1) return 0;
-	std::string sMsg = GetTransactionMessage(block.vtx[0]);
 	std::string sSolver = PubKeyToAddress(block.vtx[0]->vout[0].scriptPubKey);
-	int nABNLocator = (int)cdbl(ExtractXML(sMsg, "<abnlocator>", "</abnlocator>"), 0);
+	int nABNLocator = (int)cdbl(block.vtx[0]->GetParsedTxMessage().GetTag("abnlocator"), 0);
 	if (block.vtx.size() < nABNLocator) return 0;
 	CTransactionRef tx = block.vtx[nABNLocator];
 	double dWeight = GetAntiBotNetWeight(block.GetBlockTime(), tx, true, sSolver);
@@ -2624,11 +2701,10 @@ bool CheckABNSignature(const CBlock& block, std::string& out_CPK)
 {
 	if (block.vtx.size() < 1) return 0;
 	std::string sSolver = PubKeyToAddress(block.vtx[0]->vout[0].scriptPubKey);
-	std::string sMsg = GetTransactionMessage(block.vtx[0]);
-	int nABNLocator = (int)cdbl(ExtractXML(sMsg, "<abnlocator>", "</abnlocator>"), 0);
+	int nABNLocator = (int)cdbl(block.vtx[0]->GetParsedTxMessage().GetTag("abnlocator"), 0);
 	if (block.vtx.size() < nABNLocator) return 0;
 	CTransactionRef tx = block.vtx[nABNLocator];
-	out_CPK = ExtractXML(tx->GetTxMessage(), "<abncpk>", "</abncpk>");
+	out_CPK = tx->GetParsedTxMessage().GetTag("abncpk");
 	return CheckAntiBotNetSignature(tx, "abn", sSolver);
 }
 
@@ -2820,11 +2896,9 @@ double GetFees(CTransactionRef tx)
 	return nFees;
 }
 
-int64_t GetCacheEntryAge(std::string sSection, std::string sKey)
+int64_t GetCacheEntryAge(const std::string& sSection, const std::string& sKey)
 {
-	LOCK(csReadWait);
-	std::pair<std::string, int64_t> v = mvApplicationCache[std::make_pair(sSection, sKey)];
-	int64_t nTimestamp = v.second;
+	int64_t nTimestamp = mvApplicationCache.Read(sSection, sKey).second;
 	int64_t nAge = GetAdjustedTime() - nTimestamp;
 	return nAge;
 }
@@ -3130,6 +3204,77 @@ std::string BIPFS_Payment(CAmount nAmount, std::string sTXID1, std::string sXML1
 	return b.Response;
 }
 
+static CCriticalSection cs_researchers;
+static std::shared_ptr<const std::map<std::string, Researcher>> pResearchers = std::make_shared<const std::map<std::string, Researcher>>();
+
+std::shared_ptr<const std::map<std::string, Researcher>> GetResearchers()
+{
+	LOCK(cs_researchers);
+	return pResearchers;
+}
+
+Researcher GetResearcher(const std::string& sCPID)
+{
+	std::shared_ptr<const std::map<std::string, Researcher>> researchers = GetResearchers();
+	std::map<std::string, Researcher>::const_iterator it = researchers->find(sCPID);
+	return it == researchers->end() ? Researcher() : it->second;
+}
+
+int ParseResearchers(const std::string& sData, std::map<std::string, Researcher>& mapResearchers)
+{
+	// Each record ends at </user>; within a record every field is taken from the first occurrence of its tag, exactly as ExtractXML would
+	enum { NAME, TEAMID, CPID, COUNTRY, CREATE_TIME, TOTAL_CREDIT, EXPAVG_CREDIT, ID, FIELD_COUNT };
+	static const char* const vFieldTags[FIELD_COUNT] = { "name", "teamid", "cpid", "country", "create_time", "total_credit", "expavg_credit", "id" };
+	static const std::string sRecordEnd = "</user>";
+	int nRecords = 0;
+	std::string::size_type nStart = 0;
+	while (true)
+	{
+		std::string::size_type nEnd = sData.find(sRecordEnd, nStart);
+		std::string::size_type nLimit = (nEnd == std::string::npos) ? sData.size() : nEnd;
+		std::string vFields[FIELD_COUNT];
+		bool vSeen[FIELD_COUNT] = {};
+		for (std::string::size_type loc = sData.find('<', nStart); loc < nLimit; loc = sData.find('<', loc + 1))
+		{
+			for (int i = 0; i < FIELD_COUNT; i++)
+			{
+				const std::string::size_type nTagLength = strlen(vFieldTags[i]);
+				if (vSeen[i] || loc + nTagLength + 2 > nLimit || sData[loc + nTagLength + 1] != '>' || sData.compare(loc + 1, nTagLength, vFieldTags[i]) != 0)
+					continue;
+				vSeen[i] = true;
+				std::string::size_type nValue = loc + nTagLength + 2;
+				std::string::size_type nValueEnd = sData.find("</" + std::string(vFieldTags[i]) + ">", nValue);
+				if (nValueEnd != std::string::npos && nValueEnd + nTagLength + 3 <= nLimit)
+					vFields[i] = sData.substr(nValue, nValueEnd - nValue);
+				break;
+			}
+		}
+		nRecords++;
+
+		Researcher r;
+		r.nickname = vFields[NAME];
+		r.teamid = cdbl(vFields[TEAMID], 0);
+		r.cpid = vFields[CPID];
+		r.country = vFields[COUNTRY];
+		r.creationtime = cdbl(vFields[CREATE_TIME], 0);
+		r.totalcredit = cdbl(vFields[TOTAL_CREDIT], 2);
+		r.wcgpoints = r.totalcredit * 7;
+		r.rac = cdbl(vFields[EXPAVG_CREDIT], 10);
+		r.id = cdbl(vFields[ID], 0);
+		if (r.id > 0 && r.cpid.length() == 32)
+		{
+			r.found = true;
+			mapResearchers[r.cpid] = r;
+			if (fDebugSpam)
+				LogPrintf(";cpid %s - team %f, id %f, rac %f, \n", r.cpid, r.teamid, r.id, r.rac);
+		}
+		if (nEnd == std::string::npos)
+			break;
+		nStart = nEnd + sRecordEnd.length();
+	}
+	return nRecords;
+}
+
 int LoadResearchers()
 {
 	// On wallet boot, we load the Boinc Researchers (Cancer Miners, Aids researchers, and/or WCG researchers) in from DSQL, then again every 24 hours we refresh the collection.
@@ -3153,58 +3298,60 @@ int LoadResearchers()
 	if (fDebug)
 		LogPrintf("LoadResearchers End %f", GetAdjustedTime());
 
-	std::vector<std::string> vResearchers = Split(b.Response, "</user>");
-	mvResearchers.clear();
+	// The new table is built on the side and swapped in whole, so readers keep using the previous one until it is complete
+	std::shared_ptr<std::map<std::string, Researcher>> researchers = std::make_shared<std::map<std::string, Researcher>>();
 	std::string sTarget = GetSANDirectory2() + "wcg.rac";
+	bool fDownloaded = ParseResearchers(b.Response, *researchers) >= MIN_RESEARCH_SZ;
 
-	if (vResearchers.size() < MIN_RESEARCH_SZ)
+	if (!fDownloaded)
 	{
+		researchers->clear();
 		int64_t nSz = GETFILESIZE(sTarget);
 		int64_t nAge = GetDCCFileAge();
 		// Fall back to POBH & Cameroon-One if WCG is down:
 		if (nSz > 100 && nAge < (60 * 60 * 24))
 		{
-			boost::filesystem::path pathIn(sTarget);
-			std::ifstream streamIn;
-			streamIn.open(pathIn.string().c_str());
+			std::ifstream streamIn(sTarget.c_str(), std::ios::in | std::ios::binary);
 			if (!streamIn) 
 				return -1;
-			std::string line;
-			std::string sData;
-			while(std::getline(streamIn, line))
-			{
-				sData += line + "\r\n";
-			}
-			streamIn.close();
-			vResearchers = Split(sData, "</user>");
+			std::string sData((std::istreambuf_iterator<char>(streamIn)), std::istreambuf_iterator<char>());
+			ParseResearchers(sData, *researchers);
 		}
 	}
-	for (int i = 0; i < vResearchers.size(); i++)
+
+	if (researchers->empty())
 	{
-		Researcher r;
-		r.nickname = ExtractXML(vResearchers[i], "<name>", "</name>");
-		r.teamid = cdbl(ExtractXML(vResearchers[i],"<teamid>", "</teamid>"),0);
-		r.cpid = ExtractXML(vResearchers[i], "<cpid>", "</cpid>");
-		r.country = ExtractXML(vResearchers[i], "<country>", "</country>");
-		r.creationtime = cdbl(ExtractXML(vResearchers[i], "<create_time>", "</create_time>"), 0);
-		r.totalcredit = cdbl(ExtractXML(vResearchers[i], "<total_credit>", "</total_credit>"), 2);
-		r.wcgpoints = r.totalcredit * 7;
-		r.rac = cdbl(ExtractXML(vResearchers[i], "<expavg_credit>", "</expavg_credit>"), 10);
-		r.id = cdbl(ExtractXML(vResearchers[i], "<id>", "</id>"), 0);
-		if (r.id > 0 && r.cpid.length() == 32)
-		{
-			r.found = true;
-			mvResearchers[r.cpid] = r;
-			if (fDebugSpam)
-				LogPrintf(";cpid %s - team %f, id %f, rac %f, \n", r.cpid, r.teamid, r.id, r.rac);
-		}
+		LogPrintf("LoadResearchers::No researchers loaded, keeping the previous %f CPIDs.\n", GetResearchers()->size());
+		return -1;
 	}
-	if (true || fDebug)
-		LogPrintf("LoadResearchers::Processed %f CPIDs.\n", mvResearchers.size());
-	FILE *outFile = fopen(sTarget.c_str(), "w");
-	fputs(b.Response.c_str(), outFile);
-	fclose(outFile);
-	return 1;
+
+	int nAdded = 0;
+	int nRemoved = 0;
+	{
+		LOCK(cs_researchers);
+		for (const auto& r : *researchers)
+			nAdded += !pResearchers->count(r.first);
+		for (const auto& r : *pResearchers)
+			nRemoved += !researchers->count(r.first);
+		pResearchers = researchers;
+	}
+	if (true || fDebug)
+		LogPrintf("LoadResearchers::Processed %f CPIDs (%f added, %f removed).\n", researchers->size(), nAdded, nRemoved);
+
+	if (fDownloaded)
+	{
+		// Keep a copy for when WCG is down; written aside and renamed so a crash never leaves a torn file
+		std::string sTemp = sTarget + ".new";
+		FILE *outFile = fopen(sTemp.c_str(), "wb");
+		if (outFile)
+		{
+			bool fWritten = fwrite(b.Response.data(), 1, b.Response.size(), outFile) == b.Response.size();
+			fclose(outFile);
+			if (!fWritten || !RenameOver(sTemp, sTarget))
+				LogPrintf("LoadResearchers::Unable to write %s\n", sTarget);
+		}
+	}
+	return 1;
 }
 
 std::string TeamToName(int iTeamID)
@@ -3236,18 +3383,14 @@ std::string GetResElement(std::string data, int iElement)
 
 std::string GetResDataBySearch(std::string sSearch)
 {
-	for (auto ii : mvApplicationCache) 
+	for (const auto& ii : mvApplicationCache.GetSection("CPK-WCG"))
 	{
-		if (ii.first.first == "CPK-WCG")
+		const std::string& sValue = ii.second.first;
+		std::string sCPID = GetResElement(sValue, 8);
+		std::string sNickName = GetResElement(sValue, 5);
+		if (boost::iequals(sCPID, sSearch) || boost::iequals(sNickName, sSearch))
 		{
-			std::pair<std::string, int64_t> v = mvApplicationCache[std::make_pair(ii.first.first, ii.first.second)];
-			std::string sValue = v.first;
-			std::string sCPID = GetResElement(sValue, 8);
-			std::string sNickName = GetResElement(sValue, 5);
-			if (boost::iequals(sCPID, sSearch) || boost::iequals(sNickName, sSearch))
-			{
-				return sValue;	
-			}
+			return sValue;	
 		}
 	}
 	return "";
@@ -3305,10 +3448,10 @@ std::string GetResearcherCPID(std::string sSearch)
 
 bool VerifyMemoryPoolCPID(CTransaction tx)
 {
-    std::string sXML = tx.GetTxMessage();
-	std::string sMessageType      = ExtractXML(sXML,"<MT>","</MT>");
-	std::string sMessageKey       = ExtractXML(sXML,"<MK>","</MK>");
-	std::string sMessageValue     = ExtractXML(sXML,"<MV>","</MV>");
+	const CTxMessage& txMessage = tx.GetParsedTxMessage();
+	std::string sMessageType      = txMessage.GetTag("MT");
+	std::string sMessageKey       = txMessage.GetTag("MK");
+	std::string sMessageValue     = txMessage.GetTag("MV");
 	boost::to_upper(sMessageType);
 	boost::to_upper(sMessageKey);
 	if (!Contains(sMessageType,"CPK-WCG"))
@@ -3420,7 +3563,8 @@ std::string GetUTXO(std::string sHash, int nOrdinal, CAmount& nValue)
 	return "";
 }
 
-DashStake GetDashStake(CTransactionRef tx1)
+// The parts of a Dash stake that are fixed by its burn transaction
+static DashStake ParseDashStake(CTransactionRef tx1)
 {
 	DashStake w;
 	const Consensus::Params& consensusParams = Params().GetConsensus();
@@ -3431,7 +3575,6 @@ DashStake GetDashStake(CTransactionRef tx1)
 		if (sPK == consensusParams.BurnAddress)
 		{
 			w.XML = tx1->vout[i].sTxOutMessage;
-			int nHeight = 0;
 			w.Time = (int)cdbl(ExtractXML(w.XML, "<time>", "</time>"), 0);
 			w.Height = (int)cdbl(ExtractXML(w.XML, "<height>", "</height>"), 0);
 			w.Duration = (int)cdbl(ExtractXML(w.XML, "<duration>", "</duration>"), 0);
@@ -3449,27 +3592,12 @@ DashStake GetDashStake(CTransactionRef tx1)
 			w.nDashValueUSD = cdbl(ExtractXML(w.XML, "<dashvalue>", "</dashvalue>"), 2);
 			w.nBBPAmount = cdbl(ExtractXML(w.XML, "<bbpamount>", "</bbpamount>"), 2) * COIN;
 			w.nDashAmount = cdbl(ExtractXML(w.XML, "<dashamount>", "</dashamount>"), 2) * COIN;
-			CAmount nBBPAmount = 0;
-			CAmount nDashAmount = 0;
-			w.BBPAddress = GetUTXO(w.BBPUTXO, -1, nBBPAmount);
-			w.DashAddress = GetUTXO(w.DashUTXO, -2, nDashAmount);
-			LogPrintf("GetDashStake::Using bbpaddr %s and dash addr %s dash amount %f ", 
-				w.BBPAddress, w.DashAddress, (double)nDashAmount/COIN);
 			w.MaturityTime = (w.Duration * 86400) + w.Time;
 			if (w.DWU > MAX_DASH_DWU) 
 				w.DWU = 0;
 			if (w.DWU < 0) 
 				w.DWU = 0;
-			// Calculate the lower of the two market values first:
-			double nValueUSD = std::min(w.nBBPValueUSD, w.nDashValueUSD);
-			double nBBPUSD = w.nBTCPrice * w.nBBPPrice;
-			// Note that w.nBBPAmount is a CAmount, and nBBPQty is a double 
-			double n0 = nValueUSD / (nBBPUSD + .000000001);
-			double n2 = nBBPAmount / COIN;
-			w.nBBPQty = std::min(n0, n2);
-			LogPrintf("\nDeciding between bbpvalusd %f and dashvalueusd %f and qty of %f and %f = %f ", w.nBBPValueUSD, w.nDashValueUSD, n0, n2, w.nBBPQty);
 			w.ActualDWU = GetDWUBasedOnMaturity(w.Duration, w.DWU);
-			w.MonthlyEarnings = cdbl(RoundToString(w.nBBPQty * w.ActualDWU / 12, 0) + ".1528", 4);
 			// Note this is probably going to be 6 months at first.
 			w.MaturityHeight = (w.Duration * BLOCKS_PER_DAY) + w.Height;
 			w.TXID = tx1->GetHash();
@@ -3479,11 +3607,6 @@ DashStake GetDashStake(CTransactionRef tx1)
 				w.spent = false;
 				if (w.nBBPAmount == 0 || w.nDashAmount == 0)
 					w.spent = true;
-				w.expired = GetAdjustedTime() > w.MaturityTime;
-				int nKeyType = fProd ? 25 : 140;
-				w.BBPSignatureValid = VerifyDashStakeSignature(w.BBPAddress, w.BBPUTXO, w.BBPSignature, nKeyType);
-				w.DashSignatureValid = VerifyDashStakeSignature(w.DashAddress, w.DashUTXO, w.DashSignature, 76);
-				w.SignatureValid = w.BBPSignatureValid && w.DashSignatureValid;
 			}
 			return w;
 		}
@@ -3491,8 +3614,79 @@ DashStake GetDashStake(CTransactionRef tx1)
 	return w;
 }
 
+/**
+ * Parsed DWS and DASH burns.  Every key of the DWS-BURN and DASH-BURN cache sections is parsed once, either as its block
+ * connects or the first time the section is read, and the stakes are indexed by maturity height (DWS) and by UTXO (DASH).
+ * Keys are never removed from a cache section, so a registry holding as many stakes as its section is up to date.
+ * Anything that depends on the clock, the UTXO set or the Dash UTXO data is still evaluated each time a stake is read.
+ */
+struct StakeRegistry
+{
+	// Keyed by txid; hex order is the order of the cache section
+	std::map<std::string, WhaleStake> mapWhaleStakes;
+	std::multimap<int, std::string> mapWhaleStakesByMaturity;
+	std::map<std::string, DashStake> mapDashStakes;
+	std::map<std::string, std::set<std::string>> mapDashStakesByUTXO;
+	// Signature checks by address, UTXO, signature and key type
+	std::map<std::string, bool> mapDashStakeSignatures;
+};
+static CCriticalSection cs_stakeregistry;
+static StakeRegistry stakeRegistry;
 
-WhaleStake GetWhaleStake(CTransactionRef tx1)
+static bool VerifyDashStakeSignatureCached(const std::string& sAddress, const std::string& sUTXO, const std::string& sSig, int nKeyType)
+{
+	std::string sKey = sAddress + "|" + sUTXO + "|" + sSig + "|" + RoundToString(nKeyType, 0);
+	{
+		LOCK(cs_stakeregistry);
+		std::map<std::string, bool>::const_iterator it = stakeRegistry.mapDashStakeSignatures.find(sKey);
+		if (it != stakeRegistry.mapDashStakeSignatures.end())
+			return it->second;
+	}
+	bool fValid = VerifyDashStakeSignature(sAddress, sUTXO, sSig, nKeyType);
+	LOCK(cs_stakeregistry);
+	stakeRegistry.mapDashStakeSignatures[sKey] = fValid;
+	return fValid;
+}
+
+// Fill in the parts of a parsed Dash stake that depend on the UTXO sets and the clock
+static void EvaluateDashStake(DashStake& w)
+{
+	if (w.TXID.IsNull())
+		return;
+	CAmount nBBPAmount = 0;
+	CAmount nDashAmount = 0;
+	w.BBPAddress = GetUTXO(w.BBPUTXO, -1, nBBPAmount);
+	w.DashAddress = GetUTXO(w.DashUTXO, -2, nDashAmount);
+	LogPrintf("GetDashStake::Using bbpaddr %s and dash addr %s dash amount %f ", 
+		w.BBPAddress, w.DashAddress, (double)nDashAmount/COIN);
+	// Calculate the lower of the two market values first:
+	double nValueUSD = std::min(w.nBBPValueUSD, w.nDashValueUSD);
+	double nBBPUSD = w.nBTCPrice * w.nBBPPrice;
+	// Note that w.nBBPAmount is a CAmount, and nBBPQty is a double 
+	double n0 = nValueUSD / (nBBPUSD + .000000001);
+	double n2 = nBBPAmount / COIN;
+	w.nBBPQty = std::min(n0, n2);
+	LogPrintf("\nDeciding between bbpvalusd %f and dashvalueusd %f and qty of %f and %f = %f ", w.nBBPValueUSD, w.nDashValueUSD, n0, n2, w.nBBPQty);
+	w.MonthlyEarnings = cdbl(RoundToString(w.nBBPQty * w.ActualDWU / 12, 0) + ".1528", 4);
+	if (w.found)
+	{
+		w.expired = GetAdjustedTime() > w.MaturityTime;
+		int nKeyType = fProd ? 25 : 140;
+		w.BBPSignatureValid = VerifyDashStakeSignatureCached(w.BBPAddress, w.BBPUTXO, w.BBPSignature, nKeyType);
+		w.DashSignatureValid = VerifyDashStakeSignatureCached(w.DashAddress, w.DashUTXO, w.DashSignature, 76);
+		w.SignatureValid = w.BBPSignatureValid && w.DashSignatureValid;
+	}
+}
+
+DashStake GetDashStake(CTransactionRef tx1)
+{
+	DashStake w = ParseDashStake(tx1);
+	EvaluateDashStake(w);
+	return w;
+}
+
+// The parts of a DWS stake that are fixed by its burn transaction (everything but whether it has been paid)
+static WhaleStake ParseWhaleStake(CTransactionRef tx1)
 {
 	// Pull up the actual burn
 	WhaleStake w;
@@ -3505,7 +3699,6 @@ WhaleStake GetWhaleStake(CTransactionRef tx1)
 		{
 			w.XML = tx1->vout[i].sTxOutMessage;
 			w.Amount = (double)tx1->vout[i].nValue/COIN;
-			int nHeight = 0;
 			w.BurnTime = (int)cdbl(ExtractXML(w.XML, "<burntime>", "</burntime>"), 0);
 			w.BurnHeight = (int)cdbl(ExtractXML(w.XML, "<burnheight>", "</burnheight>"), 0);
 			w.Duration = (int)cdbl(ExtractXML(w.XML, "<duration>", "</duration>"), 0);
@@ -3524,53 +3717,177 @@ WhaleStake GetWhaleStake(CTransactionRef tx1)
 			CBitcoinAddress addrWhale(w.ReturnAddress);
 			w.TXID = tx1->GetHash();
 			if (addrWhale.IsValid() && w.BurnHeight > 0 && w.Duration > 0 && w.Amount > 0)
-			{
 				w.found = true;
-				w.paid = w.MaturityTime < GetAdjustedTime();
-			}
 			return w;
 		}
 	}
 	return w;
 }
 
-std::vector<DashStake> GetDashStakes(bool fIncludeMemoryPool)
+WhaleStake GetWhaleStake(CTransactionRef tx1)
 {
-	std::vector<DashStake> wStakes;
-	ProcessDashUTXOData();
+	WhaleStake w = ParseWhaleStake(tx1);
+	if (w.found)
+		w.paid = w.MaturityTime < GetAdjustedTime();
+	return w;
+}
 
-	for (auto ii : mvApplicationCache) 
+static bool IsActiveWhaleStake(const WhaleStake& w)
+{
+	return w.found && w.RewardAmount > 0 && w.Amount > 0 && w.ActualDWU > 0;
+}
+
+static bool IsActiveDashStake(const DashStake& w)
+{
+	// MonthlyEarnings is checked once the stake has been evaluated
+	return w.found && w.nBBPAmount > 0 && w.DWU > 0;
+}
+
+void RegisterWhaleStake(CTransactionRef tx)
+{
+	WhaleStake w = ParseWhaleStake(tx);
+	std::string sTXID = tx->GetHash().GetHex();
+	LOCK(cs_stakeregistry);
+	if (stakeRegistry.mapWhaleStakes.count(sTXID))
+		return;
+	stakeRegistry.mapWhaleStakes[sTXID] = w;
+	if (IsActiveWhaleStake(w))
+		stakeRegistry.mapWhaleStakesByMaturity.insert(std::make_pair(w.MaturityHeight, sTXID));
+}
+
+void RegisterDashStake(CTransactionRef tx)
+{
+	DashStake w = ParseDashStake(tx);
+	std::string sTXID = tx->GetHash().GetHex();
+	LOCK(cs_stakeregistry);
+	if (stakeRegistry.mapDashStakes.count(sTXID))
+		return;
+	stakeRegistry.mapDashStakes[sTXID] = w;
+	if (IsActiveDashStake(w))
 	{
-		if (ii.first.first == "DASH-BURN")
+		if (!w.BBPUTXO.empty())
+			stakeRegistry.mapDashStakesByUTXO[w.BBPUTXO].insert(sTXID);
+		if (!w.DashUTXO.empty())
+			stakeRegistry.mapDashStakesByUTXO[w.DashUTXO].insert(sTXID);
+	}
+}
+
+void DisconnectStakeRegistryBlock(const CBlock& block)
+{
+	// The burns stay in the cache; they are fetched again on the next read, as long as they can still be found
+	LOCK(cs_stakeregistry);
+	for (const auto& tx : block.vtx)
+	{
+		std::string sTXID = tx->GetHash().GetHex();
+		std::map<std::string, WhaleStake>::iterator itWhale = stakeRegistry.mapWhaleStakes.find(sTXID);
+		if (itWhale != stakeRegistry.mapWhaleStakes.end())
 		{
-			std::pair<std::string, int64_t> v = mvApplicationCache[std::make_pair(ii.first.first, ii.first.second)];
-			int64_t nTimestamp = v.second;
-			std::string sTXID = ii.first.second;
-			uint256 hashInput = uint256S(sTXID);
-			CTransactionRef tx1;
-			bool fGot = GetTxDAC(hashInput, tx1);
-			if (fGot)
+			auto range = stakeRegistry.mapWhaleStakesByMaturity.equal_range(itWhale->second.MaturityHeight);
+			for (auto it = range.first; it != range.second; )
+				it = (it->second == sTXID) ? stakeRegistry.mapWhaleStakesByMaturity.erase(it) : std::next(it);
+			stakeRegistry.mapWhaleStakes.erase(itWhale);
+		}
+		std::map<std::string, DashStake>::iterator itDash = stakeRegistry.mapDashStakes.find(sTXID);
+		if (itDash != stakeRegistry.mapDashStakes.end())
+		{
+			for (const std::string& sUTXO : {itDash->second.BBPUTXO, itDash->second.DashUTXO})
 			{
-				DashStake w = GetDashStake(tx1);
-				if (w.found && w.nBBPAmount > 0 && w.DWU > 0 && w.MonthlyEarnings > 0)
-				{
-					wStakes.push_back(w);
-				}
+				auto itUTXO = stakeRegistry.mapDashStakesByUTXO.find(sUTXO);
+				if (itUTXO == stakeRegistry.mapDashStakesByUTXO.end())
+					continue;
+				itUTXO->second.erase(sTXID);
+				if (itUTXO->second.empty())
+					stakeRegistry.mapDashStakesByUTXO.erase(itUTXO);
 			}
+			stakeRegistry.mapDashStakes.erase(itDash);
 		}
 	}
+}
 
-	if (fIncludeMemoryPool)
+// Txids in a burn section that have not been registered yet
+template <typename T>
+static std::vector<uint256> GetUnregisteredStakes(const std::string& sSection, const std::map<std::string, T>& mapStakes)
+{
+	std::vector<uint256> vMissing;
+	LOCK(cs_stakeregistry);
+	if (mvApplicationCache.GetSectionSize(sSection) == mapStakes.size())
+		return vMissing;
+	for (const auto& ii : mvApplicationCache.GetSection(sSection))
+	{
+		uint256 hashInput = uint256S(ii.first);
+		if (!mapStakes.count(hashInput.GetHex()))
+			vMissing.push_back(hashInput);
+	}
+	return vMissing;
+}
+
+static void SyncWhaleStakes()
+{
+	for (const uint256& hashInput : GetUnregisteredStakes("DWS-BURN", stakeRegistry.mapWhaleStakes))
+	{
+		CTransactionRef tx1;
+		if (GetTxDAC(hashInput, tx1))
+			RegisterWhaleStake(tx1);
+	}
+}
+
+static void SyncDashStakes()
+{
+	for (const uint256& hashInput : GetUnregisteredStakes("DASH-BURN", stakeRegistry.mapDashStakes))
+	{
+		CTransactionRef tx1;
+		if (GetTxDAC(hashInput, tx1))
+			RegisterDashStake(tx1);
+	}
+}
+
+static std::vector<DashStake> GetMemoryPoolDashStakes()
+{
+	std::vector<DashStake> wStakes;
+	for (const CTransactionRef& tx1 : mempool.getBurns())
 	{
-		BOOST_FOREACH(const CTxMemPoolEntry& e, mempool.mapTx)
+		DashStake w = GetDashStake(tx1);
+		if (IsActiveDashStake(w))
+			wStakes.push_back(w);
+	}
+	return wStakes;
+}
+
+static std::vector<WhaleStake> GetMemoryPoolWhaleStakes()
+{
+	std::vector<WhaleStake> wStakes;
+	for (const CTransactionRef& tx1 : mempool.getBurns())
+	{
+		WhaleStake w = GetWhaleStake(tx1);
+		if (IsActiveWhaleStake(w))
+			wStakes.push_back(w);
+	}
+	return wStakes;
+}
+
+std::vector<DashStake> GetDashStakes(bool fIncludeMemoryPool)
+{
+	std::vector<DashStake> wStakes;
+	ProcessDashUTXOData();
+	SyncDashStakes();
+
+	{
+		LOCK(cs_stakeregistry);
+		for (const auto& ii : stakeRegistry.mapDashStakes)
 		{
-			const CTransaction& tx = e.GetTx();
-			CTransactionRef tx1 = MakeTransactionRef(std::move(tx));
-			DashStake w = GetDashStake(tx1);
-			if (w.found && w.nBBPAmount > 0 && w.DWU > 0)
-				wStakes.push_back(w);
+			if (IsActiveDashStake(ii.second))
+				wStakes.push_back(ii.second);
 		}
 	}
+	for (DashStake& w : wStakes)
+		EvaluateDashStake(w);
+	wStakes.erase(std::remove_if(wStakes.begin(), wStakes.end(), [](const DashStake& w) { return w.MonthlyEarnings <= 0; }), wStakes.end());
+
+	if (fIncludeMemoryPool)
+	{
+		std::vector<DashStake> wMemoryPoolStakes = GetMemoryPoolDashStakes();
+		wStakes.insert(wStakes.end(), wMemoryPoolStakes.begin(), wMemoryPoolStakes.end());
+	}
 	return wStakes;
 }
 
@@ -3578,11 +3895,27 @@ bool IsDuplicateUTXO(std::string UTXO)
 {
 	if (UTXO.empty())
 		return false;
+	ProcessDashUTXOData();
+	SyncDashStakes();
 	// If the DashStake is not expired
-	std::vector<DashStake> dashStakes = GetDashStakes(true);
-	for (int i = 0; i < dashStakes.size(); i++)
+	std::vector<DashStake> dashStakes;
+	{
+		LOCK(cs_stakeregistry);
+		std::map<std::string, std::set<std::string>>::const_iterator it = stakeRegistry.mapDashStakesByUTXO.find(UTXO);
+		if (it != stakeRegistry.mapDashStakesByUTXO.end())
+		{
+			for (const std::string& sTXID : it->second)
+				dashStakes.push_back(stakeRegistry.mapDashStakes[sTXID]);
+		}
+	}
+	for (DashStake& d : dashStakes)
+	{
+		EvaluateDashStake(d);
+		if (d.MonthlyEarnings > 0 && !d.expired)
+			return true;
+	}
+	for (const DashStake& d : GetMemoryPoolDashStakes())
 	{
-		DashStake d = dashStakes[i];
 		if (!d.expired && (d.BBPUTXO == UTXO || d.DashUTXO == UTXO))
 			return true;
 	}
@@ -3593,45 +3926,50 @@ bool IsDuplicateUTXO(std::string UTXO)
 std::vector<WhaleStake> GetDWS(bool fIncludeMemoryPool)
 {
 	std::vector<WhaleStake> wStakes;
-	for (auto ii : mvApplicationCache) 
+	SyncWhaleStakes();
 	{
-		if (ii.first.first == "DWS-BURN")
+		LOCK(cs_stakeregistry);
+		for (const auto& ii : stakeRegistry.mapWhaleStakes)
 		{
-			std::pair<std::string, int64_t> v = mvApplicationCache[std::make_pair(ii.first.first, ii.first.second)];
-			int64_t nTimestamp = v.second;
-			std::string sTXID = ii.first.second;
-			uint256 hashInput = uint256S(sTXID);
-			CTransactionRef tx1;
-			bool fGot = GetTxDAC(hashInput, tx1);
-			if (fGot)
-			{
-				WhaleStake w = GetWhaleStake(tx1);
-				if (w.found && w.RewardAmount > 0 && w.Amount > 0 && w.ActualDWU > 0)
-				{
-					wStakes.push_back(w);
-					if (fDebugSpam)
-						LogPrintf("\nDWS BurnTime %f, MaturityTime %f, TxID %s, Msg %s, Amount %f, Duration %f, DWU %f \n", 
-							w.BurnTime, w.MaturityTime, w.TXID.GetHex(), w.XML, (double)w.Amount, w.Duration, w.DWU);
-				}
-			}
+			if (IsActiveWhaleStake(ii.second))
+				wStakes.push_back(ii.second);
 		}
 	}
+	for (WhaleStake& w : wStakes)
+	{
+		w.paid = w.MaturityTime < GetAdjustedTime();
+		if (fDebugSpam)
+			LogPrintf("\nDWS BurnTime %f, MaturityTime %f, TxID %s, Msg %s, Amount %f, Duration %f, DWU %f \n", 
+				w.BurnTime, w.MaturityTime, w.TXID.GetHex(), w.XML, (double)w.Amount, w.Duration, w.DWU);
+	}
 
 	if (fIncludeMemoryPool)
 	{
-		BOOST_FOREACH(const CTxMemPoolEntry& e, mempool.mapTx)
-		{
-			const CTransaction& tx = e.GetTx();
-			CTransactionRef tx1 = MakeTransactionRef(std::move(tx));
-			WhaleStake w = GetWhaleStake(tx1);
-			if (w.found && w.RewardAmount > 0 && w.Amount > 0 && w.ActualDWU > 0)
-				wStakes.push_back(w);
-
-		}
+		std::vector<WhaleStake> wMemoryPoolStakes = GetMemoryPoolWhaleStakes();
+		wStakes.insert(wStakes.end(), wMemoryPoolStakes.begin(), wMemoryPoolStakes.end());
 	}
 	return wStakes;
 }
 
+// Stakes in the DWS-BURN section maturing within [nStartHeight, nEndHeight], in the same order as GetDWS
+static std::vector<WhaleStake> GetMaturingWhaleStakes(int nStartHeight, int nEndHeight)
+{
+	std::vector<WhaleStake> wStakes;
+	SyncWhaleStakes();
+	{
+		LOCK(cs_stakeregistry);
+		std::set<std::string> setTXIDs;
+		auto itEnd = stakeRegistry.mapWhaleStakesByMaturity.upper_bound(nEndHeight);
+		for (auto it = stakeRegistry.mapWhaleStakesByMaturity.lower_bound(nStartHeight); it != itEnd; ++it)
+			setTXIDs.insert(it->second);
+		for (const std::string& sTXID : setTXIDs)
+			wStakes.push_back(stakeRegistry.mapWhaleStakes[sTXID]);
+	}
+	for (WhaleStake& w : wStakes)
+		w.paid = w.MaturityTime < GetAdjustedTime();
+	return wStakes;
+}
+
 CAmount GetAnnualDWSReward(int nHeight, int nType)
 {
 	const Consensus::Params& consensusParams = Params().GetConsensus();
@@ -3834,10 +4172,10 @@ WhaleMetric GetWhaleMetrics(int nHeight, bool fIncludeMemoryPool)
 std::vector<WhaleStake> GetPayableWhaleStakes(int nHeight, double& nOwed)
 {
 	const Consensus::Params& consensusParams = Params().GetConsensus();
-	std::vector<WhaleStake> wStakes = GetDWS(false);
 	std::vector<WhaleStake> wReturnStakes;
 	int nStartHeight = nHeight - BLOCKS_PER_DAY + 1;
 	int nEndHeight = nHeight;
+	std::vector<WhaleStake> wStakes = GetMaturingWhaleStakes(nStartHeight, nEndHeight);
 	for (int i = 0; i < wStakes.size(); i++)
 	{
 		WhaleStake w = wStakes[i];
@@ -3908,8 +4246,6 @@ std::vector<DashStake> GetPayableDashStakes(int nHeight, double& nOwed)
 
 bool VerifyDynamicWhaleStake(CTransactionRef tx, std::string& sError)
 {
-    std::string sXML = tx->GetTxMessage();
-	
 	// Verify each element matches the live quotes
 	// Verify the total does not breech saturation requirements
 
@@ -4021,7 +4357,6 @@ bool Tolerance(double nActualPrice, double nPurported, double nTolerance)
 
 bool VerifyDashStake(CTransactionRef tx, std::string& sError)
 {
-    std::string sXML = tx->GetTxMessage();
 	DashStake w = GetDashStake(tx);
 	if (!w.found)
 		return true;
@@ -4275,10 +4610,8 @@ double GetVinAge(int64_t nVINTime, int64_t nSpendTime, CAmount nAmount)
 double GetWhaleStakesInMemoryPool(std::string sCPK)
 {
 	double nTotal = 0;
-	BOOST_FOREACH(const CTxMemPoolEntry& e, mempool.mapTx)
-    {
-        const CTransaction& tx = e.GetTx();
-		CTransactionRef tx1 = MakeTransactionRef(std::move(tx));
+	for (const CTransactionRef& tx1 : mempool.getBurns())
+	{
 		WhaleStake w = GetWhaleStake(tx1);
 		if (w.found)
 		{
@@ -4297,22 +4630,17 @@ CoinVin GetCoinVIN(COutPoint o, int64_t nTxTime)
 	b.OutPoint = o;
 	b.HashBlock = uint256();
 	// Special case if the transaction is not in a block:
-    BOOST_FOREACH(const CTxMemPoolEntry& e, mempool.mapTx)
-    {
-        const uint256& hash = e.GetTx().GetHash();
-		if (hash == o.hash)
-		{
-			const CTransaction& tx = e.GetTx();
-			CTransactionRef tx1 = MakeTransactionRef(std::move(tx));
-			b.TxRef = tx1;
-			b.BlockTime = GetAdjustedTime(); //Memory Pool
-			b.Amount = b.TxRef->vout[b.OutPoint.n].nValue;
-			b.Destination = PubKeyToAddress(b.TxRef->vout[b.OutPoint.n].scriptPubKey);
-			b.CoinAge = GetVinAge(b.BlockTime, nTxTime, b.Amount);
-			b.Found = true;
-			return b;
-		}
-    }
+	CTransactionRef txMemPool = mempool.get(o.hash);
+	if (txMemPool)
+	{
+		b.TxRef = txMemPool;
+		b.BlockTime = GetAdjustedTime(); //Memory Pool
+		b.Amount = b.TxRef->vout[b.OutPoint.n].nValue;
+		b.Destination = PubKeyToAddress(b.TxRef->vout[b.OutPoint.n].scriptPubKey);
+		b.CoinAge = GetVinAge(b.BlockTime, nTxTime, b.Amount);
+		b.Found = true;
+		return b;
+	}
 
 	if (GetTransaction(b.OutPoint.hash, b.TxRef, Params().GetConsensus(), b.HashBlock, true))
 	{
@@ -4361,10 +4689,10 @@ std::string SearchChain(int nBlocks, std::string sDest)
 		{
 			for (unsigned int n = 0; n < block.vtx.size(); n++)
 			{
-				std::string sMsg = GetTransactionMessage(block.vtx[n]);
-				std::string sCPK = ExtractXML(sMsg, "<cpk>", "</cpk>");
-				std::string sUSD = ExtractXML(sMsg, "<amount_usd>", "</amount_usd>");
-				std::string sChildID = ExtractXML(sMsg, "<childid>", "</childid>");
+				const CTxMessage& txMessage = block.vtx[n]->GetParsedTxMessage();
+				std::string sCPK = txMessage.GetTag("cpk");
+				std::string sUSD = txMessage.GetTag("amount_usd");
+				std::string sChildID = txMessage.GetTag("childid");
 				boost::trim(sChildID);
 
 				for (int i = 0; i < block.vtx[n]->vout.size(); i++)
@@ -4449,32 +4777,44 @@ std::string ReverseHex(std::string const & src)
     return result;
 }
 
-static std::map<int, std::mutex> cs_rxhash;
-uint256 GetRandomXHash(std::string sHeaderHex, uint256 key, uint256 hashPrevBlock, int iThreadID)
+uint256 GetRandomXHash(const RandomXHeaderBytes& vchHeader, const uint256& key, const uint256& hashPrevBlock, int iThreadID)
 {
 	// *****************************************                      RandomX                                    ************************************************************************
 	// Starting at RANDOMX_HEIGHT, we now solve for an equation, rather than simply the difficulty and target.  (See prevention of preimage attacks in our wiki https://wiki.biblepay.org/Preventing_Preimage_Attacks)
 	// This is so our miners may earn a dual revenue stream (RandomX coins + DAC/BiblePay Coins).
 	// The equation is:  BlakeHash(Previous_DAC_Hash + RandomX_Hash(RandomX_Coin_Header)) < Current_DAC_Block_Difficulty
 	// **********************************************************************************************************************************************************************************
-	std::unique_lock<std::mutex> lock(cs_rxhash[iThreadID]);
-	std::vector<unsigned char> vch(160);
-	CVectorWriter ss(SER_NETWORK, PROTOCOL_VERSION, vch, 0);
-	std::string randomXBlockHeader = ExtractXML(sHeaderHex, "<rxheader>", "</rxheader>");
-	std::vector<unsigned char> data0 = ParseHex(randomXBlockHeader);
-	uint256 uRXMined = RandomX_Hash(data0, key, iThreadID);
-	ss << hashPrevBlock << uRXMined;
-	return HashBlake((const char *)vch.data(), (const char *)vch.data() + vch.size());
+	uint256 uRXMined = RandomX_Hash(vchHeader.data(), vchHeader.size(), key);
+	return GetRandomXBlakeHash(uRXMined, hashPrevBlock);
 }
 
-uint256 GetRandomXHash2(std::string sHeaderHex, uint256 key, uint256 hashPrevBlock, int iThreadID)
+uint256 GetRandomXBlakeHash(const uint256& uRXMined, const uint256& hashPrevBlock)
+{
+	// Preimage is hashPrevBlock + uRXMined, zero padded to 160 bytes
+	unsigned char vch[160] = {0};
+	memcpy(vch, hashPrevBlock.begin(), 32);
+	memcpy(vch + 32, uRXMined.begin(), 32);
+	return HashBlake((const char *)vch, (const char *)vch + sizeof(vch));
+}
+
+uint256 GetRandomXHash2(const RandomXHeaderBytes& vchHeader, const uint256& key, const uint256& hashPrevBlock, int iThreadID)
 {
 	// *****************************************                      RandomX - Hash Only                          ************************************************************************
-	std::unique_lock<std::mutex> lock(cs_rxhash[iThreadID]);
-	std::string randomXBlockHeader = ExtractXML(sHeaderHex, "<rxheader>", "</rxheader>");
-	std::vector<unsigned char> data0 = ParseHex(randomXBlockHeader);
-	uint256 uRXMined = RandomX_Hash(data0, key, iThreadID);
-	return uRXMined;
+	return RandomX_Hash(vchHeader.data(), vchHeader.size(), key);
+}
+
+uint256 GetRandomXHash(std::string sHeaderHex, uint256 key, uint256 hashPrevBlock, int iThreadID)
+{
+	RandomXHeaderBytes vchHeader;
+	DecodeRandomXHeader(sHeaderHex, vchHeader);
+	return GetRandomXHash(vchHeader, key, hashPrevBlock, iThreadID);
+}
+
+uint256 GetRandomXHash2(std::string sHeaderHex, uint256 key, uint256 hashPrevBlock, int iThreadID)
+{
+	RandomXHeaderBytes vchHeader;
+	DecodeRandomXHeader(sHeaderHex, vchHeader);
+	return GetRandomXHash2(vchHeader, key, hashPrevBlock, iThreadID);
 }
 
 std::tuple<std::string, std::string, std::string> GetOrphanPOOSURL(std::string sSanctuaryPubKey)
@@ -4594,45 +4934,40 @@ CoinAgeVotingDataStruct GetCoinAgeVotingData(std::string sGobjectID)
 	std::string sOutcomes = "YES;NO;ABSTAIN";
 	std::vector<std::string> vOutcomes = Split(sOutcomes.c_str(), ";");
 		
-	for (auto ii : mvApplicationCache) 
+	// Calculate the coin-age-sums
+	for (int i = 0; i < vOutcomes.size(); i++)
 	{
-		std::pair<std::string, int64_t> v = mvApplicationCache[std::make_pair(ii.first.first, ii.first.second)];
-		std::string sCPK = ii.first.second;
-		std::string sValue = v.first;
-		// Calculate the coin-age-sums
-		for (int i = 0; i < vOutcomes.size(); i++)
+		std::string sSumKey = "COINAGE-VOTE-SUM-" + vOutcomes[i] + "-" + sGobjectID;
+		boost::to_upper(sSumKey);
+		for (const auto& ii : mvApplicationCache.GetSection(sSumKey))
 		{
-			std::string sSumKey = "COINAGE-VOTE-SUM-" + vOutcomes[i] + "-" + sGobjectID;
-			boost::to_upper(sSumKey);
-			if (ii.first.first == sSumKey)
-			{
-				double nValue = cdbl(v.first, 2);
-				c.mapsVoteAge[i][sCPK] += nValue;
-				c.mapTotalCoinAge[i] += nValue;
-			}
+			double nValue = cdbl(ii.second.first, 2);
+			c.mapsVoteAge[i][ii.first] += nValue;
+			c.mapTotalCoinAge[i] += nValue;
 		}
+	}
 
-		// Calculate the vote-totals
-		std::string sVoteKey = "COINAGE-VOTE-COUNT-" + sGobjectID;
-		boost::to_upper(sVoteKey);
-		if (ii.first.first == sVoteKey)
+	// Calculate the vote-totals
+	std::string sVoteKey = "COINAGE-VOTE-COUNT-" + sGobjectID;
+	boost::to_upper(sVoteKey);
+	for (const auto& ii : mvApplicationCache.GetSection(sVoteKey))
+	{
+		const std::string& sCPK = ii.first;
+		const std::string& sOutcome = ii.second.first;
+		if (sOutcome == "YES")
 		{
-			std::string sOutcome = v.first;
-			if (sOutcome == "YES")
-			{
-				c.mapsVoteCount[0][sCPK]++;
-				c.mapTotalVotes[0]++;
-			}
-			else if (sOutcome == "NO")
-			{
-				c.mapsVoteCount[1][sCPK]++;
-				c.mapTotalVotes[1]++;
-			}
-			else if (sOutcome == "ABSTAIN")
-			{
-				c.mapsVoteCount[2][sCPK]++;
-				c.mapTotalVotes[2]++;
-			}
+			c.mapsVoteCount[0][sCPK]++;
+			c.mapTotalVotes[0]++;
+		}
+		else if (sOutcome == "NO")
+		{
+			c.mapsVoteCount[1][sCPK]++;
+			c.mapTotalVotes[1]++;
+		}
+		else if (sOutcome == "ABSTAIN")
+		{
+			c.mapsVoteCount[2][sCPK]++;
+			c.mapTotalVotes[2]++;
 		}
 	}
 	return c;
@@ -4712,52 +5047,161 @@ std::vector<char> HexToBytes(const std::string& hex)
   return bytes;
 }
 
-bool EncryptFile(std::string sPath, std::string sTargetPath)
+// BIPFS encrypted container.  A file, or the concatenation of its upload parts, is a run of self-contained records:
+// a header (magic, file id, sequence number, flags, plaintext length, IV), the AES-256-CTR ciphertext of up to
+// BIPFS_CHUNK_SIZE bytes, and an HMAC-SHA256 tag over the header and the ciphertext.  Only the last record carries the
+// final flag, so a truncated, reordered or spliced stream fails to decrypt.
+static const unsigned char BIPFS_RECORD_MAGIC[4] = { 'B', 'B', 'E', '1' };
+static const size_t BIPFS_CHUNK_SIZE = 1 << 20;
+static const size_t BIPFS_FILE_ID_SIZE = 8;
+static const size_t BIPFS_RECORD_HEADER_SIZE = 4 + BIPFS_FILE_ID_SIZE + 4 + 1 + 4 + AES_BLOCKSIZE;
+static const size_t BIPFS_RECORD_TAG_SIZE = CHMAC_SHA256::OUTPUT_SIZE;
+static const unsigned char BIPFS_RECORD_FINAL = 1;
+
+struct BIPFSKeys
 {
-	int iFileSize = GETFILESIZE(sPath);
-	if (iFileSize < 1)
+	unsigned char vchEncryption[AES256_KEYSIZE];
+	unsigned char vchAuthentication[CHMAC_SHA256::OUTPUT_SIZE];
+
+	~BIPFSKeys()
 	{
-		return false;
+		memory_cleanse(vchEncryption, sizeof(vchEncryption));
+		memory_cleanse(vchAuthentication, sizeof(vchAuthentication));
 	}
-    std::ifstream ifs(sPath, std::ios::binary|std::ios::ate);
-	std::ofstream OutFile;
-	OutFile.open(sTargetPath.c_str(), std::ios::out | std::ios::binary);
-	int iPos = 0;
-	int OP_SIZE = 1024;
-	// BIBLEPAY - We currently get the key from the biblepay.conf file (from the encryptionkey setting)
+};
+
+// BIBLEPAY - We currently get the key from the biblepay.conf file (from the encryptionkey setting)
+static bool GetBIPFSKeys(BIPFSKeys& keys)
+{
 	std::string sEncryptionKey = GetArg("-encryptionkey", "");
 	if (sEncryptionKey.empty())
+		return false;
+	static const std::string sEncryptionLabel = "BIPFS encryption";
+	static const std::string sAuthenticationLabel = "BIPFS authentication";
+	CHMAC_SHA256((const unsigned char*)sEncryptionKey.data(), sEncryptionKey.size())
+		.Write((const unsigned char*)sEncryptionLabel.data(), sEncryptionLabel.size()).Finalize(keys.vchEncryption);
+	CHMAC_SHA256((const unsigned char*)sEncryptionKey.data(), sEncryptionKey.size())
+		.Write((const unsigned char*)sAuthenticationLabel.data(), sAuthenticationLabel.size()).Finalize(keys.vchAuthentication);
+	memory_cleanse(&sEncryptionKey[0], sEncryptionKey.size());
+	return true;
+}
+
+/** Seals a plaintext stream into BIPFS records, one chunk at a time */
+class CBIPFSEncryptor
+{
+public:
+	CBIPFSEncryptor(const BIPFSKeys& keysIn) : keys(keysIn), nSequence(0)
+	{
+		GetRandBytes(vchFileId, sizeof(vchFileId));
+	}
+
+	void Seal(const unsigned char* pch, size_t nLen, bool fFinal, std::vector<unsigned char>& vchRecord)
+	{
+		vchRecord.resize(BIPFS_RECORD_HEADER_SIZE + nLen + BIPFS_RECORD_TAG_SIZE);
+		unsigned char* pHeader = vchRecord.data();
+		memcpy(pHeader, BIPFS_RECORD_MAGIC, sizeof(BIPFS_RECORD_MAGIC));
+		memcpy(pHeader + 4, vchFileId, BIPFS_FILE_ID_SIZE);
+		WriteLE32(pHeader + 4 + BIPFS_FILE_ID_SIZE, nSequence++);
+		pHeader[8 + BIPFS_FILE_ID_SIZE] = fFinal ? BIPFS_RECORD_FINAL : 0;
+		WriteLE32(pHeader + 9 + BIPFS_FILE_ID_SIZE, (uint32_t)nLen);
+		unsigned char* pIV = pHeader + 13 + BIPFS_FILE_ID_SIZE;
+		GetRandBytes(pIV, AES_BLOCKSIZE);
+		AES256CTR(keys.vchEncryption, pIV).Crypt(pch, nLen, pHeader + BIPFS_RECORD_HEADER_SIZE);
+		CHMAC_SHA256(keys.vchAuthentication, sizeof(keys.vchAuthentication))
+			.Write(pHeader, BIPFS_RECORD_HEADER_SIZE + nLen).Finalize(pHeader + BIPFS_RECORD_HEADER_SIZE + nLen);
+	}
+
+private:
+	const BIPFSKeys& keys;
+	unsigned char vchFileId[BIPFS_FILE_ID_SIZE];
+	uint32_t nSequence;
+};
+
+static bool IsBIPFSContainer(const std::string& sPath)
+{
+	unsigned char vchMagic[sizeof(BIPFS_RECORD_MAGIC)];
+	std::ifstream ifs(sPath, std::ios::binary);
+	return ifs.read((char*)vchMagic, sizeof(vchMagic)) && memcmp(vchMagic, BIPFS_RECORD_MAGIC, sizeof(vchMagic)) == 0;
+}
+
+/** Verify and decrypt a whole container from is to os.  Nothing unauthenticated is written */
+static bool OpenBIPFSContainer(std::istream& is, std::ostream& os, const BIPFSKeys& keys)
+{
+	unsigned char vchFileId[BIPFS_FILE_ID_SIZE];
+	unsigned char vchTag[BIPFS_RECORD_TAG_SIZE];
+	std::vector<unsigned char> vchRecord;
+	std::vector<unsigned char> vchPlain;
+	for (uint32_t nSequence = 0; ; nSequence++)
+	{
+		vchRecord.resize(BIPFS_RECORD_HEADER_SIZE);
+		if (!is.read((char*)vchRecord.data(), BIPFS_RECORD_HEADER_SIZE))
+			return false;
+		const unsigned char* pHeader = vchRecord.data();
+		uint32_t nLen = ReadLE32(pHeader + 9 + BIPFS_FILE_ID_SIZE);
+		if (memcmp(pHeader, BIPFS_RECORD_MAGIC, sizeof(BIPFS_RECORD_MAGIC)) != 0 || nLen > BIPFS_CHUNK_SIZE)
+			return false;
+		if (ReadLE32(pHeader + 4 + BIPFS_FILE_ID_SIZE) != nSequence)
+			return false;
+		if (nSequence == 0)
+			memcpy(vchFileId, pHeader + 4, BIPFS_FILE_ID_SIZE);
+		else if (memcmp(vchFileId, pHeader + 4, BIPFS_FILE_ID_SIZE) != 0)
+			return false;
+		bool fFinal = pHeader[8 + BIPFS_FILE_ID_SIZE] == BIPFS_RECORD_FINAL;
+
+		vchRecord.resize(BIPFS_RECORD_HEADER_SIZE + nLen + BIPFS_RECORD_TAG_SIZE);
+		if (!is.read((char*)vchRecord.data() + BIPFS_RECORD_HEADER_SIZE, nLen + BIPFS_RECORD_TAG_SIZE))
+			return false;
+		pHeader = vchRecord.data();
+		CHMAC_SHA256(keys.vchAuthentication, sizeof(keys.vchAuthentication)).Write(pHeader, BIPFS_RECORD_HEADER_SIZE + nLen).Finalize(vchTag);
+		unsigned char nDiff = 0;
+		for (size_t i = 0; i < BIPFS_RECORD_TAG_SIZE; i++)
+			nDiff |= vchTag[i] ^ pHeader[BIPFS_RECORD_HEADER_SIZE + nLen + i];
+		if (nDiff != 0)
+			return false;
+
+		vchPlain.resize(nLen);
+		AES256CTR(keys.vchEncryption, pHeader + 13 + BIPFS_FILE_ID_SIZE).Crypt(pHeader + BIPFS_RECORD_HEADER_SIZE, nLen, vchPlain.data());
+		os.write((const char*)vchPlain.data(), nLen);
+		if (fFinal)
+			return is.peek() == std::char_traits<char>::eof();
+	}
+}
+
+bool EncryptFile(std::string sPath, std::string sTargetPath)
+{
+	int64_t nFileSize = GETFILESIZE(sPath);
+	if (nFileSize < 1)
+	{
+		return false;
+	}
+	BIPFSKeys keys;
+	if (!GetBIPFSKeys(keys))
 	{
 		LogPrintf("IPFS::EncryptFile::EncryptionKey Empty %f", 1);
 		return false;
 	}
 	LogPrintf(" IPFS::Encrypting file %s", sTargetPath);
 
-	while(true)
+	std::ifstream ifs(sPath, std::ios::binary);
+	std::ofstream OutFile(sTargetPath, std::ios::out | std::ios::binary);
+	CBIPFSEncryptor encryptor(keys);
+	std::vector<unsigned char> vchChunk(BIPFS_CHUNK_SIZE);
+	std::vector<unsigned char> vchRecord;
+	for (int64_t nPos = 0; nPos < nFileSize; )
 	{
-		// Encrypt chunks of 64K at a time
-		int iBytesLeft = iFileSize - iPos;
-		int iBytesToRead = iBytesLeft;
-		if (iBytesToRead > OP_SIZE)
-			iBytesToRead = OP_SIZE;
-		std::vector<char> buffer(1024);
-		ifs.seekg(iPos, std::ios::beg);
-		ifs.read(&buffer[0], iBytesToRead);
-		// Encryption Section
-		std::string sBlockHex = HexStr(buffer.begin(), buffer.end());
-		std::string sEncrypted = EncryptAES256(sBlockHex, sEncryptionKey);
-		// End of Encryption Section
-		OutFile.write(&sEncrypted[0], sEncrypted.size());
-		if (iPos >= iFileSize)
-			break;
-		iPos += iBytesToRead;
+		size_t nLen = (size_t)std::min((int64_t)BIPFS_CHUNK_SIZE, nFileSize - nPos);
+		if (!ifs.read((char*)vchChunk.data(), nLen))
+			return false;
+		nPos += nLen;
+		encryptor.Seal(vchChunk.data(), nLen, nPos == nFileSize, vchRecord);
+		OutFile.write((const char*)vchRecord.data(), vchRecord.size());
 	}
 	OutFile.close();
-    ifs.close();
-	return true;
+	return !OutFile.fail();
 }
 
-bool DecryptFile(std::string sPath, std::string sTargetPath)
+// Files encrypted before the BIPFS container: 1 KB blocks, hex encoded and AES-256-CBC encrypted into base64 chunks of 2752 bytes
+static bool DecryptLegacyFile(std::string sPath, std::string sTargetPath)
 {
 	int iFileSize = GETFILESIZE(sPath);
 	if (iFileSize < 1)
@@ -4798,44 +5242,126 @@ bool DecryptFile(std::string sPath, std::string sTargetPath)
 	return true;
 }
 
+bool DecryptFile(std::string sPath, std::string sTargetPath)
+{
+	if (GETFILESIZE(sPath) < 1)
+	{
+		return false;
+	}
+	if (!IsBIPFSContainer(sPath))
+		return DecryptLegacyFile(sPath, sTargetPath);
+
+	BIPFSKeys keys;
+	if (!GetBIPFSKeys(keys))
+	{
+		LogPrintf("IPFS::DecryptFile::EncryptionKey Empty %f", 1);
+		return false;
+	}
+	std::ifstream ifs(sPath, std::ios::binary);
+	std::ofstream OutFile(sTargetPath, std::ios::out | std::ios::binary);
+	bool fResult = OpenBIPFSContainer(ifs, OutFile, keys);
+	OutFile.close();
+	if (!fResult || OutFile.fail())
+	{
+		LogPrintf("IPFS::DecryptFile::Unable to authenticate %s ", sPath);
+		boost::filesystem::remove(sTargetPath);
+		return false;
+	}
+	return true;
+}
 
 static int MAX_SPLITTER_PARTS = 7000;
 static int MAX_PART_SIZE = 10000000;
-std::string SplitFile(std::string sPath)
+bool SplitFile(std::string sPath, bool fEncrypted, std::string& sDir, std::vector<BIPFSPart>& vParts)
 {
+	vParts.clear();
+	int64_t nFileSize = GETFILESIZE(sPath);
+	BIPFSKeys keys;
+	if (nFileSize < 1)
+		return false;
+	if (fEncrypted && !GetBIPFSKeys(keys))
+	{
+		LogPrintf("IPFS::SplitFile::EncryptionKey Empty %f", 1);
+		return false;
+	}
 	std::string sMD5 = RetrieveMd5(sPath);
-    std::string sDir = GetSANDirectory2() + sMD5;
+    sDir = GetSANDirectory2() + sMD5;
 	boost::filesystem::path pathSAN(sDir);
     if (!boost::filesystem::exists(pathSAN))
 	{
 		boost::filesystem::create_directory(pathSAN);
 	}
-	int iFileSize = GETFILESIZE(sPath);
-    std::ifstream ifs(sPath, std::ios::binary|std::ios::ate);
-	int iPos = 0;		
-	int iPart = 0;	
-	for (int i = 0; i < MAX_SPLITTER_PARTS; i++)
-	{
-		int iBytesLeft = iFileSize - iPos;
-		int iBytesToRead = iBytesLeft;
-		if (iBytesToRead > MAX_PART_SIZE)
-			iBytesToRead = MAX_PART_SIZE;
-		std::vector<char> buffer(10000000);
-		ifs.seekg(iPos, std::ios::beg);
-		ifs.read(&buffer[0], iBytesToRead);
-		std::string sPartPath = sDir + "/" + RoundToString(iPart, 0) + ".dat";
-		std::ofstream OutFile;
-		OutFile.open(sPartPath.c_str(), std::ios::out | std::ios::binary);
-		OutFile.write(&buffer[0], iBytesToRead);
+
+	// The file is read once: each chunk is encrypted (as one whole record, which never straddles two parts) or
+	// copied as is, and written to the current part while the part hash is accumulated
+	std::ifstream ifs(sPath, std::ios::binary);
+	std::ofstream OutFile;
+	CSHA256 hasher;
+	CBIPFSEncryptor encryptor(keys);
+	std::vector<unsigned char> vchChunk(BIPFS_CHUNK_SIZE);
+	std::vector<unsigned char> vchRecord;
+
+	auto ClosePart = [&]() -> bool {
+		if (!OutFile.is_open())
+			return true;
 		OutFile.close();
-		iPos += iBytesToRead;
-		if (iPos >= iFileSize)
-			break;
-        iPart++;
+		unsigned char vchHash[CSHA256::OUTPUT_SIZE];
+		hasher.Finalize(vchHash);
+		vParts.back().sHash = HexStr(vchHash, vchHash + sizeof(vchHash));
+		return !OutFile.fail();
+	};
+	auto WritePart = [&](const unsigned char* pch, size_t nLen, bool fSplittable) -> bool {
+		while (nLen > 0)
+		{
+			if (OutFile.is_open() && (vParts.back().nSize == MAX_PART_SIZE || (!fSplittable && vParts.back().nSize + (int64_t)nLen > MAX_PART_SIZE)))
+			{
+				if (!ClosePart())
+					return false;
+			}
+			if (!OutFile.is_open())
+			{
+				if ((int)vParts.size() == MAX_SPLITTER_PARTS)
+					return false;
+				BIPFSPart part;
+				part.sPath = sDir + "/" + RoundToString(vParts.size(), 0) + ".dat";
+				vParts.push_back(part);
+				OutFile.open(part.sPath.c_str(), std::ios::out | std::ios::binary);
+				hasher.Reset();
+			}
+			size_t nWrite = fSplittable ? std::min(nLen, (size_t)(MAX_PART_SIZE - vParts.back().nSize)) : nLen;
+			OutFile.write((const char*)pch, nWrite);
+			hasher.Write(pch, nWrite);
+			vParts.back().nSize += nWrite;
+			pch += nWrite;
+			nLen -= nWrite;
+		}
+		return true;
+	};
+
+	for (int64_t nPos = 0; nPos < nFileSize; )
+	{
+		size_t nLen = (size_t)std::min((int64_t)BIPFS_CHUNK_SIZE, nFileSize - nPos);
+		if (!ifs.read((char*)vchChunk.data(), nLen))
+			return false;
+		nPos += nLen;
+		bool fResult;
+		if (fEncrypted)
+		{
+			encryptor.Seal(vchChunk.data(), nLen, nPos == nFileSize, vchRecord);
+			fResult = WritePart(vchRecord.data(), vchRecord.size(), false);
+		}
+		else
+		{
+			fResult = WritePart(vchChunk.data(), nLen, true);
+		}
+		if (!fResult)
+		{
+			LogPrintf("IPFS::SplitFile::Unable to split %s ", sPath);
+			return false;
+		}
 	}
-	ifs.close();
 	// We calculate the md5 hash of the splitter directory (for safety), and return the path to the caller.  (This prevents biblepay from deleting any of the users files by accident).
-    return sDir;
+	return ClosePart();
 }
 
 CAmount CalculateIPFSFee(int nTargetDensity, int nDurationDays, int nSize)
@@ -4866,154 +5392,475 @@ CAmount CalculateIPFSFee(int nTargetDensity, int nDurationDays, int nSize)
 	return nFee * COIN;
 }
 
-DACResult BIPFS_UploadFile(std::string sLocalPath, std::string sWebPath, std::string sTXID, int iTargetDensity, int nDurationDays, bool fDryRun, bool fEncrypted)
+// Resumable BIPFS uploads.  A file is split once into its SAN directory, next to a manifest holding the upload
+// parameters, the web path, the size and SHA256 of the source file, and the size, SHA256 and upload state of every part.
+// Running the same upload again (same TXID and parameters, unchanged source) only sends the parts the sidechain has not
+// acknowledged yet.  Parts are sent BIPFS_PARALLEL_PARTS at a time through the pooled sidechain HTTP workers; the last
+// part of a file, whose response carries the storage URLs, is sent once every other part of that file is stored.
+static const int BIPFS_PARALLEL_PARTS = 4;
+static const int BIPFS_PART_ATTEMPTS = 3;
+
+static std::string GetFileSHA256(const std::string& sPath)
 {
-	// The sidechain stored file must contain the target density, the lease duration, and the correct amount.
-	// The corresponding TXID must contain the hash of the file URL
-	std::string sDir = SplitFile(sLocalPath);
-	DACResult d;
+	std::ifstream ifs(sPath, std::ios::binary);
+	if (!ifs)
+		return std::string();
+	CSHA256 hasher;
+	std::vector<char> vch(BIPFS_CHUNK_SIZE);
+	while (ifs.read(vch.data(), vch.size()) || ifs.gcount() > 0)
+		hasher.Write((const unsigned char*)vch.data(), ifs.gcount());
+	unsigned char vchHash[CSHA256::OUTPUT_SIZE];
+	hasher.Finalize(vchHash);
+	return HexStr(vchHash, vchHash + sizeof(vchHash));
+}
+
+bool WriteBIPFSManifest(const BIPFSUpload& u)
+{
+	UniValue parts(UniValue::VARR);
+	for (size_t i = 0; i < u.vParts.size(); i++)
+	{
+		UniValue part(UniValue::VOBJ);
+		part.pushKV("name", boost::filesystem::path(u.vParts[i].sPath).filename().string());
+		part.pushKV("size", u.vParts[i].nSize);
+		part.pushKV("hash", u.vParts[i].sHash);
+		part.pushKV("uploaded", UniValue((bool)u.vUploaded[i]));
+		parts.push_back(part);
+	}
+	UniValue manifest(UniValue::VOBJ);
+	manifest.pushKV("txid", u.sTXID);
+	manifest.pushKV("density", u.nDensity);
+	manifest.pushKV("duration", u.nDuration);
+	manifest.pushKV("encrypted", UniValue(u.fEncrypted));
+	manifest.pushKV("web_path", u.sWebPath);
+	manifest.pushKV("source_size", u.nSourceSize);
+	manifest.pushKV("source_hash", u.sSourceHash);
+	manifest.pushKV("response", u.sFinalResponse);
+	manifest.pushKV("parts", parts);
+
+	std::string sPath = u.sDir + "/manifest.json";
+	std::string sTemp = sPath + ".new";
+	std::ofstream OutFile(sTemp, std::ios::out | std::ios::trunc);
+	OutFile << manifest.write();
+	OutFile.close();
+	if (OutFile.fail() || !RenameOver(sTemp, sPath))
+	{
+		LogPrintf("IPFS::WriteBIPFSManifest::Unable to write %s ", sPath);
+		return false;
+	}
+	return true;
+}
 
-	if (sDir.empty())
+bool ReadBIPFSManifest(const std::string& sDir, BIPFSUpload& u)
+{
+	std::ifstream ifs(sDir + "/manifest.json");
+	if (!ifs)
+		return false;
+	std::string sData((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+	UniValue manifest;
+	if (!manifest.read(sData) || !manifest.isObject())
+		return false;
+	const UniValue& parts = find_value(manifest, "parts");
+	if (!parts.isArray() || !find_value(manifest, "txid").isStr() || !find_value(manifest, "encrypted").isBool()
+		|| !find_value(manifest, "response").isStr() || !find_value(manifest, "density").isNum()
+		|| !find_value(manifest, "duration").isNum() || !find_value(manifest, "source_size").isNum()
+		|| !find_value(manifest, "source_hash").isStr() || !find_value(manifest, "web_path").isStr())
+		return false;
+	u.sDir = sDir;
+	u.sTXID = find_value(manifest, "txid").get_str();
+	u.nDensity = find_value(manifest, "density").get_int();
+	u.nDuration = find_value(manifest, "duration").get_int();
+	u.fEncrypted = find_value(manifest, "encrypted").get_bool();
+	u.sWebPath = find_value(manifest, "web_path").get_str();
+	u.nSourceSize = find_value(manifest, "source_size").get_int64();
+	u.sSourceHash = find_value(manifest, "source_hash").get_str();
+	u.sFinalResponse = find_value(manifest, "response").get_str();
+	u.vParts.clear();
+	u.vUploaded.clear();
+	for (size_t i = 0; i < parts.size(); i++)
+	{
+		const UniValue& part = parts[i];
+		if (!part.isObject() || !find_value(part, "name").isStr() || !find_value(part, "size").isNum()
+			|| !find_value(part, "hash").isStr() || !find_value(part, "uploaded").isBool())
+			return false;
+		BIPFSPart p;
+		p.sPath = sDir + "/" + find_value(part, "name").get_str();
+		p.nSize = find_value(part, "size").get_int64();
+		p.sHash = find_value(part, "hash").get_str();
+		u.vParts.push_back(p);
+		u.vUploaded.push_back(find_value(part, "uploaded").get_bool());
+	}
+	return !u.vParts.empty();
+}
+
+// Whether manifest m was written for the upload described by u, apart from the TXID
+static bool MatchesBIPFSManifest(const BIPFSUpload& m, const BIPFSUpload& u)
+{
+	return m.nDensity == u.nDensity && m.nDuration == u.nDuration && m.fEncrypted == u.fEncrypted && m.sWebPath == u.sWebPath
+		&& m.nSourceSize == u.nSourceSize && !u.sSourceHash.empty() && m.sSourceHash == u.sSourceHash;
+}
+
+void DescribeBIPFSUpload(std::string sLocalPath, std::string sWebPath, std::string sTXID, int iTargetDensity, int nDurationDays, bool fEncrypted, BIPFSUpload& u)
+{
+	u.sLocalPath = sLocalPath;
+	u.sWebPath = sWebPath;
+	u.sOriginalName = boost::filesystem::path(sLocalPath).filename().string();
+	u.sDir = GetSANDirectory2() + RetrieveMd5(sLocalPath);
+	u.sTXID = sTXID;
+	u.nDensity = iTargetDensity;
+	u.nDuration = nDurationDays;
+	u.fEncrypted = fEncrypted;
+	u.nSourceSize = GETFILESIZE(sLocalPath);
+	u.sSourceHash = u.nSourceSize > 0 ? GetFileSHA256(sLocalPath) : std::string();
+}
+
+static bool IsBIPFSUploadComplete(const BIPFSUpload& u)
+{
+	return !u.sFinalResponse.empty();
+}
+
+// Fills in the upload of one file: the fee, and either the parts left by an interrupted upload of the same file (when
+// they still match their checksums) or a fresh split
+static bool PrepareBIPFSUpload(std::string sLocalPath, std::string sWebPath, std::string sTXID, int iTargetDensity, int nDurationDays, bool fEncrypted, BIPFSUpload& u, DACResult& d)
+{
+	DescribeBIPFSUpload(sLocalPath, sWebPath, sTXID, iTargetDensity, nDurationDays, fEncrypted, u);
+	if (u.nSourceSize < 1)
+	{
+		d.ErrorCode = "FILE_MISSING";
+		return false;
+	}
+	u.nFee = CalculateIPFSFee(iTargetDensity, nDurationDays, u.nSourceSize);
+	if (u.nFee/COIN < 1)
+	{
+		d.ErrorCode = "FEE_ERROR";
+		return false;
+	}
+	d.nFee = u.nFee;
+	d.nSize = u.nSourceSize;
+
+	BIPFSUpload m;
+	if (ReadBIPFSManifest(u.sDir, m) && m.sTXID == sTXID && MatchesBIPFSManifest(m, u))
+	{
+		bool fIntact = true;
+		int nPending = 0;
+		for (size_t i = 0; i < m.vParts.size() && fIntact; i++)
+		{
+			if (m.vUploaded[i])
+				continue;
+			nPending++;
+			fIntact = GETFILESIZE(m.vParts[i].sPath) == m.vParts[i].nSize && GetFileSHA256(m.vParts[i].sPath) == m.vParts[i].sHash;
+		}
+		if (fIntact)
+		{
+			LogPrintf("IPFS::PrepareBIPFSUpload::Resuming %s, %f of %f parts left ", sLocalPath, nPending, (int)m.vParts.size());
+			u.vParts = m.vParts;
+			u.vUploaded = m.vUploaded;
+			u.sFinalResponse = m.sFinalResponse;
+			return true;
+		}
+		LogPrintf("IPFS::PrepareBIPFSUpload::Parts of %s changed on disk, splitting again ", sLocalPath);
+	}
+
+	RelinquishSpace(sLocalPath);
+	bool fSplit = SplitFile(sLocalPath, fEncrypted, u.sDir, u.vParts);
+	if (u.sDir.empty())
 	{
 		d.ErrorCode = "DIRECTORY_EMPTY";
-		return d;
+		return false;
+	}
+	if (!fSplit)
+	{
+		RelinquishSpace(sLocalPath);
+		d.ErrorCode = "SPLIT_ERROR";
+		return false;
 	}
-	boost::filesystem::path p(sLocalPath);
-	std::string sOriginalName = p.filename().string();
+	u.vUploaded.assign(u.vParts.size(), false);
+	u.sFinalResponse.clear();
+	WriteBIPFSManifest(u);
+	return true;
+}
+
+// Sends the parts of every upload that are not stored yet, sharing one window of in-flight requests across files.  A
+// part is tried BIPFS_PART_ATTEMPTS times; a file whose part keeps failing stops there (u.sError) and keeps its state for
+// a later resume, while the other files carry on.
+static void RunBIPFSUploads(std::vector<BIPFSUpload>& vUploads)
+{
+	struct InFlight
+	{
+		size_t nFile;
+		int nPart;
+		std::future<DACHttpResponse> result;
+	};
 	std::string sURL = "https://" + GetSporkValue("bms");
-	boost::filesystem::path pathDir = sDir;
-	int iFileSize = GETFILESIZE(sLocalPath);
-	if (iFileSize < 1)
+	std::string sPage = "UnchainedUpload";
+	std::deque<std::pair<size_t, int>> dqPending;
+	std::map<std::pair<size_t, int>, int> mapAttempts;
+	std::vector<int> vRemaining(vUploads.size(), 0);
+	std::list<InFlight> lInFlight;
+
+	for (size_t f = 0; f < vUploads.size(); f++)
+	{
+		BIPFSUpload& u = vUploads[f];
+		if (IsBIPFSUploadComplete(u))
+			continue;
+		int nLast = (int)u.vParts.size() - 1;
+		for (int i = 0; i < nLast; i++)
+		{
+			if (!u.vUploaded[i])
+			{
+				dqPending.push_back(std::make_pair(f, i));
+				vRemaining[f]++;
+			}
+		}
+		if (vRemaining[f] == 0)
+			dqPending.push_back(std::make_pair(f, nLast));
+	}
+
+	while (!dqPending.empty() || !lInFlight.empty())
+	{
+		while ((int)lInFlight.size() < BIPFS_PARALLEL_PARTS && !dqPending.empty() && !ShutdownRequested())
+		{
+			std::pair<size_t, int> next = dqPending.front();
+			dqPending.pop_front();
+			BIPFSUpload& u = vUploads[next.first];
+			if (!u.sError.empty())
+				continue;
+			LogPrintf(" Submitting %s # %f", u.sOriginalName, next.second);
+			DACHttpRequest request = PrepareIPFSPartRequest(SSL_PORT, u.sWebPath, u.sTXID, sURL, sPage, u.sOriginalName, u.vParts[next.second],
+				next.second, (int)u.vParts.size() - 1, u.nDensity, u.nDuration, u.nFee);
+			lInFlight.push_back(InFlight{next.first, next.second, DACHttpQueue(request)});
+		}
+		if (lInFlight.empty())
+			break;
+
+		auto it = lInFlight.begin();
+		while (it != lInFlight.end() && it->result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			++it;
+		if (it == lInFlight.end())
+		{
+			lInFlight.front().result.wait_for(std::chrono::milliseconds(100));
+			continue;
+		}
+
+		DACHttpResponse response = it->result.get();
+		size_t f = it->nFile;
+		int i = it->nPart;
+		lInFlight.erase(it);
+		BIPFSUpload& u = vUploads[f];
+		int nLast = (int)u.vParts.size() - 1;
+		std::string sResponse = response.sHeaders + response.sBody;
+		if (cdbl(ExtractXML(sResponse, "<status>", "</status>"), 0) == 1)
+		{
+			u.vUploaded[i] = true;
+			if (i == nLast)
+				u.sFinalResponse = sResponse;
+			else if (--vRemaining[f] == 0 && u.sError.empty())
+				dqPending.push_front(std::make_pair(f, nLast));
+			WriteBIPFSManifest(u);
+		}
+		else if (response.sError == "QUEUE_FULL")
+		{
+			dqPending.push_back(std::make_pair(f, i));
+			MilliSleep(100);
+		}
+		else if (++mapAttempts[std::make_pair(f, i)] < BIPFS_PART_ATTEMPTS && response.sError != "SHUTDOWN")
+		{
+			LogPrintf("IPFS::RunBIPFSUploads::Retrying %s part %f %s ", u.sOriginalName, i, response.sError);
+			dqPending.push_back(std::make_pair(f, i));
+		}
+		else if (u.sError.empty())
+		{
+			LogPrintf("IPFS::RunBIPFSUploads::Giving up on %s part %f %s ", u.sOriginalName, i, response.sError);
+			u.sError = "ERROR_IN_" + RoundToString(i, 0);
+		}
+	}
+
+	// Interrupted (shutdown): report the first part that is still missing
+	for (auto& u : vUploads)
+	{
+		if (!IsBIPFSUploadComplete(u) && u.sError.empty())
+		{
+			size_t i = 0;
+			while (i + 1 < u.vParts.size() && u.vUploaded[i])
+				i++;
+			u.sError = "ERROR_IN_" + RoundToString(i, 0);
+		}
+	}
+}
+
+static DACResult GetBIPFSUploadResult(const BIPFSUpload& u)
+{
+	DACResult d;
+	d.nFee = u.nFee;
+	d.nSize = u.nSourceSize;
+	if (!u.sError.empty())
+	{
+		d.fError = true;
+		d.ErrorCode = u.sError;
+		return d;
+	}
+	d.Response = ExtractXML(u.sFinalResponse, "<url>", "</url>");
+	d.TXID = u.sTXID + "-" + RetrieveMd5(u.sLocalPath);
+
+	IPFSTransaction t1;
+	t1.File = u.sLocalPath;
+	t1.Response = d.Response;
+	t1.nFee = d.nFee;
+	t1.nSize = d.nSize;
+	t1.ErrorCode = d.ErrorCode;
+	t1.TXID = d.TXID;
+	for (int i = 0; i < u.nDensity; i++)
+	{
+		std::string sRegionName = "<url" + RoundToString(i, 0) + ">";
+		std::string sSuffix = "</url" + RoundToString(i,0) + ">";
+		std::string sStorageURL = ExtractXML(u.sFinalResponse, sRegionName, sSuffix);
+		if (!sStorageURL.empty())
+			t1.mapRegions.insert(std::make_pair("region_" + RoundToString(i, 0), sStorageURL));
+	}
+	d.mapResponses.insert(std::make_pair(d.TXID, t1));
+	d.fError = false;
+	return d;
+}
+
+// A dry run prices the upload without touching the SAN directory, so it never disturbs an upload waiting to be resumed
+static DACResult QuoteBIPFSUpload(std::string sLocalPath, std::string sTXID, int iTargetDensity, int nDurationDays, bool fEncrypted)
+{
+	DACResult d;
+	BIPFSKeys keys;
+	int64_t nFileSize = GETFILESIZE(sLocalPath);
+	if (nFileSize < 1)
 	{
 		d.ErrorCode = "FILE_MISSING";
 		return d;
 	}
-	// Calculation
-	CAmount nFee = CalculateIPFSFee(iTargetDensity, nDurationDays, iFileSize);
-	if (nFee/COIN < 1)
+	if (fEncrypted && !GetBIPFSKeys(keys))
+	{
+		d.ErrorCode = "SPLIT_ERROR";
+		return d;
+	}
+	d.nFee = CalculateIPFSFee(iTargetDensity, nDurationDays, nFileSize);
+	if (d.nFee/COIN < 1)
 	{
 		d.ErrorCode = "FEE_ERROR";
 		return d;
 	}
-	d.nFee = nFee;
-	d.nSize = iFileSize;
-    int iTotalParts = -1;
-	int iPort = SSL_PORT;
-	std::string sPage = "UnchainedUpload";
-	int MAX_SPLITTER_PARTS = 7000;
-    for (int i = 0; i < MAX_SPLITTER_PARTS; i++)
-    {
-		  std::string sPartial = RoundToString(i, 0) + ".dat";
-          boost::filesystem::path pPath = pathDir / sPartial;
-		  int iFileSize = GETFILESIZE(pPath.string());
-		  if (iFileSize > 0)
-		  {
-		      iTotalParts = i;
-		  }
-		  else
-		  {
-		      break; 
-          }
-    }
+	d.nSize = nFileSize;
+	d.TXID = sTXID + "-" + RetrieveMd5(sLocalPath);
+	IPFSTransaction t1;
+	t1.File = sLocalPath;
+	t1.nFee = d.nFee;
+	t1.nSize = d.nSize;
+	t1.TXID = d.TXID;
+	d.mapResponses.insert(std::make_pair(d.TXID, t1));
+	d.Response = boost::filesystem::path(sLocalPath).filename().string();
+	d.fError = false;
+	return d;
+}
 
-    for (int i = 0; i <= iTotalParts; i++)
-    {
-		 std::string sPartial = RoundToString(i, 0) + ".dat";
-		 boost::filesystem::path pPath = pathDir / sPartial;
-		 int iFileSize = GETFILESIZE(pPath.string());
-		 if (iFileSize > 0)
-		 {
-			 LogPrintf(" Submitting # %f", i);
-		     DACResult dInd;
-			 if (!fDryRun)
-			 {
-				 // ToDo - ensure WebPath is robust enough to handle the Name+Orig Name
-				 dInd = SubmitIPFSPart(iPort, sWebPath, sTXID, sURL, sPage, sOriginalName, pPath.string(), i, iTotalParts, iTargetDensity, nDurationDays, fEncrypted, nFee);
-			 }
-			 
-			 std::string sStatus = ExtractXML(dInd.Response, "<status>", "</status>");
-			 std::string out_URL = ExtractXML(dInd.Response, "<url>", "</url>");
-			 double nStatus = cdbl(sStatus, 0);
-			 if (fDryRun)
-				 nStatus = 1;
-			
-			 if (nStatus != 1)
-             {
-				 bool fResult = RelinquishSpace(sLocalPath);
-				 d.fError = true;
-				 d.ErrorCode = "ERROR_IN_" + RoundToString(i, 0);
-				 return d;
-             }
-             if (i == iTotalParts)
-             {
-				 RelinquishSpace(sLocalPath);
-				 d.Response = out_URL;
-				 d.TXID = sTXID + "-" + RetrieveMd5(sLocalPath);
-    			 
-				IPFSTransaction t1;
-				t1.File = sLocalPath;
-				t1.Response = d.Response;
-				t1.nFee = d.nFee;
-				t1.nSize = d.nSize;
-				t1.ErrorCode = d.ErrorCode;
-				t1.TXID = d.TXID;
-
-				 for (int i = 0; i < iTargetDensity; i++)
-				 {
-					 std::string sRegionName = "<url" + RoundToString(i, 0) + ">";
-					 std::string sSuffix = "</url" + RoundToString(i,0) + ">";
-					 std::string sStorageURL = ExtractXML(dInd.Response, sRegionName, sSuffix);
-					 if (!sStorageURL.empty())
-						 t1.mapRegions.insert(std::make_pair("region_" + RoundToString(i, 0), sStorageURL));
-				 }
+DACResult BIPFS_UploadFile(std::string sLocalPath, std::string sWebPath, std::string sTXID, int iTargetDensity, int nDurationDays, bool fDryRun, bool fEncrypted)
+{
+	// The sidechain stored file must contain the target density, the lease duration, and the correct amount.
+	// The corresponding TXID must contain the hash of the file URL
+	if (fDryRun)
+		return QuoteBIPFSUpload(sLocalPath, sTXID, iTargetDensity, nDurationDays, fEncrypted);
 
-				 d.mapResponses.insert(std::make_pair(d.TXID, t1));
-				 d.fError = false;
-				 if (fDryRun)
-					 d.Response = sOriginalName;
-				 return d;
-              }
-         }
-   }
-   RelinquishSpace(sLocalPath);
-   d.fError = true;
-   d.ErrorCode = "NOTHING_TO_PROCESS";
-   return d;
+	DACResult d;
+	std::vector<BIPFSUpload> vUploads(1);
+	if (!PrepareBIPFSUpload(sLocalPath, sWebPath, sTXID, iTargetDensity, nDurationDays, fEncrypted, vUploads[0], d))
+		return d;
+	RunBIPFSUploads(vUploads);
+	d = GetBIPFSUploadResult(vUploads[0]);
+	// A failed upload keeps its parts and manifest so that it can be resumed
+	if (!d.fError)
+		RelinquishSpace(sLocalPath);
+	return d;
 }
 
-
-DACResult BIPFS_UploadFolder(std::string sDirPath, std::string sWebPath, std::string sTXID, int iTargetDensity, int nDurationDays, bool fDryRun, bool fEncrypted)
+static std::vector<std::string> GetBIPFSFolderFiles(std::string sDirPath)
 {
 	std::vector<std::string> skipList;
-	std::vector<std::string> g = GetVectorOfFilesInDirectory(sDirPath, skipList);
-	std::string sOut;
-	DACResult dOverall;
-	for (auto sFileName : g)
+	std::vector<std::string> vFiles;
+	// The directory iterator already yields full paths (and the subdirectories themselves)
+	for (auto sFileName : GetVectorOfFilesInDirectory(sDirPath, skipList))
 	{
+		if (!boost::filesystem::is_regular_file(sFileName))
+			continue;
 		std::string sRelativeFileName = strReplace(sFileName, sDirPath, "");
-		std::string sFullWebPath = Path_Combine(sWebPath, sRelativeFileName);
-		std::string sFullSourcePath = Path_Combine(sDirPath, sFileName);
-		LogPrintf("BIPFS_UploadFolder::Iterated Filename %s, RelativeFile %s, FullWebPath %s", 
-				sFileName.c_str(), sRelativeFileName.c_str(), sFullWebPath.c_str());
-		DACResult dInd = BIPFS_UploadFile(sFullSourcePath, sWebPath, sTXID, iTargetDensity, nDurationDays, fDryRun, fEncrypted);
-		if (dInd.fError)
+		LogPrintf("BIPFS_UploadFolder::Iterated Filename %s, RelativeFile %s", sFileName.c_str(), sRelativeFileName.c_str());
+		vFiles.push_back(sFileName);
+	}
+	std::sort(vFiles.begin(), vFiles.end());
+	return vFiles;
+}
+
+DACResult BIPFS_UploadFolder(std::string sDirPath, std::string sWebPath, std::string sTXID, int iTargetDensity, int nDurationDays, bool fDryRun, bool fEncrypted)
+{
+	std::vector<std::string> vFiles = GetBIPFSFolderFiles(sDirPath);
+	std::vector<DACResult> vResults;
+	if (fDryRun)
+	{
+		for (auto sFullSourcePath : vFiles)
 		{
-			return dInd;
+			vResults.push_back(QuoteBIPFSUpload(sFullSourcePath, sTXID, iTargetDensity, nDurationDays, fEncrypted));
+			if (!vResults.back().ErrorCode.empty())
+				return vResults.back();
 		}
-		else
+	}
+	else
+	{
+		// Every file is prepared first, then all of their parts go through one scheduler
+		std::vector<BIPFSUpload> vUploads(vFiles.size());
+		for (size_t i = 0; i < vFiles.size(); i++)
 		{
-			dOverall.nFee += dInd.nFee;
-			dOverall.nSize += dInd.nSize;
+			DACResult dInd;
+			if (!PrepareBIPFSUpload(vFiles[i], sWebPath, sTXID, iTargetDensity, nDurationDays, fEncrypted, vUploads[i], dInd))
+				return dInd;
 		}
+		RunBIPFSUploads(vUploads);
+		for (const auto& u : vUploads)
+		{
+			vResults.push_back(GetBIPFSUploadResult(u));
+			if (vResults.back().fError)
+				return vResults.back();
+		}
+		// The stored files of a folder are only released once the whole folder is up, so a resume skips them
+		for (auto sFullSourcePath : vFiles)
+			RelinquishSpace(sFullSourcePath);
+	}
 
+	DACResult dOverall;
+	for (auto& dInd : vResults)
+	{
+		dOverall.nFee += dInd.nFee;
+		dOverall.nSize += dInd.nSize;
 		dOverall.mapResponses.insert(std::make_pair(dInd.TXID, dInd.mapResponses[dInd.TXID]));
-
 	}
-	dOverall.Response = sOut;
 	dOverall.fError = false;
 	return dOverall;
 }
 
+std::string BIPFS_GetResumeTXID(std::string sPath, std::string sWebPath, bool fFolder, int iTargetDensity, int nDurationDays, bool fEncrypted)
+{
+	std::vector<std::string> vFiles;
+	if (fFolder)
+		vFiles = GetBIPFSFolderFiles(sPath);
+	else
+		vFiles.push_back(sPath);
+	// The fee already paid only covers the upload as it was: every file must have been prepared under the same TXID
+	// with the same parameters and content, otherwise a new fee is due
+	std::string sTXID;
+	for (auto sFile : vFiles)
+	{
+		BIPFSUpload u, m;
+		DescribeBIPFSUpload(sFile, sWebPath, "", iTargetDensity, nDurationDays, fEncrypted, u);
+		if (u.nSourceSize < 1 || !ReadBIPFSManifest(u.sDir, m) || m.sTXID.empty() || !MatchesBIPFSManifest(m, u))
+			return std::string();
+		if (!sTXID.empty() && m.sTXID != sTXID)
+			return std::string();
+		sTXID = m.sTXID;
+	}
+	return sTXID;
+}
+
 std::string GetHowey(bool fRPC, bool fBurn)
 {
 	std::string sPrefix = !fRPC ? "clicking [YES]," : "typing I_AGREE in uppercase,";
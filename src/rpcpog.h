@@ -10,9 +10,11 @@
 #include "net.h"
 #include "utilstrencodings.h"
 #include "validation.h"
+#include "messageindex.h"
 #include <univalue.h>
 
 class CWallet;
+struct DACHttpRequest;
 
 
 std::string RetrieveMd5(std::string s1);
@@ -63,6 +65,36 @@ struct IPFSTransaction
 	std::map<std::string, std::string> mapRegions;
 };
 
+/** One upload part written by SplitFile; sHash is the SHA256 of the part as uploaded */
+struct BIPFSPart
+{
+	std::string sPath;
+	int64_t nSize = 0;
+	std::string sHash;
+};
+
+/** A file being uploaded to BIPFS, as recorded in the manifest next to its parts (see PrepareBIPFSUpload) */
+struct BIPFSUpload
+{
+	std::string sLocalPath;
+	std::string sWebPath;
+	std::string sOriginalName;
+	std::string sDir;
+	std::string sTXID;
+	int nDensity = 0;
+	int nDuration = 0;
+	bool fEncrypted = false;
+	int64_t nSourceSize = 0;
+	// SHA256 of the source file
+	std::string sSourceHash;
+	CAmount nFee = 0;
+	std::vector<BIPFSPart> vParts;
+	std::vector<bool> vUploaded;
+	// Response to the last part; set once the whole file is stored
+	std::string sFinalResponse;
+	std::string sError;
+};
+
 struct DashUTXO
 {
 	std::string TXID = std::string();
@@ -285,10 +317,10 @@ double GetSporkDouble(std::string sName, double nDefault);
 int64_t GETFILESIZE(std::string sPath);
 std::string AddBlockchainMessages(std::string sAddress, std::string sType, std::string sPrimaryKey, 
 	std::string sHTML, CAmount nAmount, double minCoinAge, std::string& sError);
-std::string ReadCache(std::string sSection, std::string sKey);
-std::string ReadCacheWithMaxAge(std::string sSection, std::string sKey, int64_t nSeconds);
-void ClearCache(std::string sSection);
-void WriteCache(std::string sSection, std::string sKey, std::string sValue, int64_t locktime, bool IgnoreCase=true);
+std::string ReadCache(const std::string& sSection, const std::string& sKey);
+std::string ReadCacheWithMaxAge(const std::string& sSection, const std::string& sKey, int64_t nSeconds);
+void ClearCache(const std::string& sSection);
+void WriteCache(const std::string& sSection, const std::string& sKey, const std::string& sValue, int64_t locktime, bool IgnoreCase=true);
 std::string GetSporkValue(std::string sKey);
 std::string TimestampToHRDate(double dtm);
 std::string GetArrayElement(std::string s, std::string delim, int iPos);
@@ -308,6 +340,9 @@ UniValue ContributionReport();
 int DeserializePrayersFromFile();
 double Round(double d, int place);
 void SerializePrayersToFile(int nHeight);
+void AppendPrayersToFile(int nHeight);
+void IndexBlockMessages(const CBlock& block, int nHeight, std::vector<std::pair<CMessageIndexKey, CMessageIndexValue>>& vEntries);
+void RestoreIndexedMessages(const std::vector<CMessageIndexKey>& vErased);
 std::string AmountToString(const CAmount& amount);
 CBlockIndex* FindBlockByHeight(int nHeight);
 std::string rPad(std::string data, int minWidth);
@@ -331,6 +366,8 @@ std::vector<std::string> Split(std::string s, std::string delim);
 void MemorizeBlockChainPrayers(bool fDuringConnectBlock, bool fSubThread, bool fColdBoot, bool fDuringSanctuaryQuorum);
 double GetBlockVersion(std::string sXML);
 bool CheckStakeSignature(std::string sBitcoinAddress, std::string sSignature, std::string strMessage, std::string& strError);
+bool TermPeekFound(std::string sData, int iBOEType);
+DACHttpRequest PrepareUplinkRequest(bool bPost, std::string sPayload, std::string sBaseURL, std::string sPage, int iPort, int iTimeoutSecs, int iBOE = 0, std::map<std::string, std::string> mapRequestHeaders = std::map<std::string, std::string>(), std::string sTargetFileName = "");
 std::string Uplink(bool bPost, std::string sPayload, std::string sBaseURL, std::string sPage, int iPort, int iTimeoutSecs, int iBOE = 0, std::map<std::string, std::string> mapRequestHeaders = std::map<std::string, std::string>(), std::string sTargetFileName = "");
 std::string FormatHTML(std::string sInput, int iInsertCount, std::string sStringToInsert);
 std::string GJE(std::string sKey, std::string sValue, bool bIncludeDelimiter, bool bQuoteValue);
@@ -348,6 +385,7 @@ void WriteCacheDouble(std::string sKey, double dValue);
 double ReadCacheDouble(std::string sKey);
 bool CheckAntiBotNetSignature(CTransactionRef tx, std::string sType, std::string sSolver);
 double GetVINCoinAge(int64_t nBlockTime, CTransactionRef tx, bool fDebug);
+void GetVINCoinAge(int64_t nBlockTime, CTransactionRef tx, double& dCoinAge, double& dCoinAgeWithoutSanctuaries);
 CAmount GetTitheAmount(CTransactionRef ctx);
 CPK GetCPK(std::string sData);
 std::string GetCPKData(std::string sProjectId, std::string sPK);
@@ -361,7 +399,7 @@ const CBlockIndex* GetBlockIndexByTransactionHash(const uint256 &hash);
 double AddVector(std::string sData, std::string sDelim);
 int ReassessAllChains();
 double GetFees(CTransactionRef tx);
-int64_t GetCacheEntryAge(std::string sSection, std::string sKey);
+int64_t GetCacheEntryAge(const std::string& sSection, const std::string& sKey);
 void LogPrintWithTimeLimit(std::string sSection, std::string sValue, int64_t nMaxAgeInSeconds);
 std::vector<std::string> GetVectorOfFilesInDirectory(const std::string &dirPath, const std::vector<std::string> dirSkipList);
 std::string GetAttachmentData(std::string sPath, bool fEncrypted);
@@ -373,6 +411,12 @@ std::string BIPFS_Payment(CAmount nAmount, std::string sTXID, std::string sXML);
 DACResult DSQL_ReadOnlyQuery(std::string sXMLSource);
 DACResult DSQL_ReadOnlyQuery(std::string sEndpoint, std::string sXML);
 int LoadResearchers();
+/** Parse a BOINC user export in one pass; returns the number of </user> delimited records, as Split would */
+int ParseResearchers(const std::string& sData, std::map<std::string, Researcher>& mapResearchers);
+/** The researcher table.  LoadResearchers replaces it as a whole, so a snapshot is never partly loaded */
+std::shared_ptr<const std::map<std::string, Researcher>> GetResearchers();
+/** A copy of one researcher, or an empty (not found) researcher */
+Researcher GetResearcher(const std::string& sCPID);
 std::string TeamToName(int iTeamID);
 std::string GetResearcherCPID(std::string sSearch);
 bool CreateExternalPurse(std::string& sError);
@@ -397,6 +441,9 @@ uint256 ComputeRandomXTarget(uint256 hash, int64_t nPrevBlockTime, int64_t nBloc
 std::string ReverseHex(std::string const & src);
 uint256 GetRandomXHash(std::string sHeaderHex, uint256 key, uint256 hashPrevBlock, int iThreadID);
 uint256 GetRandomXHash2(std::string sHeaderHex, uint256 key, uint256 hashPrevBlock, int iThreadID);
+uint256 GetRandomXBlakeHash(const uint256& uRXMined, const uint256& hashPrevBlock);
+uint256 GetRandomXHash(const RandomXHeaderBytes& vchHeader, const uint256& key, const uint256& hashPrevBlock, int iThreadID);
+uint256 GetRandomXHash2(const RandomXHeaderBytes& vchHeader, const uint256& key, const uint256& hashPrevBlock, int iThreadID);
 std::string GenerateFaucetCode();
 void WriteBinaryToFile(char const* filename, std::vector<char> data);
 std::tuple<std::string, std::string, std::string> GetOrphanPOOSURL(std::string sSanctuaryPubKey);
@@ -405,11 +452,17 @@ bool VoteWithCoinAge(std::string sGobjectID, std::string sOutcome, std::string&
 double GetCoinAge(std::string txid);
 CoinAgeVotingDataStruct GetCoinAgeVotingData(std::string sGobjectID);
 std::string GetAPMNarrative();
-std::string SplitFile(std::string sPath);
-DACResult SubmitIPFSPart(int iPort, std::string sWebPath, std::string sTXID, std::string sBaseURL, std::string sPage, std::string sOriginalName, std::string sFileName, int iPartNumber, int iTotalParts, int iDensity, int iDuration, bool fEncrypted, CAmount nFee);
+bool SplitFile(std::string sPath, bool fEncrypted, std::string& sDir, std::vector<BIPFSPart>& vParts);
+DACHttpRequest PrepareIPFSPartRequest(int iPort, std::string sWebPath, std::string sTXID, std::string sBaseURL, std::string sPage, std::string sOriginalName, const BIPFSPart& part, int iPartNumber, int iTotalParts, int iDensity, int iDuration, CAmount nFee);
 DACResult DownloadFile(std::string sBaseURL, std::string sPage, int iPort, int iTimeoutSecs, std::string sTargetFileName, bool fEncrypted);
 DACResult BIPFS_UploadFile(std::string sLocalPath, std::string sWebPath, std::string sTXID, int iTargetDensity, int nDurationDays, bool fDryRun, bool fEncrypted);
 DACResult BIPFS_UploadFolder(std::string sDirPath, std::string sWebPath, std::string sTXID, int iTargetDensity, int nDurationDays, bool fDryRun, bool fEncrypted);
+/** Fill in the parameters, SAN directory and source size and hash of an upload of sLocalPath */
+void DescribeBIPFSUpload(std::string sLocalPath, std::string sWebPath, std::string sTXID, int iTargetDensity, int nDurationDays, bool fEncrypted, BIPFSUpload& u);
+bool WriteBIPFSManifest(const BIPFSUpload& u);
+bool ReadBIPFSManifest(const std::string& sDir, BIPFSUpload& u);
+/** The TXID of an interrupted, already paid upload of exactly this file or folder, or empty if a new fee is due */
+std::string BIPFS_GetResumeTXID(std::string sPath, std::string sWebPath, bool fFolder, int iTargetDensity, int nDurationDays, bool fEncrypted);
 bool SendDWS(std::string& sTXID, std::string& sError, std::string sReturnAddress, std::string sCPK, double nAmt, double nDuration, bool fDryRun);
 std::string GetHowey(bool fRPC, bool fBurn);
 bool EncryptFile(std::string sPath, std::string sTargetPath);
@@ -425,6 +478,9 @@ void ProcessInnerUTXOData(std::string sInnerData);
 std::string SignBBPUTXO(std::string sUTXO, std::string& sError);
 void ProcessDashUTXOData();
 bool IsDuplicateUTXO(std::string UTXO);
+void RegisterWhaleStake(CTransactionRef tx);
+void RegisterDashStake(CTransactionRef tx);
+void DisconnectStakeRegistryBlock(const CBlock& block);
 std::vector<DashStake> GetPayableDashStakes(int nHeight, double& nOwed);
 void LockDashStakes();
 DashStake GetDashStakeByUTXO(std::string sDashStake);
@@ -148,7 +148,7 @@ UniValue SentGSCCReport(int nHeight, std::string sMyCPK)
 					double nCoinAge = 0;
 					CAmount nDonation = 0;
 					GetTransactionPoints(pindex, block.vtx[n], nCoinAge, nDonation);
-					std::string sDiary = ExtractXML(block.vtx[n]->GetTxMessage(), "<diary>", "</diary>");
+					std::string sDiary = block.vtx[n]->GetParsedTxMessage().GetTag("diary");
 					if (CheckCampaign(sCampaignName) && !sCPK.empty() && sMyCPK == sCPK)
 					{
 						double nPoints = CalculatePoints(sCampaignName, sDiary, nCoinAge, nDonation, sCPK);
@@ -185,7 +185,7 @@ double GetNecessaryCoinAgePercentageForPODC()
 		return 0;
 	}
 
-	Researcher r = mvResearchers[sCPID];
+	Researcher r = GetResearcher(sCPID);
 	if (!r.found)
 	{
 		LogPrintf("GetNecessaryCoinAgePercentage::Researcher not participating with RAC in WCG.%f\n", 802);
@@ -243,7 +243,7 @@ CWalletTx CreateGSCClientTransmission(std::string sGobjectID, std::string sOutco
 			std::string sCPID = GetResearcherCPID(std::string());
 			if (!sCPID.empty())
 			{
-				Researcher r = mvResearchers[sCPID];
+				Researcher r = GetResearcher(sCPID);
 				if (r.found && r.rac > 1)
 				{
 					double nReqForNonDac = GetRequiredCoinAgeForPODC(r.rac, r.teamid);
@@ -51,10 +51,97 @@ void GetTransactionPoints(CBlockIndex* pindex, CTransactionRef tx, double& nCoin
 
 std::string GetTxCPK(CTransactionRef tx, std::string& sCampaignName)
 {
-	std::string sMsg = GetTransactionMessage(tx);
-	std::string sCPK = ExtractXML(sMsg, "<abncpk>", "</abncpk>");
-	sCampaignName = ExtractXML(sMsg, "<gsccampaign>", "</gsccampaign>");
-	return sCPK;
+	const CTxMessage& txMessage = tx->GetParsedTxMessage();
+	sCampaignName = txMessage.GetTag("gsccampaign");
+	return txMessage.GetTag("abncpk");
+}
+
+/**
+ * GSC points ledger: the signed GSC transmissions of the recent blocks with everything AssessBlocks needs from them
+ * (CPK, campaign, diary, coin-age and donation), so an assessment aggregates a day of blocks without reading them
+ * from disk or verifying signatures again.  Blocks are added as they connect, dropped as they disconnect, and filled
+ * in on demand for anything missing; an entry is only used while its hash matches the active chain.
+ */
+struct GSCLedgerTx
+{
+	uint256 txid;
+	std::string sCPK;
+	std::string sCampaignName;
+	std::string sDiary;
+	double nCoinAge = 0;
+	double nCoinAgeWithoutSanctuaries = 0;
+	CAmount nDonation = 0;
+};
+
+struct GSCLedgerBlock
+{
+	uint256 hashBlock;
+	std::vector<GSCLedgerTx> vTx;
+};
+
+// Two days of blocks, so the window being assessed survives while the next day is being built up
+static const int GSC_LEDGER_DEPTH = BLOCKS_PER_DAY * 2;
+static CCriticalSection cs_gscledger;
+static std::map<int, GSCLedgerBlock> mapGSCLedger;
+
+static GSCLedgerBlock BuildGSCLedgerBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+	GSCLedgerBlock b;
+	b.hashBlock = pindex->GetBlockHash();
+	for (unsigned int n = 0; n < block.vtx.size(); n++)
+	{
+		const CTransactionRef& tx = block.vtx[n];
+		if (tx->IsGSCTransmission() && CheckAntiBotNetSignature(tx, "gsc", ""))
+		{
+			GSCLedgerTx l;
+			l.txid = tx->GetHash();
+			l.sCPK = GetTxCPK(tx, l.sCampaignName);
+			l.sDiary = tx->GetParsedTxMessage().GetTag("diary");
+			GetVINCoinAge(pindex->GetBlockTime(), tx, l.nCoinAge, l.nCoinAgeWithoutSanctuaries);
+			l.nDonation = GetTitheAmount(tx);
+			b.vTx.push_back(l);
+		}
+	}
+	return b;
+}
+
+void ConnectGSCLedgerBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+	// While syncing, blocks are filled in on demand once they fall inside an assessment window
+	if (IsInitialBlockDownload())
+		return;
+	GSCLedgerBlock b = BuildGSCLedgerBlock(block, pindex);
+	LOCK(cs_gscledger);
+	mapGSCLedger[pindex->nHeight] = b;
+	mapGSCLedger.erase(mapGSCLedger.begin(), mapGSCLedger.lower_bound(pindex->nHeight - GSC_LEDGER_DEPTH));
+}
+
+void DisconnectGSCLedgerBlock(const CBlockIndex* pindex)
+{
+	LOCK(cs_gscledger);
+	mapGSCLedger.erase(pindex->nHeight);
+}
+
+static bool GetGSCLedgerBlock(const CBlockIndex* pindex, const Consensus::Params& consensusParams, GSCLedgerBlock& b)
+{
+	{
+		LOCK(cs_gscledger);
+		std::map<int, GSCLedgerBlock>::const_iterator it = mapGSCLedger.find(pindex->nHeight);
+		if (it != mapGSCLedger.end() && it->second.hashBlock == pindex->GetBlockHash())
+		{
+			b = it->second;
+			return true;
+		}
+	}
+	CBlock block;
+	if (!ReadBlockFromDisk(block, pindex, consensusParams))
+		return false;
+	b = BuildGSCLedgerBlock(block, pindex);
+	LOCK(cs_gscledger);
+	mapGSCLedger[pindex->nHeight] = b;
+	if (chainActive.Tip())
+		mapGSCLedger.erase(mapGSCLedger.begin(), mapGSCLedger.lower_bound(chainActive.Tip()->nHeight - GSC_LEDGER_DEPTH));
+	return true;
 }
 
 static double N_MAX = 9999999999;
@@ -683,87 +770,85 @@ std::string AssessBlocks(int nHeight, bool fCreatingContract)
 	std::string sAnalyzeUser = ReadCache("analysis", "user");
 	std::string sAnalysisData1;
 
+	bool fPreventSanctuaryScalping = GetSporkDouble("preventsanctuaryscalping", 0) == 1;
+
 	while (pindex && pindex->nHeight < nMaxDepth)
 	{
 		if (pindex->nHeight < chainActive.Tip()->nHeight) 
 			pindex = chainActive.Next(pindex);
-		CBlock block;
-		if (ReadBlockFromDisk(block, pindex, consensusParams)) 
+		GSCLedgerBlock ledgerBlock;
+		if (GetGSCLedgerBlock(pindex, consensusParams, ledgerBlock)) 
 		{
-			for (unsigned int n = 0; n < block.vtx.size(); n++)
+			for (const GSCLedgerTx& ledgerTx : ledgerBlock.vTx)
 			{
-				if (block.vtx[n]->IsGSCTransmission() && CheckAntiBotNetSignature(block.vtx[n], "gsc", ""))
+				const std::string& sCampaignName = ledgerTx.sCampaignName;
+				const std::string& sCPK = ledgerTx.sCPK;
+				CPK localCPK = GetCPKFromProject("cpk", sCPK);
+				double nCoinAge = fPreventSanctuaryScalping ? ledgerTx.nCoinAgeWithoutSanctuaries : ledgerTx.nCoinAge;
+				CAmount nDonation = ledgerTx.nDonation;
+				if (CheckCampaign(sCampaignName) && !sCPK.empty())
 				{
-					std::string sCampaignName;
-					std::string sCPK = GetTxCPK(block.vtx[n], sCampaignName);
-					CPK localCPK = GetCPKFromProject("cpk", sCPK);
-					double nCoinAge = 0;
-					CAmount nDonation = 0;
-					GetTransactionPoints(pindex, block.vtx[n], nCoinAge, nDonation);
-					if (CheckCampaign(sCampaignName) && !sCPK.empty())
+					const std::string& sDiary = ledgerTx.sDiary;
+					double nPoints = CalculatePoints(sCampaignName, sDiary, nCoinAge, nDonation, sCPK);
+
+					if (sCampaignName == "WCG" && nPoints > 0)
 					{
-						std::string sDiary = ExtractXML(block.vtx[n]->GetTxMessage(), "<diary>","</diary>");
-						double nPoints = CalculatePoints(sCampaignName, sDiary, nCoinAge, nDonation, sCPK);
+						std::string sCPID = GetCPIDByCPK(sCPK);
 
-						if (sCampaignName == "WCG" && nPoints > 0)
+						Researcher r = Researchers[sCPID];
+						if (r.found)
+						{
+							r.CoinAge += nPoints;
+							r.CPK = sCPK;
+							Researchers[sCPID] = r;
+						}
+						else
 						{
-							std::string sCPID = GetCPIDByCPK(sCPK);
-
-							Researcher r = Researchers[sCPID];
-							if (r.found)
-							{
-								r.CoinAge += nPoints;
-								r.CPK = sCPK;
-								Researchers[sCPID] = r;
-							}
-							else
-							{
-								LogPrintf("\nAssessBlocks::Unable to find researcher for CPK %s with CPID %s", sCPK, sCPID);
-							}
-							nPoints = 0;
+							LogPrintf("\nAssessBlocks::Unable to find researcher for CPK %s with CPID %s", sCPK, sCPID);
 						}
+						nPoints = 0;
+					}
 
-						if (sCampaignName == "CAMEROON-ONE" && mCPKCampaignPoints[sCPK + sCampaignName].nPoints > 0)
-							nPoints = 0;
+					if (sCampaignName == "CAMEROON-ONE" && mCPKCampaignPoints[sCPK + sCampaignName].nPoints > 0)
+						nPoints = 0;
 
-						if (sCampaignName == "KAIROS" && mCPKCampaignPoints[sCPK + sCampaignName].nPoints > 0)
-							nPoints = 0;
+					if (sCampaignName == "KAIROS" && mCPKCampaignPoints[sCPK + sCampaignName].nPoints > 0)
+						nPoints = 0;
 
-						if (nPoints > 0)
+					if (nPoints > 0)
+					{
+						// CPK 
+						CPK c = mPoints[sCPK];
+						c.sCampaign = sCampaignName;
+						c.sAddress = sCPK;
+						c.sNickName = localCPK.sNickName;
+						c.nPoints += nPoints;
+						mCampaignPoints[sCampaignName] += nPoints;
+						mPoints[sCPK] = c;
+						
+						// CPK-Campaign
+						CPK cCPKCampaignPoints = mCPKCampaignPoints[sCPK + sCampaignName];
+						cCPKCampaignPoints.sAddress = sCPK;
+						cCPKCampaignPoints.sNickName = c.sNickName;
+						cCPKCampaignPoints.nPoints += nPoints;
+						mCPKCampaignPoints[sCPK + sCampaignName] = cCPKCampaignPoints;
+						if (dDebugLevel == 1)
+							LogPrintf("\nUser %s , NN %s, Diary %s, height %f, TXID %s, nn %s, Points %f, Campaign %s, coinage %f, donation %f, usertotal %f ",
+							c.sAddress, localCPK.sNickName, sDiary, pindex->nHeight, ledgerTx.txid.GetHex(), localCPK.sNickName, 
+							(double)nPoints, c.sCampaign, (double)nCoinAge, 
+							(double)nDonation/COIN, (double)c.nPoints);
+						if (!sAnalyzeUser.empty() && sAnalyzeUser == c.sNickName)
+						{
+							std::string sInfo = "User: " + c.sAddress + ", Diary: " + sDiary + ", Height: " + RoundToString(pindex->nHeight, 2)
+								+ ", TXID: " + ledgerTx.txid.GetHex() + ", NickName: " 
+								+ localCPK.sNickName + ", Points: " + RoundToString(nPoints, 2) 
+								+ ", Campaign: " + c.sCampaign + ", CoinAge: " + RoundToString(nCoinAge, 4) 
+								+ ", Donation: " + RoundToString(nDonation/COIN, 4) + ", UserTotal: " + RoundToString(c.nPoints, 2) + "\n";
+								sAnalysisData1 += sInfo;
+						}
+						if (c.sCampaign == "HEALING" && !sDiary.empty())
 						{
-							// CPK 
-							CPK c = mPoints[sCPK];
-							c.sCampaign = sCampaignName;
-							c.sAddress = sCPK;
-							c.sNickName = localCPK.sNickName;
-							c.nPoints += nPoints;
-							mCampaignPoints[sCampaignName] += nPoints;
-							mPoints[sCPK] = c;
-							
-							// CPK-Campaign
-							CPK cCPKCampaignPoints = mCPKCampaignPoints[sCPK + sCampaignName];
-							cCPKCampaignPoints.sAddress = sCPK;
-							cCPKCampaignPoints.sNickName = c.sNickName;
-							cCPKCampaignPoints.nPoints += nPoints;
-							mCPKCampaignPoints[sCPK + sCampaignName] = cCPKCampaignPoints;
-							if (dDebugLevel == 1)
-								LogPrintf("\nUser %s , NN %s, Diary %s, height %f, TXID %s, nn %s, Points %f, Campaign %s, coinage %f, donation %f, usertotal %f ",
-								c.sAddress, localCPK.sNickName, sDiary, pindex->nHeight, block.vtx[n]->GetHash().GetHex(), localCPK.sNickName, 
-								(double)nPoints, c.sCampaign, (double)nCoinAge, 
-								(double)nDonation/COIN, (double)c.nPoints);
-							if (!sAnalyzeUser.empty() && sAnalyzeUser == c.sNickName)
-							{
-								std::string sInfo = "User: " + c.sAddress + ", Diary: " + sDiary + ", Height: " + RoundToString(pindex->nHeight, 2)
-									+ ", TXID: " + block.vtx[n]->GetHash().GetHex() + ", NickName: " 
-									+ localCPK.sNickName + ", Points: " + RoundToString(nPoints, 2) 
-									+ ", Campaign: " + c.sCampaign + ", CoinAge: " + RoundToString(nCoinAge, 4) 
-									+ ", Donation: " + RoundToString(nDonation/COIN, 4) + ", UserTotal: " + RoundToString(c.nPoints, 2) + "\n";
-									sAnalysisData1 += sInfo;
-							}
-							if (c.sCampaign == "HEALING" && !sDiary.empty())
-							{
-								sDiaries += "\n" + sCPK + "|" + localCPK.sNickName + "|" + sDiary;
-							}
+							sDiaries += "\n" + sCPK + "|" + localCPK.sNickName + "|" + sDiary;
 						}
 					}
 				}
@@ -1657,7 +1742,7 @@ std::string ExecuteGenericSmartContractQuorumProcess()
 
 	// UI Glitch in 1.4.8.5 fix (we normally have about 21,000 researchers in prod). 
 	bool fReload = false;
-	if (mvResearchers.size() < 500 && fProd && chainActive.Tip()->nHeight % 10 == 0)
+	if (GetResearchers()->size() < 500 && fProd && chainActive.Tip()->nHeight % 10 == 0)
 		fReload = true;
 
 	if (chainActive.Tip()->nHeight % 128 == 0 || fReload)
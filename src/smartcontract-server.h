@@ -15,6 +15,8 @@
 class CWallet;
 
 std::string AssessBlocks(int nHeight, bool fCreating);
+void ConnectGSCLedgerBlock(const CBlock& block, const CBlockIndex* pindex);
+void DisconnectGSCLedgerBlock(const CBlockIndex* pindex);
 int GetLastGSCSuperblockHeight(int nCurrentHeight, int& nNextSuperblock);
 std::string GetGSCContract(int nHeight, bool fCreating);
 bool SubmitGSCTrigger(std::string sHex, std::string& gobjecthash, std::string& sError);
@@ -9,6 +9,7 @@
 #include "chainparams.h"
 #include "validation.h"
 #include "messagesigner.h"
+#include "miner.h"
 #include "net_processing.h"
 #include "netmessagemaker.h"
 
@@ -178,6 +179,8 @@ void CSporkManager::ProcessSpork(CNode* pfrom, const std::string& strCommand, CD
             mapSporksByHash[hash] = spork;
             mapSporksActive[spork.nSporkID][keyIDSigner] = spork;
         }
+        // SPORK_9_SUPERBLOCKS_ENABLED decides whether the template pays a superblock
+        InvalidateBlockTemplateCache();
         spork.Relay(connman);
 
         //does a task if needed
@@ -242,6 +245,7 @@ bool CSporkManager::UpdateSpork(int nSporkID, int64_t nValue, CConnman& connman)
             mapSporksByHash[spork.GetHash()] = spork;
             mapSporksActive[nSporkID][keyIDSigner] = spork;
         }
+        InvalidateBlockTemplateCache();
         spork.Relay(connman);
         return true;
     }
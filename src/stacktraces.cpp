@@ -45,6 +45,7 @@
 static void PrintCrashInfo(const std::string& s)
 {
     LogPrintf("%s", s);
+    FlushDebugLog(true);
     fprintf(stderr, "%s", s.c_str());
     fflush(stderr);
 }
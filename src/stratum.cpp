@@ -0,0 +1,522 @@
+// Copyright (c) 2014-2019 The Dash Core Developers, The DAC Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "stratum.h"
+
+#include "arith_uint256.h"
+#include "chainparams.h"
+#include "ctpl.h"
+#include "crypto/common.h"
+#include "miner.h"
+#include "netbase.h"
+#include "random.h"
+#include "randomx_bbp.h"
+#include "rpcpog.h"
+#include "util.h"
+#include "utilstrencodings.h"
+#include "validation.h"
+#include "validationinterface.h"
+
+#include <univalue.h>
+
+#include <atomic>
+#include <deque>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include <event2/event.h>
+#include <event2/listener.h>
+#include <event2/thread.h>
+#include <event2/util.h>
+
+// Job blob handed to workers: job seed (32) | worker id (4) | zero (3) | nonce (4) | zero padding.
+// The nonce sits at byte 39 as in Monero blobs, so stock RandomX stratum miners can be pointed at us.
+static const size_t STRATUM_BLOB_SIZE = 64;
+static const size_t STRATUM_BLOB_WORKER_OFFSET = 32;
+static const size_t STRATUM_BLOB_NONCE_OFFSET = 39;
+/** Requests longer than this are treated as garbage and the worker is dropped */
+static const size_t MAX_STRATUM_REQUEST_SIZE = 4096;
+/** Jobs kept for the current tip so shares on a just-replaced template still count */
+static const size_t MAX_STRATUM_JOBS = 4;
+/** Seconds between template refreshes (to pick up new mempool transactions) when the tip does not move */
+static const int STRATUM_REFRESH_SECONDS = 30;
+/** Idle workers are disconnected after this many seconds */
+static const int STRATUM_TIMEOUT_SECONDS = 600;
+/** Shares waiting for verification beyond this are refused, so a flood cannot queue unbounded RandomX work */
+static const int MAX_STRATUM_PENDING_SHARES = 256;
+
+struct StratumJob
+{
+    std::string strJobId;
+    CBlock block;
+    uint256 hashSeed;
+    int nPrevHeight;
+    int64_t nPrevTime;
+    arith_uint256 bnTarget;
+};
+
+/** Outcome of a share verified on the pool, answered on the event thread */
+struct StratumShareResult
+{
+    struct bufferevent* bev;
+    uint32_t nWorkerId;
+    UniValue id;
+    std::string strError;
+};
+
+struct StratumClient
+{
+    uint32_t nWorkerId;
+    std::string strLogin;
+    bool fLoggedIn;
+    std::set<std::pair<std::string, uint32_t> > setSubmitted;
+};
+
+// Everything below is only touched from the Stratum event thread, except where noted
+static struct event_base* eventBaseStratum = NULL;
+static struct evconnlistener* listenerStratum = NULL;
+static struct event* eventStratumNewTip = NULL;
+static struct event* eventStratumRefresh = NULL;
+static struct event* eventStratumResults = NULL;
+static std::thread threadStratum;
+static uint64_t nStratumShareTarget = 0;
+static size_t nStratumMaxClients = DEFAULT_STRATUM_MAX_CLIENTS;
+static std::map<struct bufferevent*, StratumClient> mapStratumClients;
+static std::deque<std::shared_ptr<const StratumJob> > dqStratumJobs;
+static uint32_t nStratumNextWorkerId = 1;
+static uint64_t nStratumJobCounter = 0;
+
+// Shares are hashed (and found blocks submitted) on this pool, so RandomX and ProcessNewBlock never stall the event loop
+static ctpl::thread_pool stratumVerifyPool;
+static std::atomic<int> nStratumPendingShares(0);
+// Guards dqStratumResults, filled by the pool and drained by the event thread
+static std::mutex cs_stratumResults;
+static std::deque<StratumShareResult> dqStratumResults;
+
+/** Wakes the event thread when the chain tip moves; UpdatedBlockTip runs on the validation thread */
+class CStratumTipListener : public CValidationInterface
+{
+protected:
+    void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override
+    {
+        if (!fInitialDownload && eventStratumNewTip)
+            event_active(eventStratumNewTip, 0, 0);
+    }
+};
+
+static CStratumTipListener stratumTipListener;
+
+static void BuildStratumBlob(const StratumJob& job, uint32_t nWorkerId, unsigned char* pch)
+{
+    memset(pch, 0, STRATUM_BLOB_SIZE);
+    memcpy(pch, job.hashSeed.begin(), job.hashSeed.size());
+    WriteLE32(pch + STRATUM_BLOB_WORKER_OFFSET, nWorkerId);
+}
+
+static UniValue StratumJobToJSON(const StratumJob& job, const StratumClient& client)
+{
+    unsigned char vchBlob[STRATUM_BLOB_SIZE];
+    BuildStratumBlob(job, client.nWorkerId, vchBlob);
+    unsigned char vchTarget[8];
+    WriteLE64(vchTarget, nStratumShareTarget);
+
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("blob", HexStr(vchBlob, vchBlob + STRATUM_BLOB_SIZE)));
+    obj.push_back(Pair("job_id", job.strJobId));
+    obj.push_back(Pair("target", HexStr(vchTarget, vchTarget + sizeof(vchTarget))));
+    obj.push_back(Pair("id", strprintf("%u", client.nWorkerId)));
+    obj.push_back(Pair("seed_hash", HexStr(job.block.RandomXKey.begin(), job.block.RandomXKey.end())));
+    obj.push_back(Pair("height", job.nPrevHeight + 1));
+    return obj;
+}
+
+static void SendStratum(struct bufferevent* bev, const UniValue& msg)
+{
+    std::string strMsg = msg.write() + "\n";
+    bufferevent_write(bev, strMsg.data(), strMsg.size());
+}
+
+static void SendStratumReply(struct bufferevent* bev, const UniValue& id, const UniValue& result, const std::string& strError)
+{
+    UniValue reply(UniValue::VOBJ);
+    reply.push_back(Pair("id", id));
+    reply.push_back(Pair("jsonrpc", "2.0"));
+    if (strError.empty()) {
+        reply.push_back(Pair("error", NullUniValue));
+        reply.push_back(Pair("result", result));
+    } else {
+        UniValue error(UniValue::VOBJ);
+        error.push_back(Pair("code", -1));
+        error.push_back(Pair("message", strError));
+        reply.push_back(Pair("error", error));
+        reply.push_back(Pair("result", NullUniValue));
+    }
+    SendStratum(bev, reply);
+}
+
+static void FreeStratumClient(struct bufferevent* bev)
+{
+    mapStratumClients.erase(bev);
+    bufferevent_free(bev);
+}
+
+// Build a fresh template and push it to every logged in worker.  A new tip invalidates all older jobs.
+static void NewStratumJob(bool fNewTip)
+{
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    {
+        LOCK(cs_main);
+        if (!chainActive.Tip() || chainActive.Tip()->nHeight < consensusParams.RANDOMX_HEIGHT || IsInitialBlockDownload())
+            return;
+    }
+
+    std::shared_ptr<StratumJob> job = std::make_shared<StratumJob>();
+    std::string sError;
+    std::vector<unsigned char> vchHeader(STRATUM_BLOB_SIZE, 0);
+    if (!CreateBlockForStratum("", uint256S("0x01"), vchHeader, sError, job->block)) {
+        LogPrintf("stratum: unable to create block template: %s\n", sError);
+        return;
+    }
+    {
+        // The tip may have moved since the template was built, so take the context from the block it builds on
+        LOCK(cs_main);
+        BlockMap::iterator mi = mapBlockIndex.find(job->block.hashPrevBlock);
+        if (mi == mapBlockIndex.end())
+            return;
+        job->nPrevHeight = mi->second->nHeight;
+        job->nPrevTime = mi->second->GetBlockTime();
+    }
+    job->strJobId = strprintf("%x", ++nStratumJobCounter);
+    job->hashSeed = GetRandHash();
+    job->bnTarget.SetCompact(job->block.nBits);
+
+    if (fNewTip || (!dqStratumJobs.empty() && dqStratumJobs.back()->block.hashPrevBlock != job->block.hashPrevBlock)) {
+        dqStratumJobs.clear();
+        for (auto& it : mapStratumClients)
+            it.second.setSubmitted.clear();
+    }
+    dqStratumJobs.push_back(job);
+    while (dqStratumJobs.size() > MAX_STRATUM_JOBS)
+        dqStratumJobs.pop_front();
+
+    for (auto& it : mapStratumClients) {
+        if (!it.second.fLoggedIn)
+            continue;
+        UniValue notify(UniValue::VOBJ);
+        notify.push_back(Pair("jsonrpc", "2.0"));
+        notify.push_back(Pair("method", "job"));
+        notify.push_back(Pair("params", StratumJobToJSON(*job, it.second)));
+        SendStratum(it.first, notify);
+    }
+}
+
+static std::shared_ptr<const StratumJob> FindStratumJob(const std::string& strJobId)
+{
+    for (const auto& job : dqStratumJobs) {
+        if (job->strJobId == strJobId)
+            return job;
+    }
+    return std::shared_ptr<const StratumJob>();
+}
+
+// Runs on the verification pool: hash the share with the shared RandomX cache and submit the block if it also meets the chain target
+static std::string VerifyStratumShare(const StratumJob& job, uint32_t nWorkerId, const std::string& strLogin, const std::vector<unsigned char>& vchBlob, const std::string& strResult)
+{
+    uint256 rxhash;
+    {
+        CRandomXVM vm(job.block.RandomXKey, true);
+        vm.Hash(vchBlob.data(), vchBlob.size(), rxhash.begin());
+    }
+    if (!strResult.empty() && ParseHex(strResult) != std::vector<unsigned char>(rxhash.begin(), rxhash.end()))
+        return "Bad hash";
+    if (ReadLE64(rxhash.begin() + 24) >= nStratumShareTarget)
+        return "Low difficulty share";
+
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    uint256 hash = job.nPrevHeight > consensusParams.POOM_PHASEOUT_HEIGHT ? rxhash : GetRandomXBlakeHash(rxhash, job.block.hashPrevBlock);
+    if (UintToArith256(ComputeRandomXTarget(hash, job.nPrevTime, job.block.GetBlockTime())) <= job.bnTarget) {
+        std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>(job.block);
+        pblock->SetRandomXHeader(vchBlob.data(), vchBlob.data() + vchBlob.size());
+        LogPrintf("stratum: block found by worker %u (%s): %s\n", nWorkerId, strLogin, pblock->GetHash().GetHex());
+        if (!ProcessNewBlock(Params(), pblock, true, NULL))
+            LogPrintf("stratum: block %s rejected\n", pblock->GetHash().GetHex());
+    }
+    return std::string();
+}
+
+// Validate the submit request and hand the share to the verification pool; the reply is sent from stratum_results_cb.
+// Returns an error to send right away instead.
+static std::string QueueStratumShare(struct bufferevent* bev, StratumClient& client, const UniValue& id, const UniValue& params)
+{
+    if (!params.isObject())
+        return "Invalid params";
+    std::shared_ptr<const StratumJob> job = FindStratumJob(find_value(params, "job_id").get_str());
+    if (!job)
+        return "Block expired";
+    std::string strNonce = find_value(params, "nonce").get_str();
+    if (strNonce.size() != 8 || !IsHex(strNonce))
+        return "Invalid nonce";
+    if (nStratumPendingShares >= MAX_STRATUM_PENDING_SHARES)
+        return "Server busy";
+    std::vector<unsigned char> vchNonce = ParseHex(strNonce);
+    if (!client.setSubmitted.insert(std::make_pair(job->strJobId, ReadLE32(vchNonce.data()))).second)
+        return "Duplicate share";
+
+    std::vector<unsigned char> vchBlob(STRATUM_BLOB_SIZE);
+    BuildStratumBlob(*job, client.nWorkerId, vchBlob.data());
+    memcpy(vchBlob.data() + STRATUM_BLOB_NONCE_OFFSET, vchNonce.data(), vchNonce.size());
+    const UniValue& result = find_value(params, "result");
+    std::string strResult = result.isStr() ? result.get_str() : std::string();
+
+    uint32_t nWorkerId = client.nWorkerId;
+    std::string strLogin = client.strLogin;
+    nStratumPendingShares++;
+    stratumVerifyPool.push([bev, nWorkerId, strLogin, id, job, vchBlob, strResult](int threadId) {
+        StratumShareResult shareResult = {bev, nWorkerId, id, std::string()};
+        try {
+            shareResult.strError = VerifyStratumShare(*job, nWorkerId, strLogin, vchBlob, strResult);
+        } catch (const std::exception& e) {
+            shareResult.strError = e.what();
+        }
+        {
+            std::lock_guard<std::mutex> lock(cs_stratumResults);
+            dqStratumResults.push_back(shareResult);
+        }
+        nStratumPendingShares--;
+        event_active(eventStratumResults, 0, 0);
+    });
+    return std::string();
+}
+
+static void HandleStratumRequest(struct bufferevent* bev, StratumClient& client, const UniValue& request)
+{
+    const UniValue& id = find_value(request, "id");
+    const UniValue& method = find_value(request, "method");
+    const UniValue& params = find_value(request, "params");
+    if (!method.isStr()) {
+        SendStratumReply(bev, id, NullUniValue, "Invalid request");
+        return;
+    }
+    const std::string& strMethod = method.get_str();
+
+    if (strMethod == "login") {
+        if (params.isObject() && find_value(params, "login").isStr())
+            client.strLogin = find_value(params, "login").get_str();
+        client.fLoggedIn = true;
+        UniValue result(UniValue::VOBJ);
+        result.push_back(Pair("id", strprintf("%u", client.nWorkerId)));
+        if (!dqStratumJobs.empty())
+            result.push_back(Pair("job", StratumJobToJSON(*dqStratumJobs.back(), client)));
+        result.push_back(Pair("status", "OK"));
+        SendStratumReply(bev, id, result, "");
+    } else if (!client.fLoggedIn) {
+        SendStratumReply(bev, id, NullUniValue, "Unauthenticated");
+    } else if (strMethod == "getjob") {
+        if (dqStratumJobs.empty())
+            SendStratumReply(bev, id, NullUniValue, "No job available");
+        else
+            SendStratumReply(bev, id, StratumJobToJSON(*dqStratumJobs.back(), client), "");
+    } else if (strMethod == "submit") {
+        std::string strError = QueueStratumShare(bev, client, id, params);
+        if (!strError.empty())
+            SendStratumReply(bev, id, NullUniValue, strError);
+    } else if (strMethod == "keepalived") {
+        UniValue result(UniValue::VOBJ);
+        result.push_back(Pair("status", "KEEPALIVED"));
+        SendStratumReply(bev, id, result, "");
+    } else {
+        SendStratumReply(bev, id, NullUniValue, "Unknown method");
+    }
+}
+
+static void stratum_read_cb(struct bufferevent* bev, void* ctx)
+{
+    auto it = mapStratumClients.find(bev);
+    if (it == mapStratumClients.end())
+        return;
+    struct evbuffer* input = bufferevent_get_input(bev);
+    size_t nLen = 0;
+    while (char* line = evbuffer_readln(input, &nLen, EVBUFFER_EOL_CRLF)) {
+        std::string strLine(line, nLen);
+        free(line);
+        if (strLine.empty())
+            continue;
+        UniValue request;
+        if (!request.read(strLine) || !request.isObject()) {
+            LogPrint("stratum", "stratum: dropping worker %u, malformed request\n", it->second.nWorkerId);
+            FreeStratumClient(bev);
+            return;
+        }
+        try {
+            HandleStratumRequest(bev, it->second, request);
+        } catch (const std::exception& e) {
+            SendStratumReply(bev, find_value(request, "id"), NullUniValue, e.what());
+        }
+    }
+    if (evbuffer_get_length(input) > MAX_STRATUM_REQUEST_SIZE) {
+        LogPrint("stratum", "stratum: dropping worker %u, request too large\n", it->second.nWorkerId);
+        FreeStratumClient(bev);
+    }
+}
+
+static void stratum_event_cb(struct bufferevent* bev, short what, void* ctx)
+{
+    if (what & (BEV_EVENT_EOF | BEV_EVENT_ERROR | BEV_EVENT_TIMEOUT))
+        FreeStratumClient(bev);
+}
+
+static void stratum_accept_cb(struct evconnlistener* listener, evutil_socket_t fd, struct sockaddr* address, int socklen, void* ctx)
+{
+    if (mapStratumClients.size() >= nStratumMaxClients) {
+        evutil_closesocket(fd);
+        return;
+    }
+    struct bufferevent* bev = bufferevent_socket_new(eventBaseStratum, fd, BEV_OPT_CLOSE_ON_FREE);
+    if (!bev) {
+        evutil_closesocket(fd);
+        return;
+    }
+    StratumClient& client = mapStratumClients[bev];
+    client.nWorkerId = nStratumNextWorkerId++;
+    client.fLoggedIn = false;
+    struct timeval tv = {STRATUM_TIMEOUT_SECONDS, 0};
+    bufferevent_set_timeouts(bev, &tv, NULL);
+    bufferevent_setcb(bev, stratum_read_cb, NULL, stratum_event_cb, NULL);
+    bufferevent_enable(bev, EV_READ | EV_WRITE);
+    LogPrint("stratum", "stratum: worker %u connected\n", client.nWorkerId);
+}
+
+static void stratum_newtip_cb(evutil_socket_t fd, short what, void* ctx)
+{
+    NewStratumJob(true);
+}
+
+static void stratum_refresh_cb(evutil_socket_t fd, short what, void* ctx)
+{
+    NewStratumJob(false);
+}
+
+static void stratum_results_cb(evutil_socket_t fd, short what, void* ctx)
+{
+    std::deque<StratumShareResult> dqResults;
+    {
+        std::lock_guard<std::mutex> lock(cs_stratumResults);
+        dqResults.swap(dqStratumResults);
+    }
+    for (const StratumShareResult& shareResult : dqResults) {
+        // The worker may have disconnected while its share was verified, and the bufferevent been reused since
+        auto it = mapStratumClients.find(shareResult.bev);
+        if (it == mapStratumClients.end() || it->second.nWorkerId != shareResult.nWorkerId)
+            continue;
+        UniValue result(UniValue::VOBJ);
+        result.push_back(Pair("status", "OK"));
+        SendStratumReply(shareResult.bev, shareResult.id, result, shareResult.strError);
+    }
+}
+
+static void ThreadStratum()
+{
+    RenameThread("dac-stratum");
+    LogPrintf("stratum: thread start\n");
+    NewStratumJob(true);
+    event_base_dispatch(eventBaseStratum);
+    LogPrintf("stratum: thread exit\n");
+}
+
+bool StartStratumServer()
+{
+    int nPort = GetArg("-stratumport", DEFAULT_STRATUM_PORT);
+    if (nPort <= 0)
+        return true;
+    uint64_t nDiff = std::max((int64_t)1, GetArg("-stratumdiff", (int64_t)DEFAULT_STRATUM_DIFF));
+    nStratumShareTarget = std::numeric_limits<uint64_t>::max() / nDiff;
+    nStratumMaxClients = std::max((int64_t)1, GetArg("-stratummaxclients", DEFAULT_STRATUM_MAX_CLIENTS));
+
+    CService addrBind;
+    std::string strBind = GetArg("-stratumbind", "127.0.0.1");
+    if (!Lookup(strBind.c_str(), addrBind, nPort, false)) {
+        LogPrintf("stratum: invalid -stratumbind address %s\n", strBind);
+        return false;
+    }
+    struct sockaddr_storage sockaddr;
+    socklen_t len = sizeof(sockaddr);
+    if (!addrBind.GetSockAddr((struct sockaddr*)&sockaddr, &len)) {
+        LogPrintf("stratum: unsupported -stratumbind address %s\n", strBind);
+        return false;
+    }
+
+#ifdef WIN32
+    evthread_use_windows_threads();
+#else
+    evthread_use_pthreads();
+#endif
+    eventBaseStratum = event_base_new();
+    if (!eventBaseStratum) {
+        LogPrintf("stratum: unable to create event_base\n");
+        return false;
+    }
+    listenerStratum = evconnlistener_new_bind(eventBaseStratum, stratum_accept_cb, NULL,
+        LEV_OPT_CLOSE_ON_FREE | LEV_OPT_REUSEABLE, -1, (struct sockaddr*)&sockaddr, len);
+    if (!listenerStratum) {
+        LogPrintf("stratum: unable to bind to %s\n", addrBind.ToString());
+        event_base_free(eventBaseStratum);
+        eventBaseStratum = NULL;
+        return false;
+    }
+    eventStratumNewTip = event_new(eventBaseStratum, -1, 0, stratum_newtip_cb, NULL);
+    eventStratumRefresh = event_new(eventBaseStratum, -1, EV_PERSIST, stratum_refresh_cb, NULL);
+    eventStratumResults = event_new(eventBaseStratum, -1, 0, stratum_results_cb, NULL);
+    struct timeval tvRefresh = {STRATUM_REFRESH_SECONDS, 0};
+    event_add(eventStratumRefresh, &tvRefresh);
+    RegisterValidationInterface(&stratumTipListener);
+    stratumVerifyPool.resize(std::max((int64_t)1, GetArg("-stratumthreads", DEFAULT_STRATUM_THREADS)));
+    RenameThreadPool(stratumVerifyPool, "dac-stratumv");
+
+    LogPrintf("stratum: listening on %s, share difficulty %u\n", addrBind.ToString(), nDiff);
+    threadStratum = std::thread(ThreadStratum);
+    return true;
+}
+
+void InterruptStratumServer()
+{
+    if (eventBaseStratum) {
+        event_base_loopbreak(eventBaseStratum);
+        stratumVerifyPool.clear_queue();
+    }
+}
+
+void StopStratumServer()
+{
+    if (!eventBaseStratum)
+        return;
+    UnregisterValidationInterface(&stratumTipListener);
+    event_base_loopbreak(eventBaseStratum);
+    if (threadStratum.joinable())
+        threadStratum.join();
+    // Shares still being hashed post to eventStratumResults, so the pool goes before the events
+    stratumVerifyPool.clear_queue();
+    stratumVerifyPool.stop(true);
+    nStratumPendingShares = 0;
+    dqStratumResults.clear();
+    for (auto& it : mapStratumClients)
+        bufferevent_free(it.first);
+    mapStratumClients.clear();
+    dqStratumJobs.clear();
+    event_free(eventStratumNewTip);
+    eventStratumNewTip = NULL;
+    event_free(eventStratumRefresh);
+    eventStratumRefresh = NULL;
+    event_free(eventStratumResults);
+    eventStratumResults = NULL;
+    evconnlistener_free(listenerStratum);
+    listenerStratum = NULL;
+    event_base_free(eventBaseStratum);
+    eventBaseStratum = NULL;
+}
@@ -0,0 +1,30 @@
+// Copyright (c) 2014-2019 The Dash Core Developers, The DAC Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+/**
+ * Embedded Stratum server (line delimited JSON-RPC over TCP) for RandomX miners.
+ * All connected workers share one block template; only the RandomX header differs per worker.
+ */
+#ifndef BITCOIN_STRATUM_H
+#define BITCOIN_STRATUM_H
+
+#include <stdint.h>
+
+/** Default for -stratumport (0 = disabled) */
+static const int DEFAULT_STRATUM_PORT = 0;
+/** Default for -stratumdiff */
+static const uint64_t DEFAULT_STRATUM_DIFF = 10000;
+/** Default for -stratummaxclients */
+static const int DEFAULT_STRATUM_MAX_CLIENTS = 256;
+/** Default for -stratumthreads, the threads verifying submitted shares */
+static const int DEFAULT_STRATUM_THREADS = 2;
+
+/** Start the Stratum server if -stratumport is set. Returns false if it was requested but could not be started. */
+bool StartStratumServer();
+/** Break out of the Stratum event loop */
+void InterruptStratumServer();
+/** Join the Stratum thread and free its resources */
+void StopStratumServer();
+
+#endif // BITCOIN_STRATUM_H
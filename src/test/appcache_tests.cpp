@@ -0,0 +1,163 @@
+// Copyright (c) 2014-2019 The Dash Core Developers, The DAC Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "appcache.h"
+
+#include "test/test_coin.h"
+#include "util.h"
+
+#include <thread>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(appcache_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(appcache_read_write)
+{
+    CApplicationCache cache;
+    BOOST_CHECK(cache.Read("SPORK", "MISSING") == CAppCacheEntry("", 0));
+    // A miss must not create the entry
+    BOOST_CHECK_EQUAL(cache.Size(), 0);
+
+    cache.Write("SPORK", "KEY1", "value1", 100);
+    cache.Write("SPORK", "KEY1", "value2", 200);
+    cache.Write("PRAYER", "P1", "pray", 300);
+    BOOST_CHECK(cache.Read("SPORK", "KEY1") == CAppCacheEntry("value2", 200));
+    BOOST_CHECK(cache.Read("PRAYER", "P1") == CAppCacheEntry("pray", 300));
+    BOOST_CHECK(cache.Read("PRAYER", "KEY1") == CAppCacheEntry("", 0));
+    BOOST_CHECK_EQUAL(cache.GetSectionCount(), 2);
+    BOOST_CHECK_EQUAL(cache.Size(), 2);
+
+    cache.ClearSection("SPORK");
+    BOOST_CHECK(cache.Read("SPORK", "KEY1") == CAppCacheEntry("", 0));
+    BOOST_CHECK_EQUAL(cache.GetSection("SPORK").size(), 1);
+    BOOST_CHECK_EQUAL(cache.GetSectionSize("SPORK"), 1);
+    BOOST_CHECK_EQUAL(cache.GetSectionSize("MISSING"), 0);
+    BOOST_CHECK(cache.Read("PRAYER", "P1") == CAppCacheEntry("pray", 300));
+
+    // Unlike a cleared value, an erased key is gone from the section
+    cache.Erase("SPORK", "KEY1");
+    cache.Erase("SPORK", "MISSING");
+    cache.Erase("MISSING", "KEY1");
+    BOOST_CHECK_EQUAL(cache.GetSectionSize("SPORK"), 0);
+    BOOST_CHECK(cache.Read("SPORK", "KEY1") == CAppCacheEntry("", 0));
+    BOOST_CHECK_EQUAL(cache.Size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(appcache_section_order)
+{
+    CApplicationCache cache;
+    cache.Write("CPK-WCG", "B", "2", 2);
+    cache.Write("CPK", "Z", "3", 3);
+    cache.Write("CPK-WCG", "A", "1", 1);
+    cache.Write("DWS-BURN", "C", "4", 4);
+
+    std::vector<std::pair<std::string, CAppCacheEntry>> vEntries = cache.GetSection("CPK-WCG");
+    BOOST_CHECK_EQUAL(vEntries.size(), 2);
+    BOOST_CHECK_EQUAL(vEntries[0].first, "A");
+    BOOST_CHECK_EQUAL(vEntries[1].first, "B");
+    BOOST_CHECK(cache.GetSection("MISSING").empty());
+
+    std::vector<std::string> vNames = cache.GetSectionNames("CPK");
+    BOOST_CHECK_EQUAL(vNames.size(), 2);
+    BOOST_CHECK_EQUAL(vNames[0], "CPK");
+    BOOST_CHECK_EQUAL(vNames[1], "CPK-WCG");
+    BOOST_CHECK_EQUAL(cache.GetSectionNames().size(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(appcache_concurrent)
+{
+    CApplicationCache cache;
+    const int nThreads = 4;
+    const int nKeys = 500;
+    std::vector<std::thread> vThreads;
+    for (int t = 0; t < nThreads; t++) {
+        vThreads.emplace_back([&cache, t, nKeys]() {
+            std::string sSection = (t % 2 == 0) ? "EVEN" : "ODD";
+            for (int i = 0; i < nKeys; i++) {
+                cache.Write(sSection, std::to_string(t) + "-" + std::to_string(i), "v", i);
+                cache.Read(sSection, std::to_string(t) + "-" + std::to_string(i / 2));
+            }
+        });
+    }
+    for (auto& thread : vThreads)
+        thread.join();
+    BOOST_CHECK_EQUAL(cache.GetSectionCount(), 2);
+    BOOST_CHECK_EQUAL(cache.Size(), nThreads * nKeys);
+    BOOST_CHECK_EQUAL(cache.GetSection("EVEN").size(), 2 * nKeys);
+}
+
+BOOST_AUTO_TEST_CASE(appcache_snapshot)
+{
+    std::string sPath = (GetDataDir() / "appcache_test.dat").string();
+    CApplicationCache cache;
+    cache.Write("PRAYER", "P1", "first", 10);
+    cache.Write("DWS-BURN", "TX1", "<dws/>", 20);
+    cache.StartJournal();
+    QueueAppCacheSnapshot(sPath, cache.GetAll(), 100, true);
+    BOOST_CHECK(cache.TakeJournal().empty());
+
+    cache.Write("PRAYER", "P1", "second", 30);
+    cache.Write("PRAYER", "P2", "third", 40);
+    cache.Write("PRAYER", "P2", "third", 40);
+    cache.Erase("DWS-BURN", "TX1");
+    std::vector<CAppCacheRecord> vJournal = cache.TakeJournal();
+    BOOST_CHECK_EQUAL(vJournal.size(), 3);
+    BOOST_CHECK(vJournal[0].sKey == "TX1" && vJournal[0].fErased);
+    BOOST_CHECK(!vJournal[1].fErased && !vJournal[2].fErased);
+    QueueAppCacheSnapshot(sPath, std::move(vJournal), 101, false);
+    StopAppCacheSnapshotWriter();
+
+    CApplicationCache loaded;
+    int nRecords = 0;
+    BOOST_CHECK_EQUAL(LoadAppCacheSnapshot(sPath, loaded, nRecords), 101);
+    BOOST_CHECK_EQUAL(nRecords, 5);
+    BOOST_CHECK(loaded.Read("PRAYER", "P1") == CAppCacheEntry("second", 30));
+    BOOST_CHECK(loaded.Read("PRAYER", "P2") == CAppCacheEntry("third", 40));
+    // The erase in the appended chunk removes the key the full dump wrote
+    BOOST_CHECK_EQUAL(loaded.GetSectionSize("DWS-BURN"), 0);
+
+    // A torn append is discarded and truncated away
+    uint64_t nSize = boost::filesystem::file_size(sPath);
+    FILE* file = fopen(sPath.c_str(), "ab");
+    fwrite("garbage-chunk", 1, 13, file);
+    fclose(file);
+    CApplicationCache reloaded;
+    BOOST_CHECK_EQUAL(LoadAppCacheSnapshot(sPath, reloaded, nRecords), 101);
+    BOOST_CHECK(reloaded.Read("PRAYER", "P1") == CAppCacheEntry("second", 30));
+    BOOST_CHECK_EQUAL(boost::filesystem::file_size(sPath), nSize);
+
+    BOOST_CHECK_EQUAL(LoadAppCacheSnapshot(sPath + ".missing", reloaded, nRecords), -1);
+
+    // The writer stays stopped, later snapshots are dropped instead of starting a thread nobody joins
+    QueueAppCacheSnapshot(sPath, cache.GetAll(), 102, true);
+    StopAppCacheSnapshotWriter();
+    BOOST_CHECK_EQUAL(LoadAppCacheSnapshot(sPath, reloaded, nRecords), 101);
+    boost::filesystem::remove(sPath);
+}
+
+BOOST_AUTO_TEST_CASE(appcache_journal_overflow)
+{
+    CApplicationCache cache;
+    cache.StartJournal();
+    // Rewrites of a key already in the journal do not count
+    for (size_t i = 0; i < MAX_APPCACHE_JOURNAL; i++)
+        cache.Write("PRAYER", "P1", "value", i);
+    BOOST_CHECK(!cache.IsJournalOverflowed());
+    for (size_t i = 1; i < MAX_APPCACHE_JOURNAL; i++)
+        cache.Write("PRAYER", "K" + std::to_string(i), "value", i);
+    BOOST_CHECK(!cache.IsJournalOverflowed());
+    cache.Write("PRAYER", "P2", "value", 0);
+    BOOST_CHECK(cache.IsJournalOverflowed());
+    BOOST_CHECK(cache.TakeJournal().empty());
+
+    // A full snapshot restarts the journal
+    cache.StartJournal();
+    BOOST_CHECK(!cache.IsJournalOverflowed());
+    cache.Write("PRAYER", "P3", "value", 1);
+    BOOST_CHECK_EQUAL(cache.TakeJournal().size(), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,222 @@
+// Copyright (c) 2014-2019 The Dash Core Developers, The DAC Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "rpcpog.h"
+
+#include "crypto/sha256.h"
+#include "random.h"
+#include "test/test_coin.h"
+#include "util.h"
+#include "utilstrencodings.h"
+
+#include <fstream>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(bipfs_tests, TestingSetup)
+
+static std::string ReadTestFile(const boost::filesystem::path& path)
+{
+    std::ifstream ifs(path.string(), std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+}
+
+static void WriteTestFile(const boost::filesystem::path& path, const std::string& sData)
+{
+    std::ofstream ofs(path.string(), std::ios::binary);
+    ofs.write(sData.data(), sData.size());
+}
+
+static std::string RandomTestData(size_t nSize)
+{
+    std::vector<unsigned char> vch(nSize);
+    GetRandBytes(vch.data(), vch.size());
+    return std::string(vch.begin(), vch.end());
+}
+
+BOOST_AUTO_TEST_CASE(bipfs_encrypt_roundtrip)
+{
+    ForceSetArg("-encryptionkey", "bipfs test key");
+    // Three full chunks and a partial one
+    std::string sPlain = RandomTestData(3 * 1048576 + 4321);
+    boost::filesystem::path pathPlain = pathTemp / "plain.bin";
+    boost::filesystem::path pathEnc = pathTemp / "plain.enc";
+    boost::filesystem::path pathDec = pathTemp / "plain.dec";
+    WriteTestFile(pathPlain, sPlain);
+
+    BOOST_CHECK(EncryptFile(pathPlain.string(), pathEnc.string()));
+    std::string sEnc = ReadTestFile(pathEnc);
+    // 69 bytes of header and tag per record, no hex or base64 expansion
+    BOOST_CHECK_EQUAL(sEnc.size(), sPlain.size() + 4 * 69);
+    BOOST_CHECK(DecryptFile(pathEnc.string(), pathDec.string()));
+    BOOST_CHECK(ReadTestFile(pathDec) == sPlain);
+
+    // A flipped bit, a missing final record or a record appended after it must all fail, without leaving plaintext behind
+    boost::filesystem::path pathBad = pathTemp / "bad.enc";
+    boost::filesystem::path pathBadDec = pathTemp / "bad.dec";
+    std::string sTampered = sEnc;
+    sTampered[2000000] ^= 1;
+    WriteTestFile(pathBad, sTampered);
+    BOOST_CHECK(!DecryptFile(pathBad.string(), pathBadDec.string()));
+    BOOST_CHECK(!boost::filesystem::exists(pathBadDec));
+    WriteTestFile(pathBad, sEnc.substr(0, sEnc.size() - (4321 + 69)));
+    BOOST_CHECK(!DecryptFile(pathBad.string(), pathBadDec.string()));
+    WriteTestFile(pathBad, sEnc + sEnc.substr(0, 1048576 + 69));
+    BOOST_CHECK(!DecryptFile(pathBad.string(), pathBadDec.string()));
+
+    // Another key cannot open it
+    ForceSetArg("-encryptionkey", "another key");
+    BOOST_CHECK(!DecryptFile(pathEnc.string(), pathBadDec.string()));
+    ForceSetArg("-encryptionkey", "");
+}
+
+BOOST_AUTO_TEST_CASE(bipfs_split_file)
+{
+    ForceSetArg("-encryptionkey", "bipfs test key");
+    std::string sPlain = RandomTestData(10500000);
+    boost::filesystem::path pathPlain = pathTemp / "split.bin";
+    WriteTestFile(pathPlain, sPlain);
+
+    for (bool fEncrypted : {false, true}) {
+        std::string sDir;
+        std::vector<BIPFSPart> vParts;
+        BOOST_CHECK(SplitFile(pathPlain.string(), fEncrypted, sDir, vParts));
+        BOOST_CHECK_EQUAL(vParts.size(), 2);
+
+        std::string sJoined;
+        for (const BIPFSPart& part : vParts) {
+            std::string sPart = ReadTestFile(part.sPath);
+            BOOST_CHECK(part.nSize == (int64_t)sPart.size());
+            BOOST_CHECK(part.nSize <= 10000000);
+            unsigned char vchHash[CSHA256::OUTPUT_SIZE];
+            CSHA256().Write((const unsigned char*)sPart.data(), sPart.size()).Finalize(vchHash);
+            BOOST_CHECK_EQUAL(part.sHash, HexStr(vchHash, vchHash + sizeof(vchHash)));
+            sJoined += sPart;
+        }
+
+        if (!fEncrypted) {
+            BOOST_CHECK(sJoined == sPlain);
+        } else {
+            // The parts hold whole records, so the joined upload decrypts as one container
+            boost::filesystem::path pathJoined = pathTemp / "joined.enc";
+            boost::filesystem::path pathDec = pathTemp / "joined.dec";
+            WriteTestFile(pathJoined, sJoined);
+            BOOST_CHECK(DecryptFile(pathJoined.string(), pathDec.string()));
+            BOOST_CHECK(ReadTestFile(pathDec) == sPlain);
+        }
+        boost::filesystem::remove_all(sDir);
+    }
+    ForceSetArg("-encryptionkey", "");
+}
+
+// Leaves a manifest for sPath as PrepareBIPFSUpload would after a split
+static void WriteTestManifest(const boost::filesystem::path& path, const std::string& sWebPath, const std::string& sTXID, int nDensity, int nDuration, bool fEncrypted)
+{
+    BIPFSUpload u;
+    DescribeBIPFSUpload(path.string(), sWebPath, sTXID, nDensity, nDuration, fEncrypted, u);
+    boost::filesystem::create_directories(u.sDir);
+    BIPFSPart part;
+    part.sPath = u.sDir + "/" + u.sOriginalName + ".0";
+    part.nSize = u.nSourceSize;
+    part.sHash = u.sSourceHash;
+    u.vParts.push_back(part);
+    u.vUploaded.push_back(false);
+    BOOST_CHECK(WriteBIPFSManifest(u));
+}
+
+BOOST_AUTO_TEST_CASE(bipfs_manifest_roundtrip)
+{
+    boost::filesystem::path pathFile = pathTemp / "manifest.bin";
+    WriteTestFile(pathFile, RandomTestData(12345));
+    BIPFSUpload u;
+    DescribeBIPFSUpload(pathFile.string(), "site/manifest", "txid1", 2, 30, true, u);
+    BOOST_CHECK_EQUAL(u.nSourceSize, 12345);
+    BOOST_CHECK_EQUAL(u.sSourceHash.size(), 64U);
+    boost::filesystem::create_directories(u.sDir);
+    for (int i = 0; i < 3; i++) {
+        BIPFSPart part;
+        part.sPath = u.sDir + "/part" + std::to_string(i);
+        part.nSize = 1000 + i;
+        part.sHash = std::string(64, 'a' + i);
+        u.vParts.push_back(part);
+        u.vUploaded.push_back(i == 1);
+    }
+    u.sFinalResponse = "<response/>";
+    BOOST_CHECK(WriteBIPFSManifest(u));
+
+    BIPFSUpload m;
+    BOOST_CHECK(ReadBIPFSManifest(u.sDir, m));
+    BOOST_CHECK_EQUAL(m.sTXID, "txid1");
+    BOOST_CHECK_EQUAL(m.sWebPath, "site/manifest");
+    BOOST_CHECK_EQUAL(m.nDensity, 2);
+    BOOST_CHECK_EQUAL(m.nDuration, 30);
+    BOOST_CHECK(m.fEncrypted);
+    BOOST_CHECK_EQUAL(m.nSourceSize, 12345);
+    BOOST_CHECK_EQUAL(m.sSourceHash, u.sSourceHash);
+    BOOST_CHECK_EQUAL(m.sFinalResponse, "<response/>");
+    BOOST_CHECK_EQUAL(m.vParts.size(), 3U);
+    for (size_t i = 0; i < m.vParts.size(); i++) {
+        BOOST_CHECK_EQUAL(m.vParts[i].sPath, u.vParts[i].sPath);
+        BOOST_CHECK_EQUAL(m.vParts[i].nSize, u.vParts[i].nSize);
+        BOOST_CHECK_EQUAL(m.vParts[i].sHash, u.vParts[i].sHash);
+        BOOST_CHECK_EQUAL(m.vUploaded[i], i == 1);
+    }
+
+    // A manifest without the source hash (or otherwise damaged) is not resumable
+    WriteTestFile(boost::filesystem::path(u.sDir) / "manifest.json", "{\"txid\":\"txid1\",\"parts\":[]}");
+    BOOST_CHECK(!ReadBIPFSManifest(u.sDir, m));
+    boost::filesystem::remove_all(u.sDir);
+}
+
+BOOST_AUTO_TEST_CASE(bipfs_resume_decision)
+{
+    boost::filesystem::path pathFolder = pathTemp / "resume";
+    boost::filesystem::create_directories(pathFolder / "sub");
+    boost::filesystem::path pathA = pathFolder / "a.bin";
+    boost::filesystem::path pathB = pathFolder / "sub" / "b.bin";
+    WriteTestFile(pathA, RandomTestData(5000));
+    WriteTestFile(pathB, RandomTestData(7000));
+    std::string sFolder = pathFolder.string();
+
+    // Nothing prepared yet
+    BOOST_CHECK_EQUAL(BIPFS_GetResumeTXID(sFolder, "web", true, 1, 30, false), "");
+
+    // Only one file of the folder was prepared: the fee paid does not cover the other one
+    WriteTestManifest(pathA, "web", "txid1", 1, 30, false);
+    BOOST_CHECK_EQUAL(BIPFS_GetResumeTXID(sFolder, "web", true, 1, 30, false), "");
+    BOOST_CHECK_EQUAL(BIPFS_GetResumeTXID(pathA.string(), "web", false, 1, 30, false), "txid1");
+
+    WriteTestManifest(pathB, "web", "txid1", 1, 30, false);
+    BOOST_CHECK_EQUAL(BIPFS_GetResumeTXID(sFolder, "web", true, 1, 30, false), "txid1");
+
+    // Any other parameter needs a new fee
+    BOOST_CHECK_EQUAL(BIPFS_GetResumeTXID(sFolder, "other", true, 1, 30, false), "");
+    BOOST_CHECK_EQUAL(BIPFS_GetResumeTXID(sFolder, "web", true, 2, 30, false), "");
+    BOOST_CHECK_EQUAL(BIPFS_GetResumeTXID(sFolder, "web", true, 1, 31, false), "");
+    BOOST_CHECK_EQUAL(BIPFS_GetResumeTXID(sFolder, "web", true, 1, 30, true), "");
+
+    // The files were prepared under different transactions
+    WriteTestManifest(pathB, "web", "txid2", 1, 30, false);
+    BOOST_CHECK_EQUAL(BIPFS_GetResumeTXID(sFolder, "web", true, 1, 30, false), "");
+    WriteTestManifest(pathB, "web", "txid1", 1, 30, false);
+
+    // Same size, different content
+    WriteTestFile(pathB, RandomTestData(7000));
+    BOOST_CHECK_EQUAL(BIPFS_GetResumeTXID(sFolder, "web", true, 1, 30, false), "");
+    WriteTestManifest(pathB, "web", "txid1", 1, 30, false);
+    BOOST_CHECK_EQUAL(BIPFS_GetResumeTXID(sFolder, "web", true, 1, 30, false), "txid1");
+
+    // A file added to the folder since
+    WriteTestFile(pathFolder / "c.bin", RandomTestData(100));
+    BOOST_CHECK_EQUAL(BIPFS_GetResumeTXID(sFolder, "web", true, 1, 30, false), "");
+
+    for (const auto& path : {pathA, pathB, pathFolder / "c.bin"}) {
+        BIPFSUpload u;
+        DescribeBIPFSUpload(path.string(), "", "", 0, 0, false, u);
+        boost::filesystem::remove_all(u.sDir);
+    }
+    boost::filesystem::remove_all(pathFolder);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
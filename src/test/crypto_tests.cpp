@@ -187,6 +187,29 @@ void TestAES256CBC(const std::string &hexkey, const std::string &hexiv, bool pad
     }
 }
 
+void TestAES256CTR(const std::string &hexkey, const std::string &hexiv, const std::string &hexin, const std::string &hexout)
+{
+    std::vector<unsigned char> key = ParseHex(hexkey);
+    std::vector<unsigned char> iv = ParseHex(hexiv);
+    std::vector<unsigned char> in = ParseHex(hexin);
+    std::vector<unsigned char> correctout = ParseHex(hexout);
+    std::vector<unsigned char> realout(in.size());
+
+    // Encrypt the plaintext in one call and verify that it equals the cipher
+    AES256CTR(&key[0], &iv[0]).Crypt(&in[0], in.size(), &realout[0]);
+    BOOST_CHECK_MESSAGE(realout == correctout, HexStr(realout) + std::string(" != ") + hexout);
+
+    // Decrypt the cipher in pieces of every size and verify that the key stream continues across calls
+    for (size_t step = 1; step <= in.size(); step++) {
+        std::vector<unsigned char> decrypted(correctout.size());
+        AES256CTR dec(&key[0], &iv[0]);
+        for (size_t pos = 0; pos < correctout.size(); pos += step) {
+            dec.Crypt(&correctout[pos], std::min(step, correctout.size() - pos), &decrypted[pos]);
+        }
+        BOOST_CHECK_MESSAGE(decrypted == in, HexStr(decrypted) + std::string(" != ") + hexin);
+    }
+}
+
 std::string LongTestString(void) {
     std::string ret;
     for (int i=0; i<200000; i++) {
@@ -439,6 +462,17 @@ BOOST_AUTO_TEST_CASE(aes_cbc_testvectors) {
                   "b2eb05e2c39be9fcda6c19078c6a9d1b3f461796d6b0d6b2e0c2a72b4d80e644");
 }
 
+BOOST_AUTO_TEST_CASE(aes_ctr_testvectors) {
+    // NIST AES CTR 256-bit test-vectors (SP 800-38A F.5.5)
+    TestAES256CTR("603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4", "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff", \
+                  "6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e5130c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710", \
+                  "601ec313775789a5b7a7f504bbf3d228f443e3ca4d62b59aca84e990cacaf5c52b0930daa23de94ce87017ba2d84988ddfc9c58db67aada613c2dd08457941a6");
+    // The counter carries across its 64-bit halves, and a partial last block is allowed
+    TestAES256CTR("603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4", "00000000000000fffffffffffffffffe", \
+                  "6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e5130c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c37", \
+                  "dcf0bffd0686ce548879b81939626460a3af17133f20f269671a58f98d0ac3df3a062b49d848813b9ad55affe76e843082ae0b4a68a3614d2b8db8785d33bc");
+}
+
 BOOST_AUTO_TEST_CASE(pbkdf2_hmac_sha512_test) {
     // test vectors from
     // https://github.com/trezor/trezor-crypto/blob/87c920a7e747f7ed40b6ae841327868ab914435b/tests.c#L1936-L1957
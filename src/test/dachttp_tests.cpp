@@ -0,0 +1,195 @@
+// Copyright (c) 2014-2019 The Dash Core Developers, The DAC Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bbpsocket.h"
+
+#include "compat.h"
+#include "netbase.h"
+#include "test/test_coin.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+/**
+ * Loopback HTTP server answering with canned bytes.  The i-th accepted connection sends vConnections[i] in order,
+ * one response per request it receives; an empty response closes the connection without answering that request.
+ * A connection is closed after its last response, or when the client closes it.
+ */
+class CannedHttpServer
+{
+public:
+    std::atomic<int> nAccepted;
+    int nPort;
+
+    explicit CannedHttpServer(const std::vector<std::vector<std::string> >& vConnectionsIn) : nAccepted(0), nPort(0), vConnections(vConnectionsIn)
+    {
+        hListen = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        BOOST_REQUIRE(bind(hListen, (struct sockaddr*)&addr, len) == 0);
+        BOOST_REQUIRE(listen(hListen, 4) == 0);
+        BOOST_REQUIRE(getsockname(hListen, (struct sockaddr*)&addr, &len) == 0);
+        nPort = ntohs(addr.sin_port);
+        threadAccept = std::thread([this] { Accept(); });
+    }
+
+    ~CannedHttpServer()
+    {
+        threadAccept.join();
+        for (auto& thread : vThreads)
+            thread.join();
+        CloseSocket(hListen);
+    }
+
+    DACHttpRequest Request(const std::string& sPage) const
+    {
+        DACHttpRequest request;
+        request.fSSL = false;
+        request.sHost = "127.0.0.1";
+        request.iPort = nPort;
+        request.sPage = sPage;
+        request.iTimeoutSecs = 5;
+        return request;
+    }
+
+private:
+    std::vector<std::vector<std::string> > vConnections;
+    SOCKET hListen;
+    std::thread threadAccept;
+    std::vector<std::thread> vThreads;
+
+    static bool WaitReadable(SOCKET hSocket)
+    {
+        fd_set fdset;
+        FD_ZERO(&fdset);
+        FD_SET(hSocket, &fdset);
+        struct timeval timeout = {5, 0};
+        return select(hSocket + 1, &fdset, nullptr, nullptr, &timeout) == 1;
+    }
+
+    void Accept()
+    {
+        for (const auto& vResponses : vConnections) {
+            if (!WaitReadable(hListen))
+                return;
+            SOCKET hSocket = accept(hListen, nullptr, nullptr);
+            if (hSocket == INVALID_SOCKET)
+                return;
+            nAccepted++;
+            vThreads.emplace_back([hSocket, vResponses] { Serve(hSocket, vResponses); });
+        }
+    }
+
+    static void Serve(SOCKET hSocket, const std::vector<std::string>& vResponses)
+    {
+        for (const std::string& sResponse : vResponses) {
+            // The requests are GETs, so a request ends with its headers
+            std::string sRequest;
+            while (sRequest.find("\r\n\r\n") == std::string::npos) {
+                char buf[4096];
+                if (!WaitReadable(hSocket))
+                    break;
+                ssize_t nRead = recv(hSocket, buf, sizeof(buf), 0);
+                if (nRead <= 0)
+                    break;
+                sRequest.append(buf, nRead);
+            }
+            if (sRequest.find("\r\n\r\n") == std::string::npos || sResponse.empty())
+                break;
+            send(hSocket, sResponse.data(), sResponse.size(), MSG_NOSIGNAL);
+        }
+        CloseSocket(hSocket);
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(dachttp_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(dachttp_chunked)
+{
+    // Chunk extensions and trailers are consumed, so the connection is clean and goes back to the pool
+    CannedHttpServer server({std::vector<std::string>{
+        "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+        "5;name=value\r\nhello\r\n6\r\n world\r\n0\r\nX-Checksum: abc\r\nX-Other: def\r\n\r\n",
+        "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok"}});
+    DACHttpResponse response;
+    BOOST_CHECK(DACHttpExecute(server.Request("first"), response));
+    BOOST_CHECK_EQUAL(response.nStatus, 200);
+    BOOST_CHECK_EQUAL(response.sBody, "hello world");
+    BOOST_CHECK(DACHttpExecute(server.Request("second"), response));
+    BOOST_CHECK_EQUAL(response.sBody, "ok");
+    BOOST_CHECK_EQUAL(server.nAccepted, 1);
+}
+
+BOOST_AUTO_TEST_CASE(dachttp_truncated)
+{
+    CannedHttpServer server({
+        {"HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\nabc"},
+        {"HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhel"},
+        {"HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabc\r\n0\r\n"}});
+    DACHttpResponse response;
+    BOOST_CHECK(!DACHttpExecute(server.Request("length"), response));
+    BOOST_CHECK_EQUAL(response.sError, "INCOMPLETE_RESPONSE");
+    BOOST_CHECK_EQUAL(response.sBody, "abc");
+    BOOST_CHECK(!DACHttpExecute(server.Request("chunk"), response));
+    BOOST_CHECK_EQUAL(response.sError, "INCOMPLETE_RESPONSE");
+    // The trailer section never ends
+    BOOST_CHECK(!DACHttpExecute(server.Request("trailer"), response));
+    BOOST_CHECK_EQUAL(response.sError, "INCOMPLETE_RESPONSE");
+    BOOST_CHECK_EQUAL(server.nAccepted, 3);
+}
+
+BOOST_AUTO_TEST_CASE(dachttp_connection_close)
+{
+    // The server keeps the first connection open, but it announced close, so it must not be reused
+    CannedHttpServer server({
+        {"HTTP/1.1 200 OK\r\nContent-Length: 2\r\nConnection: close\r\n\r\nok",
+         "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nreuse"},
+        {"HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nfresh"}});
+    DACHttpResponse response;
+    BOOST_CHECK(DACHttpExecute(server.Request("first"), response));
+    BOOST_CHECK_EQUAL(response.sBody, "ok");
+    BOOST_CHECK(DACHttpExecute(server.Request("second"), response));
+    BOOST_CHECK_EQUAL(response.sBody, "fresh");
+    BOOST_CHECK_EQUAL(server.nAccepted, 2);
+}
+
+BOOST_AUTO_TEST_CASE(dachttp_stale_pooled_connection)
+{
+    // The pooled connection looks idle but the server drops it on the next request; the request is retried on a new one
+    CannedHttpServer server({
+        {"HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nfirst", ""},
+        {"HTTP/1.1 200 OK\r\nContent-Length: 6\r\n\r\nsecond"}});
+    DACHttpResponse response;
+    BOOST_CHECK(DACHttpExecute(server.Request("first"), response));
+    BOOST_CHECK_EQUAL(response.sBody, "first");
+    BOOST_CHECK(DACHttpExecute(server.Request("second"), response));
+    BOOST_CHECK_EQUAL(response.sError, "");
+    BOOST_CHECK_EQUAL(response.sBody, "second");
+    BOOST_CHECK_EQUAL(server.nAccepted, 2);
+}
+
+// Stopping is permanent, so this runs last
+BOOST_AUTO_TEST_CASE(dachttp_shutdown)
+{
+    DACHttpRequest request;
+    request.fSSL = false;
+    request.sHost = "127.0.0.1";
+    request.iPort = 1;
+    StopDACHttpClient();
+    DACHttpResponse response;
+    BOOST_CHECK(!DACHttpExecute(request, response));
+    BOOST_CHECK_EQUAL(response.sError, "SHUTDOWN");
+    BOOST_CHECK_EQUAL(DACHttpQueue(request).get().sError, "SHUTDOWN");
+    StopDACHttpClient();
+    BOOST_CHECK_EQUAL(DACHttpQueue(request).get().sError, "SHUTDOWN");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -211,6 +211,27 @@ static CDeterministicMNCPtr FindPayoutDmn(const CBlock& block)
     return nullptr;
 }
 
+// CalculateQuorum as it was before it switched to a partial sort, as a reference for the selection and its order
+static std::vector<CDeterministicMNCPtr> CalculateQuorumLegacy(const CDeterministicMNList& mnList, size_t maxSize, const uint256& modifier)
+{
+    auto scores = mnList.CalculateScores(modifier);
+
+    // sort is descending order
+    std::sort(scores.rbegin(), scores.rend(), [](const std::pair<arith_uint256, CDeterministicMNCPtr>& a, const std::pair<arith_uint256, CDeterministicMNCPtr>& b) {
+        if (a.first == b.first) {
+            return a.second->collateralOutpoint < b.second->collateralOutpoint;
+        }
+        return a.first < b.first;
+    });
+
+    std::vector<CDeterministicMNCPtr> result;
+    result.resize(std::min(maxSize, scores.size()));
+    for (size_t i = 0; i < result.size(); i++) {
+        result[i] = std::move(scores[i].second);
+    }
+    return result;
+}
+
 BOOST_AUTO_TEST_SUITE(evo_dip3_activation_tests)
 
 BOOST_FIXTURE_TEST_CASE(dip3_activation, TestChainDIP3BeforeActivationSetup)
@@ -401,4 +422,49 @@ BOOST_FIXTURE_TEST_CASE(dip3_protx, TestChainDIP3Setup)
 
     const_cast<Consensus::Params&>(Params().GetConsensus()).DIP0003EnforcementHeight = DIP0003EnforcementHeightBackup;
 }
+
+BOOST_FIXTURE_TEST_CASE(dip3_quorum_order, BasicTestingSetup)
+{
+    // A fixed list of 12 MNs. MNs 4 to 7 share confirmedHashWithProRegTxHash, so they tie on every score and only the
+    // collateral tiebreak orders them; their collaterals descend while their proTxHashes ascend.
+    CDeterministicMNList mnList(uint256(), 0, 0);
+    std::vector<uint256> vTied;
+    for (int i = 0; i < 12; i++) {
+        auto dmn = std::make_shared<CDeterministicMN>();
+        dmn->proTxHash = ArithToUint256(arith_uint256(1000 + i));
+        dmn->internalId = i;
+        dmn->collateralOutpoint = COutPoint(ArithToUint256(arith_uint256(2000 - i)), i % 3);
+        dmn->nOperatorReward = 0;
+        auto state = std::make_shared<CDeterministicMNState>();
+        state->keyIDOwner = CKeyID(Hash160(dmn->proTxHash.begin(), dmn->proTxHash.end()));
+        state->UpdateConfirmedHash(dmn->proTxHash, ArithToUint256(arith_uint256(3000 + i)));
+        if (i >= 4 && i < 8) {
+            state->confirmedHashWithProRegTxHash = ArithToUint256(arith_uint256(4000));
+            vTied.emplace_back(dmn->proTxHash);
+        }
+        dmn->pdmnState = state;
+        mnList.AddMN(dmn);
+    }
+
+    for (int m = 0; m < 16; m++) {
+        uint256 modifier = ArithToUint256(arith_uint256(5000 + m));
+        for (size_t maxSize = 0; maxSize <= 13; maxSize++) {
+            auto quorum = mnList.CalculateQuorum(maxSize, modifier);
+            auto expected = CalculateQuorumLegacy(mnList, maxSize, modifier);
+            BOOST_CHECK_EQUAL(quorum.size(), std::min(maxSize, (size_t)12));
+            BOOST_REQUIRE_EQUAL(quorum.size(), expected.size());
+            for (size_t j = 0; j < quorum.size(); j++) {
+                BOOST_CHECK(quorum[j]->proTxHash == expected[j]->proTxHash);
+            }
+        }
+
+        // The tied MNs are adjacent, highest collateral first
+        auto quorum = mnList.CalculateQuorum(12, modifier);
+        auto it = std::find_if(quorum.begin(), quorum.end(), [&](const CDeterministicMNCPtr& dmn) { return dmn->proTxHash == vTied[0]; });
+        BOOST_REQUIRE(quorum.end() - it >= 4);
+        for (size_t j = 0; j < vTied.size(); j++) {
+            BOOST_CHECK(it[j]->proTxHash == vTied[j]);
+        }
+    }
+}
 BOOST_AUTO_TEST_SUITE_END()
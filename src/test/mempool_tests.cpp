@@ -2,6 +2,8 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "base58.h"
+#include "chainparams.h"
 #include "txmempool.h"
 #include "util.h"
 
@@ -580,4 +582,86 @@ BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
     SetMockTime(0);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolMessageTypeIndexTest)
+{
+    TestMemPoolEntryHelper entry;
+    CTxMemPool pool;
+
+    CMutableTransaction txPlain;
+    txPlain.vin.resize(1);
+    txPlain.vin[0].scriptSig = CScript() << OP_11;
+    txPlain.vout.resize(1);
+    txPlain.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    txPlain.vout[0].nValue = 10 * COIN;
+
+    CMutableTransaction txDWS = txPlain;
+    txDWS.vin[0].scriptSig = CScript() << OP_12;
+    txDWS.vout[0].sTxOutMessage = "<MT>DWS</MT><MK>key</MK><MV><dws><burnheight>1</burnheight></dws></MV>";
+
+    CMutableTransaction txGSC = txPlain;
+    txGSC.vin[0].scriptSig = CScript() << OP_13;
+    txGSC.vout[0].sTxOutMessage = "<MT>GSCTransmission</MT><gsccampaign>WCG</gsccampaign><MT>ABN</MT>";
+
+    pool.addUnchecked(txPlain.GetHash(), entry.FromTx(txPlain));
+    pool.addUnchecked(txDWS.GetHash(), entry.FromTx(txDWS));
+    pool.addUnchecked(txGSC.GetHash(), entry.FromTx(txGSC));
+
+    std::vector<CTransactionRef> vDWS = pool.getByMessageType(TXMESSAGE_DWS);
+    BOOST_CHECK_EQUAL(vDWS.size(), 1);
+    BOOST_CHECK(vDWS[0]->GetHash() == txDWS.GetHash());
+    // The pool hands out its own reference instead of a copy
+    BOOST_CHECK(vDWS[0] == pool.get(txDWS.GetHash()));
+    BOOST_CHECK_EQUAL(pool.getByMessageType(TXMESSAGE_GSC_TRANSMISSION).size(), 1);
+    BOOST_CHECK_EQUAL(pool.getByMessageType(TXMESSAGE_ABN).size(), 1);
+    BOOST_CHECK(pool.getByMessageType(TXMESSAGE_DASHSTAKE).empty());
+    BOOST_CHECK(pool.getByMessageType(TXMESSAGE_CPK).empty());
+
+    pool.removeRecursive(txDWS);
+    BOOST_CHECK(pool.getByMessageType(TXMESSAGE_DWS).empty());
+    BOOST_CHECK_EQUAL(pool.getByMessageType(TXMESSAGE_GSC_TRANSMISSION).size(), 1);
+
+    pool.clear();
+    BOOST_CHECK(pool.getByMessageType(TXMESSAGE_ABN).empty());
+}
+
+BOOST_AUTO_TEST_CASE(MempoolBurnIndexTest)
+{
+    TestMemPoolEntryHelper entry;
+    CTxMemPool pool;
+    CScript burnScript = GetScriptForDestination(CBitcoinAddress(Params().GetConsensus().BurnAddress).Get());
+
+    CMutableTransaction txPlain;
+    txPlain.vin.resize(1);
+    txPlain.vin[0].scriptSig = CScript() << OP_11;
+    txPlain.vout.resize(2);
+    txPlain.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    txPlain.vout[0].nValue = 10 * COIN;
+    txPlain.vout[1] = txPlain.vout[0];
+
+    // A stake is recognised by its burn output; the <MT> marker is optional
+    CMutableTransaction txBurn = txPlain;
+    txBurn.vin[0].scriptSig = CScript() << OP_12;
+    txBurn.vout[1].scriptPubKey = burnScript;
+    txBurn.vout[1].sTxOutMessage = "<dws><burnheight>1</burnheight></dws>";
+
+    // A marker without a burn output is not a stake
+    CMutableTransaction txMarker = txPlain;
+    txMarker.vin[0].scriptSig = CScript() << OP_13;
+    txMarker.vout[0].sTxOutMessage = "<MT>DWS</MT>";
+
+    pool.addUnchecked(txPlain.GetHash(), entry.FromTx(txPlain));
+    pool.addUnchecked(txBurn.GetHash(), entry.FromTx(txBurn));
+    pool.addUnchecked(txMarker.GetHash(), entry.FromTx(txMarker));
+
+    std::vector<CTransactionRef> vBurns = pool.getBurns();
+    BOOST_CHECK_EQUAL(vBurns.size(), 1);
+    BOOST_CHECK(vBurns[0] == pool.get(txBurn.GetHash()));
+
+    pool.removeRecursive(txBurn);
+    BOOST_CHECK(pool.getBurns().empty());
+    pool.addUnchecked(txBurn.GetHash(), entry.FromTx(txBurn));
+    pool.clear();
+    BOOST_CHECK(pool.getBurns().empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
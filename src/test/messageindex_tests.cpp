@@ -0,0 +1,95 @@
+// Copyright (c) 2014-2019 The Dash Core Developers, The DAC Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "messageindex.h"
+#include "txdb.h"
+
+#include "test/test_coin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(messageindex_tests, TestingSetup)
+
+typedef std::vector<std::pair<CMessageIndexKey, CMessageIndexValue> > MessageEntries;
+
+BOOST_AUTO_TEST_CASE(messageindex_write_read_erase)
+{
+    CBlockTreeDB db(1 << 20, true, true);
+
+    MessageEntries block10;
+    block10.push_back(std::make_pair(CMessageIndexKey("PRAYER", "P1", 10, 0), CMessageIndexValue("first", 100)));
+    block10.push_back(std::make_pair(CMessageIndexKey("DWS-BURN", "TX1", 10, 1), CMessageIndexValue("<dws/>", 100)));
+    BOOST_CHECK(db.WriteMessageIndex(10, block10));
+
+    MessageEntries block11;
+    block11.push_back(std::make_pair(CMessageIndexKey("PRAYER", "P1", 11, 0), CMessageIndexValue("second", 200)));
+    block11.push_back(std::make_pair(CMessageIndexKey("PRAYERX", "P1", 11, 1), CMessageIndexValue("other", 200)));
+    BOOST_CHECK(db.WriteMessageIndex(11, block11));
+
+    // Range queries by type and height
+    MessageEntries vect;
+    BOOST_CHECK(db.ReadMessageIndex("PRAYER", vect));
+    BOOST_CHECK_EQUAL(vect.size(), 2);
+    BOOST_CHECK_EQUAL(vect[0].second.value, "first");
+    BOOST_CHECK_EQUAL(vect[1].second.value, "second");
+    vect.clear();
+    BOOST_CHECK(db.ReadMessageIndex("PRAYER", vect, 11, 11));
+    BOOST_CHECK_EQUAL(vect.size(), 1);
+    BOOST_CHECK_EQUAL(vect[0].first.blockHeight, 11);
+
+    // Loading visits every entry with the latest height of each key last
+    std::map<std::pair<std::string, std::string>, std::string> mapLoaded;
+    int nLoaded = 0;
+    BOOST_CHECK(db.LoadMessageIndex([&](const CMessageIndexKey& key, const CMessageIndexValue& value) {
+        mapLoaded[std::make_pair(key.type, key.key)] = value.value;
+        nLoaded++;
+    }));
+    BOOST_CHECK_EQUAL(nLoaded, 4);
+    BOOST_CHECK_EQUAL(mapLoaded[std::make_pair(std::string("PRAYER"), std::string("P1"))], "second");
+
+    // Disconnecting height 11 removes exactly its entries
+    std::vector<CMessageIndexKey> vErased;
+    BOOST_CHECK(db.EraseMessageIndex(11, vErased));
+    BOOST_CHECK_EQUAL(vErased.size(), 2);
+    vect.clear();
+    BOOST_CHECK(db.ReadMessageIndex("PRAYER", "P1", vect));
+    BOOST_CHECK_EQUAL(vect.size(), 1);
+    BOOST_CHECK_EQUAL(vect.back().second.value, "first");
+    vect.clear();
+    BOOST_CHECK(db.ReadMessageIndex("PRAYERX", vect));
+    BOOST_CHECK(vect.empty());
+
+    // Erasing a height with no entries is a no-op
+    BOOST_CHECK(db.EraseMessageIndex(12, vErased));
+    BOOST_CHECK(vErased.empty());
+}
+
+BOOST_AUTO_TEST_CASE(messageindex_rewrite_height)
+{
+    CBlockTreeDB db(1 << 20, true, true);
+
+    MessageEntries first;
+    first.push_back(std::make_pair(CMessageIndexKey("PRAYER", "P1", 20, 0), CMessageIndexValue("old", 100)));
+    first.push_back(std::make_pair(CMessageIndexKey("PRAYER", "P2", 20, 1), CMessageIndexValue("gone", 100)));
+    BOOST_CHECK(db.WriteMessageIndex(20, first));
+
+    // Writing the height again replaces its entries instead of adding to them
+    MessageEntries second;
+    second.push_back(std::make_pair(CMessageIndexKey("PRAYER", "P1", 20, 0), CMessageIndexValue("new", 200)));
+    BOOST_CHECK(db.WriteMessageIndex(20, second));
+
+    MessageEntries vect;
+    BOOST_CHECK(db.ReadMessageIndex("PRAYER", vect));
+    BOOST_CHECK_EQUAL(vect.size(), 1);
+    BOOST_CHECK_EQUAL(vect[0].second.value, "new");
+
+    std::vector<CMessageIndexKey> vErased;
+    BOOST_CHECK(db.EraseMessageIndex(20, vErased));
+    BOOST_CHECK_EQUAL(vErased.size(), 1);
+    vect.clear();
+    BOOST_CHECK(db.ReadMessageIndex("PRAYER", vect));
+    BOOST_CHECK(vect.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
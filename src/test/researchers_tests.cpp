@@ -0,0 +1,82 @@
+// Copyright (c) 2014-2019 The Dash Core Developers, The DAC Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "rpcpog.h"
+
+#include "test/test_coin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(researchers_tests, BasicTestingSetup)
+
+/** The loader this parser replaced: Split on </user>, then ExtractXML every field from its record */
+static int ParseResearchersReference(const std::string& sData, std::map<std::string, Researcher>& mapResearchers)
+{
+    std::vector<std::string> vResearchers = Split(sData, "</user>");
+    for (const std::string& sUser : vResearchers) {
+        Researcher r;
+        r.nickname = ExtractXML(sUser, "<name>", "</name>");
+        r.teamid = cdbl(ExtractXML(sUser, "<teamid>", "</teamid>"), 0);
+        r.cpid = ExtractXML(sUser, "<cpid>", "</cpid>");
+        r.country = ExtractXML(sUser, "<country>", "</country>");
+        r.creationtime = cdbl(ExtractXML(sUser, "<create_time>", "</create_time>"), 0);
+        r.totalcredit = cdbl(ExtractXML(sUser, "<total_credit>", "</total_credit>"), 2);
+        r.wcgpoints = r.totalcredit * 7;
+        r.rac = cdbl(ExtractXML(sUser, "<expavg_credit>", "</expavg_credit>"), 10);
+        r.id = cdbl(ExtractXML(sUser, "<id>", "</id>"), 0);
+        if (r.id > 0 && r.cpid.length() == 32) {
+            r.found = true;
+            mapResearchers[r.cpid] = r;
+        }
+    }
+    return vResearchers.size();
+}
+
+static void CheckSameResearchers(const std::string& sData)
+{
+    std::map<std::string, Researcher> mapParsed, mapReference;
+    BOOST_CHECK_EQUAL(ParseResearchers(sData, mapParsed), ParseResearchersReference(sData, mapReference));
+    BOOST_REQUIRE_EQUAL(mapParsed.size(), mapReference.size());
+    for (const auto& r : mapReference) {
+        const Researcher& p = mapParsed[r.first];
+        BOOST_CHECK_EQUAL(p.nickname, r.second.nickname);
+        BOOST_CHECK_EQUAL(p.teamid, r.second.teamid);
+        BOOST_CHECK_EQUAL(p.country, r.second.country);
+        BOOST_CHECK_EQUAL(p.creationtime, r.second.creationtime);
+        BOOST_CHECK_EQUAL(p.totalcredit, r.second.totalcredit);
+        BOOST_CHECK_EQUAL(p.rac, r.second.rac);
+        BOOST_CHECK_EQUAL(p.id, r.second.id);
+        BOOST_CHECK(p.found);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(researchers_parse)
+{
+    std::string sCPID1(32, 'a');
+    std::string sCPID2(32, 'b');
+    std::string sData = "<boinchash>123</boinchash><users>"
+        "<user><id>7</id><name>Alice</name><country>Kenya</country><create_time>1500000000</create_time>"
+        "<total_credit>1234.56</total_credit><expavg_credit>99.5</expavg_credit><teamid>35006</teamid><cpid>" + sCPID1 + "</cpid></user>\r\n"
+        "<user><id>8</id><name>Bob<id>3</id></name><teamid>30513</teamid><cpid>" + sCPID2 + "</cpid><name>Ignored</name></user>\r\n"
+        "<user><id>0</id><cpid>" + std::string(32, 'c') + "</cpid></user>\r\n"
+        "<user><id>9</id><cpid>short</cpid></user>\r\n"
+        "<user><id>10</id><name>Unclosed</user><cpid>" + std::string(32, 'd') + "</cpid></name></users>";
+
+    std::map<std::string, Researcher> mapResearchers;
+    BOOST_CHECK_EQUAL(ParseResearchers(sData, mapResearchers), 6);
+    BOOST_CHECK_EQUAL(mapResearchers.size(), 2);
+    BOOST_CHECK_EQUAL(mapResearchers[sCPID1].nickname, "Alice");
+    BOOST_CHECK_EQUAL(mapResearchers[sCPID1].teamid, 35006);
+    BOOST_CHECK_EQUAL(mapResearchers[sCPID1].id, 7);
+    BOOST_CHECK_EQUAL(mapResearchers[sCPID2].nickname, "Bob<id>3</id>");
+    BOOST_CHECK_EQUAL(mapResearchers[sCPID2].id, 8);
+
+    CheckSameResearchers(sData);
+    CheckSameResearchers("");
+    CheckSameResearchers("</user></user>");
+    CheckSameResearchers("<id>5</id><cpid>" + sCPID1 + "</cpid>");
+    CheckSameResearchers("<id>5</user></id><cpid>" + sCPID1 + "</cpid>");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
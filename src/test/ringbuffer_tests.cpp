@@ -0,0 +1,81 @@
+// Copyright (c) 2014-2019 The Dash Core Developers, The DAC Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "ringbuffer.h"
+
+#include "test/test_coin.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(ringbuffer_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(ringbuffer_fifo)
+{
+    CLockFreeRingBuffer<std::string> buffer(5);
+    BOOST_CHECK_EQUAL(buffer.Capacity(), 8U);
+
+    std::string s;
+    BOOST_CHECK(!buffer.TryPop(s));
+
+    // Fill it, wrap around a few times and check the order
+    int nNext = 0;
+    int nExpected = 0;
+    for (int nRound = 0; nRound < 3; nRound++) {
+        while (buffer.TryPush(std::to_string(nNext)))
+            nNext++;
+        BOOST_CHECK_EQUAL(buffer.SizeApprox(), 8U);
+        for (int i = 0; i < 5; i++) {
+            BOOST_CHECK(buffer.TryPop(s));
+            BOOST_CHECK_EQUAL(s, std::to_string(nExpected++));
+        }
+    }
+    while (buffer.TryPop(s))
+        BOOST_CHECK_EQUAL(s, std::to_string(nExpected++));
+    BOOST_CHECK_EQUAL(nExpected, nNext);
+    BOOST_CHECK_EQUAL(buffer.SizeApprox(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(ringbuffer_producers)
+{
+    // Several producers against one consumer: nothing is lost, and each producer's values stay in order
+    const int nProducers = 4;
+    const int nPerProducer = 20000;
+    CLockFreeRingBuffer<std::pair<int, int>> buffer(64);
+    std::vector<std::thread> vThreads;
+    for (int p = 0; p < nProducers; p++) {
+        vThreads.emplace_back([&buffer, p, nPerProducer] {
+            for (int i = 0; i < nPerProducer; i++) {
+                while (!buffer.TryPush(std::make_pair(p, i)))
+                    std::this_thread::yield();
+            }
+        });
+    }
+
+    std::vector<int> vNext(nProducers, 0);
+    bool fOrdered = true;
+    int nReceived = 0;
+    std::pair<int, int> value;
+    while (nReceived < nProducers * nPerProducer) {
+        if (!buffer.TryPop(value)) {
+            std::this_thread::yield();
+            continue;
+        }
+        fOrdered &= value.second == vNext[value.first];
+        vNext[value.first] = value.second + 1;
+        nReceived++;
+    }
+    for (auto& t : vThreads)
+        t.join();
+
+    BOOST_CHECK(fOrdered);
+    BOOST_CHECK(!buffer.TryPop(value));
+    for (int p = 0; p < nProducers; p++)
+        BOOST_CHECK_EQUAL(vNext[p], nPerProducer);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
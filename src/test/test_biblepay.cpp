@@ -189,7 +189,7 @@ CBlock TestChainSetup::CreateBlock(const std::vector<CMutableTransaction>& txns,
     unsigned int extraNonce = 0;
     IncrementExtraNonce(&block, chainActive.Tip(), extraNonce);
 
-    while (!CheckProofOfWork(block.GetHash(), block.nBits, chainparams.GetConsensus(), 0, 0, 0, 0, NULL, false)) ++block.nNonce;
+    while (!CheckProofOfWork(block, block.GetHash(), chainparams.GetConsensus(), 0, 0, 0, 0, false)) ++block.nNonce;
 
     CBlock result = block;
     return result;
@@ -403,4 +403,37 @@ BOOST_AUTO_TEST_CASE(test_IsStandard)
     BOOST_CHECK(!IsStandardTx(t, reason));
 }
 
+BOOST_AUTO_TEST_CASE(tx_message_parse)
+{
+    CMutableTransaction t;
+    t.vout.resize(2);
+    t.vout[0].sTxOutMessage = "<MT>GSCTransmission</MT><abnmsg><ppk>XYZ</ppk></abnmsg><gsccampaign>WCG";
+    t.vout[1].sTxOutMessage = "</gsccampaign><diary>first</diary><diary>second</diary><open>";
+    CTransaction tx(t);
+
+    const std::string& sMsg = tx.GetTxMessage();
+    BOOST_CHECK_EQUAL(sMsg, t.vout[0].sTxOutMessage + t.vout[1].sTxOutMessage);
+    BOOST_CHECK(&tx.GetParsedTxMessage() == &tx.GetParsedTxMessage());
+
+    // Tags resolve exactly as ExtractXMLValue would, across vout boundaries and for nested tags
+    const char* tags[] = {"MT", "abnmsg", "ppk", "gsccampaign", "diary", "open", "missing"};
+    for (const char* tag : tags) {
+        std::string sTag(tag);
+        BOOST_CHECK_EQUAL(tx.GetParsedTxMessage().GetTag(sTag), ExtractXMLValue(sMsg, "<" + sTag + ">", "</" + sTag + ">"));
+    }
+    BOOST_CHECK_EQUAL(tx.GetParsedTxMessage().GetTag("diary"), "first");
+    BOOST_CHECK_EQUAL(tx.GetCampaignName(), "WCG");
+
+    BOOST_CHECK(tx.IsGSCTransmission());
+    BOOST_CHECK(!tx.IsABN());
+    BOOST_CHECK(!tx.IsCPKAssociation());
+    BOOST_CHECK(!tx.IsWhaleStake());
+    BOOST_CHECK(!tx.IsDashStake());
+
+    t.vout[1].sTxOutMessage = "<MT>ABN</MT>";
+    CTransaction txABN(t);
+    BOOST_CHECK(txABN.IsABN());
+    BOOST_CHECK(txABN.IsGSCTransmission());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
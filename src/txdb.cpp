@@ -25,7 +25,10 @@ static const char DB_ADDRESSINDEX = 'a';
 static const char DB_ADDRESSUNSPENTINDEX = 'u';
 static const char DB_TIMESTAMPINDEX = 's';
 static const char DB_SPENTINDEX = 'p';
+static const char DB_MESSAGEINDEX = 'M';
+static const char DB_MESSAGEINDEX_HEIGHT = 'm';
 static const char DB_BLOCK_INDEX = 'b';
+static const char DB_RANDOMX_POW = 'X';
 
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_FLAG = 'F';
@@ -109,6 +112,10 @@ size_t CCoinsViewDB::EstimateSize() const
 CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe) {
 }
 
+bool CBlockTreeDB::ReadRandomXPoWRecord(const uint256& hashBlock, CRandomXPoWRecord& record) {
+    return Read(std::make_pair(DB_RANDOMX_POW, hashBlock), record);
+}
+
 bool CBlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo &info) {
     return Read(std::make_pair(DB_BLOCK_FILES, nFile), info);
 }
@@ -191,6 +198,17 @@ bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockF
     batch.Write(DB_LAST_BLOCK, nLastFile);
     for (std::vector<const CBlockIndex*>::const_iterator it=blockinfo.begin(); it != blockinfo.end(); it++) {
         batch.Write(std::make_pair(DB_BLOCK_INDEX, (*it)->GetBlockHash()), CDiskBlockIndex(*it));
+        // A verified RandomX result is kept as long as the header is valid; pruning the block data does not touch it
+        if ((*it)->nStatus & BLOCK_FAILED_MASK) {
+            batch.Erase(std::make_pair(DB_RANDOMX_POW, (*it)->GetBlockHash()));
+            ForgetRandomXPoWRecord((*it)->GetBlockHash());
+        }
+    }
+    // Every result computed since the last flush, whether or not the LRU still holds it (failed headers are left out)
+    std::vector<std::pair<uint256, CRandomXPoWRecord>> vRandomXPoW;
+    TakeRandomXPoWRecordsToFlush(vRandomXPoW);
+    for (const auto& rxpow : vRandomXPoW) {
+        batch.Write(std::make_pair(DB_RANDOMX_POW, rxpow.first), rxpow.second);
     }
     return WriteBatch(batch, true);
 }
@@ -338,6 +356,119 @@ bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned i
     return true;
 }
 
+bool CBlockTreeDB::WriteMessageIndex(int nHeight, const std::vector<std::pair<CMessageIndexKey, CMessageIndexValue> > &vect) {
+    CDBBatch batch(*this);
+    // Drop whatever an earlier write left at this height, so a rewrite does not leave orphaned entries behind
+    std::vector<CMessageIndexKey> vOldKeys;
+    if (Read(std::make_pair(DB_MESSAGEINDEX_HEIGHT, nHeight), vOldKeys)) {
+        for (std::vector<CMessageIndexKey>::const_iterator it=vOldKeys.begin(); it!=vOldKeys.end(); it++)
+            batch.Erase(std::make_pair(DB_MESSAGEINDEX, *it));
+    }
+    // The keys written at each height are kept so that DisconnectBlock can erase exactly those
+    std::vector<CMessageIndexKey> vKeys;
+    vKeys.reserve(vect.size());
+    for (std::vector<std::pair<CMessageIndexKey, CMessageIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+        batch.Write(std::make_pair(DB_MESSAGEINDEX, it->first), it->second);
+        vKeys.push_back(it->first);
+    }
+    if (vKeys.empty())
+        batch.Erase(std::make_pair(DB_MESSAGEINDEX_HEIGHT, nHeight));
+    else
+        batch.Write(std::make_pair(DB_MESSAGEINDEX_HEIGHT, nHeight), vKeys);
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::EraseMessageIndex(int nHeight, std::vector<CMessageIndexKey> &vErased) {
+    vErased.clear();
+    if (!Read(std::make_pair(DB_MESSAGEINDEX_HEIGHT, nHeight), vErased))
+        return true;
+    CDBBatch batch(*this);
+    for (std::vector<CMessageIndexKey>::const_iterator it=vErased.begin(); it!=vErased.end(); it++)
+        batch.Erase(std::make_pair(DB_MESSAGEINDEX, *it));
+    batch.Erase(std::make_pair(DB_MESSAGEINDEX_HEIGHT, nHeight));
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadMessageIndex(const std::string &type, std::vector<std::pair<CMessageIndexKey, CMessageIndexValue> > &vect,
+                                    int start, int end) {
+
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(std::make_pair(DB_MESSAGEINDEX, CMessageIndexIteratorKey(type)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char,CMessageIndexKey> key;
+        if (pcursor->GetKey(key) && key.first == DB_MESSAGEINDEX && key.second.type == type) {
+            if ((start > 0 && key.second.blockHeight < start) || (end > 0 && key.second.blockHeight > end)) {
+                pcursor->Next();
+                continue;
+            }
+            CMessageIndexValue value;
+            if (pcursor->GetValue(value)) {
+                vect.push_back(std::make_pair(key.second, value));
+                pcursor->Next();
+            } else {
+                return error("failed to get message index value");
+            }
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool CBlockTreeDB::ReadMessageIndex(const std::string &type, const std::string &key, std::vector<std::pair<CMessageIndexKey, CMessageIndexValue> > &vect) {
+
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(std::make_pair(DB_MESSAGEINDEX, CMessageIndexKey(type, key, 0, 0)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char,CMessageIndexKey> dbKey;
+        if (pcursor->GetKey(dbKey) && dbKey.first == DB_MESSAGEINDEX && dbKey.second.type == type && dbKey.second.key == key) {
+            CMessageIndexValue value;
+            if (pcursor->GetValue(value)) {
+                vect.push_back(std::make_pair(dbKey.second, value));
+                pcursor->Next();
+            } else {
+                return error("failed to get message index value");
+            }
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool CBlockTreeDB::LoadMessageIndex(boost::function<void(const CMessageIndexKey&, const CMessageIndexValue&)> apply) {
+
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(DB_MESSAGEINDEX);
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char,CMessageIndexKey> key;
+        if (pcursor->GetKey(key) && key.first == DB_MESSAGEINDEX) {
+            CMessageIndexValue value;
+            if (pcursor->GetValue(value)) {
+                apply(key.second, value);
+                pcursor->Next();
+            } else {
+                return error("failed to get message index value");
+            }
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
 bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue) {
     return Write(std::make_pair(DB_FLAG, name), fValue ? '1' : '0');
 }
@@ -388,11 +519,10 @@ bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256
 
 				if (pindexNew->pprev && (diskindex.nHeight > nCheckpointHeight || diskindex.nHeight % 10 == 0))
 				{
-					if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits, Params().GetConsensus(), 
+					if (!CheckProofOfWork(pindexNew->GetBlockHeader(), pindexNew->GetBlockHash(), Params().GetConsensus(), 
 						pindexNew->nTime,
 						pindexNew->pprev->nTime,
-						pindexNew->pprev->nHeight, pindexNew->nNonce, 
-						pindexNew->pprev, pindexNew->RandomXData, pindexNew->RandomXKey, 0, true))
+						pindexNew->pprev->nHeight, 0, true))
 						return error("LoadBlockIndex(): CheckProofOfWork failed: %s", pindexNew->ToString());
 				}
                 pcursor->Next();
@@ -10,6 +10,7 @@
 #include "dbwrapper.h"
 #include "chain.h"
 #include "spentindex.h"
+#include "messageindex.h"
 
 #include <map>
 #include <string>
@@ -108,7 +109,10 @@ private:
     friend class CCoinsViewDB;
 };
 
+struct CRandomXPoWRecord;
+
 /** Access to the block database (blocks/index/) */
+
 class CBlockTreeDB : public CDBWrapper
 {
 public:
@@ -119,6 +123,7 @@ private:
 public:
     bool WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo);
     bool ReadBlockFileInfo(int nFile, CBlockFileInfo &fileinfo);
+    bool ReadRandomXPoWRecord(const uint256& hashBlock, CRandomXPoWRecord& record);
     bool ReadLastBlockFile(int &nFile);
     bool WriteReindexing(bool fReindex);
     bool ReadReindexing(bool &fReindex);
@@ -137,6 +142,12 @@ public:
                           int start = 0, int end = 0);
     bool WriteTimestampIndex(const CTimestampIndexKey &timestampIndex);
     bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, std::vector<uint256> &vect);
+    bool WriteMessageIndex(int nHeight, const std::vector<std::pair<CMessageIndexKey, CMessageIndexValue> > &vect);
+    bool EraseMessageIndex(int nHeight, std::vector<CMessageIndexKey> &vErased);
+    bool ReadMessageIndex(const std::string &type, std::vector<std::pair<CMessageIndexKey, CMessageIndexValue> > &vect,
+                          int start = 0, int end = 0);
+    bool ReadMessageIndex(const std::string &type, const std::string &key, std::vector<std::pair<CMessageIndexKey, CMessageIndexValue> > &vect);
+    bool LoadMessageIndex(boost::function<void(const CMessageIndexKey&, const CMessageIndexValue&)> apply);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
     bool LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex);
@@ -5,6 +5,8 @@
 
 #include "txmempool.h"
 
+#include "base58.h"
+#include "chainparams.h"
 #include "clientversion.h"
 #include "consensus/consensus.h"
 #include "consensus/validation.h"
@@ -26,6 +28,23 @@
 
 #include "llmq/quorums_instantsend.h"
 
+/** BiblePay message types indexed by the pool */
+static const TxMessageType INDEXED_TXMESSAGE_TYPES[] = {
+    TXMESSAGE_GSC_TRANSMISSION, TXMESSAGE_CPK, TXMESSAGE_DWS, TXMESSAGE_DASHSTAKE, TXMESSAGE_ABN
+};
+
+/** The test ParseWhaleStake and ParseDashStake use to find a stake: an output whose address is the burn address */
+static bool IsBurnTx(const CTransaction& tx)
+{
+    CTxDestination burnDest = CBitcoinAddress(Params().GetConsensus().BurnAddress).Get();
+    for (const CTxOut& txout : tx.vout) {
+        CTxDestination dest;
+        if (ExtractDestination(txout.scriptPubKey, dest) && dest == burnDest)
+            return true;
+    }
+    return false;
+}
+
 CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFee,
                                  int64_t _nTime, unsigned int _entryHeight,
                                  bool _spendsCoinbase, unsigned int _sigOps, LockPoints lp):
@@ -428,6 +447,14 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
     vTxHashes.emplace_back(hash, newit);
     newit->vTxHashesIdx = vTxHashes.size() - 1;
 
+    const CTxMessage& txMessage = tx.GetParsedTxMessage();
+    for (TxMessageType type : INDEXED_TXMESSAGE_TYPES) {
+        if (txMessage.IsType(type))
+            mapTxMessageTypes[type].insert(hash);
+    }
+    if (IsBurnTx(tx))
+        setBurnTxs.insert(hash);
+
     // Invalid ProTxes should never get this far because transactions should be
     // fully checked by AcceptToMemoryPool() at this point, so we just assume that
     // everything is fine here.
@@ -650,6 +677,19 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
     } else
         vTxHashes.clear();
 
+    const CTxMessage& txMessage = it->GetTx().GetParsedTxMessage();
+    for (TxMessageType type : INDEXED_TXMESSAGE_TYPES) {
+        if (!txMessage.IsType(type))
+            continue;
+        auto itType = mapTxMessageTypes.find(type);
+        if (itType == mapTxMessageTypes.end())
+            continue;
+        itType->second.erase(hash);
+        if (itType->second.empty())
+            mapTxMessageTypes.erase(itType);
+    }
+    setBurnTxs.erase(hash);
+
     auto eraseProTxRef = [&](const uint256& proTxHash, const uint256& txHash) {
         auto its = mapProTxRefs.equal_range(proTxHash);
         for (auto it = its.first; it != its.second;) {
@@ -1006,6 +1046,8 @@ void CTxMemPool::_clear()
     mapNextTx.clear();
     mapProTxAddresses.clear();
     mapProTxPubKeyIDs.clear();
+    mapTxMessageTypes.clear();
+    setBurnTxs.clear();
     totalTxSize = 0;
     cachedInnerUsage = 0;
     lastRollingFeeUpdate = GetTime();
@@ -1234,6 +1276,35 @@ CTransactionRef CTxMemPool::get(const uint256& hash) const
     return i->GetSharedTx();
 }
 
+std::vector<CTransactionRef> CTxMemPool::getByMessageType(TxMessageType type) const
+{
+    LOCK(cs);
+    std::vector<CTransactionRef> vtx;
+    auto itType = mapTxMessageTypes.find(type);
+    if (itType == mapTxMessageTypes.end())
+        return vtx;
+    vtx.reserve(itType->second.size());
+    for (const uint256& hash : itType->second) {
+        indexed_transaction_set::const_iterator i = mapTx.find(hash);
+        if (i != mapTx.end())
+            vtx.push_back(i->GetSharedTx());
+    }
+    return vtx;
+}
+
+std::vector<CTransactionRef> CTxMemPool::getBurns() const
+{
+    LOCK(cs);
+    std::vector<CTransactionRef> vtx;
+    vtx.reserve(setBurnTxs.size());
+    for (const uint256& hash : setBurnTxs) {
+        indexed_transaction_set::const_iterator i = mapTx.find(hash);
+        if (i != mapTx.end())
+            vtx.push_back(i->GetSharedTx());
+    }
+    return vtx;
+}
+
 TxMempoolInfo CTxMemPool::info(const uint256& hash) const
 {
     LOCK(cs);
@@ -522,6 +522,9 @@ private:
     std::map<uint256, uint256> mapProTxBlsPubKeyHashes;
     std::map<COutPoint, uint256> mapProTxCollaterals;
 
+    std::map<int, std::set<uint256> > mapTxMessageTypes; // TXMESSAGE_* type -> transactions carrying a BiblePay message of that type
+    std::set<uint256> setBurnTxs; // transactions with an output to the consensus burn address (DWS and DASH stakes)
+
     void UpdateParent(txiter entry, txiter parent, bool add);
     void UpdateChild(txiter entry, txiter child, bool add);
 
@@ -674,6 +677,11 @@ public:
     }
 
     CTransactionRef get(const uint256& hash) const;
+    /** Transactions carrying a BiblePay message of the given type (GSC transmission, CPK, DWS, DASH stake or ABN) */
+    std::vector<CTransactionRef> getByMessageType(TxMessageType type) const;
+    /** Transactions paying the consensus burn address, whether or not they carry a <MT> marker; the stake lookups
+     *  recognise a DWS or DASH stake by that output, so this is what they must see */
+    std::vector<CTransactionRef> getBurns() const;
     TxMempoolInfo info(const uint256& hash) const;
     std::vector<TxMempoolInfo> infoAll() const;
 
@@ -15,6 +15,7 @@
 #include "chainparamsbase.h"
 #include "ctpl.h"
 #include "random.h"
+#include "ringbuffer.h"
 #include "serialize.h"
 #include "stacktraces.h"
 #include "sync.h"
@@ -229,6 +230,23 @@ static FILE* fileout = NULL;
 static boost::mutex* mutexDebugLog = NULL;
 static std::list<std::string>* vMsgsBeforeOpenLog;
 static std::atomic<int> logAcceptCategoryCacheCounter(0);
+// The last line written to debug.log, to skip repeats (guarded by mutexDebugLog)
+static std::string strLastDebugLogLine;
+
+/**
+ * Asynchronous debug.log writer.  While it runs, LogPrintStr only pushes the finished line into debugLogBuffer,
+ * without taking mutexDebugLog or making a syscall; the writer thread appends the queued lines to the file in one
+ * write every -logflushinterval milliseconds, or as soon as the buffer is half full.  A line that finds the buffer full
+ * is written by its own thread, after the lines queued before it, so nothing is dropped.
+ */
+static const size_t DEBUG_LOG_BUFFER_LINES = 16384;
+static CLockFreeRingBuffer<std::string>* debugLogBuffer = NULL;
+static std::atomic<bool> fDebugLogAsync(false);
+static std::mutex csDebugLogWriter;
+static std::condition_variable condDebugLogWriter;
+static std::thread threadDebugLogWriter;
+static bool fDebugLogWriterStopping = false;
+static int64_t nDebugLogFlushInterval = DEFAULT_LOGFLUSHINTERVAL;
 
 
 
@@ -242,6 +260,7 @@ static void DebugPrintInit()
     assert(mutexDebugLog == NULL);
     mutexDebugLog = new boost::mutex();
     vMsgsBeforeOpenLog = new std::list<std::string>;
+    debugLogBuffer = new CLockFreeRingBuffer<std::string>(DEBUG_LOG_BUFFER_LINES);
 }
 
 bool Contains2(std::string data, std::string instring)
@@ -321,6 +340,97 @@ void OpenDebugLog()
     vMsgsBeforeOpenLog = NULL;
 }
 
+// The functions below are called with mutexDebugLog held and the log open
+static void ReopenDebugLogIfRequested()
+{
+    if (fReopenDebugLog) {
+        fReopenDebugLog = false;
+        boost::filesystem::path pathDebug = GetDataDir() / "debug.log";
+        if (freopen(pathDebug.string().c_str(),"a",fileout) != NULL)
+            setbuf(fileout, NULL); // unbuffered
+    }
+}
+
+static void AppendDebugLogLine(std::string& strBatch, const std::string& str)
+{
+    if (str == strLastDebugLogLine)
+        return;
+    strLastDebugLogLine = str;
+    strBatch += str;
+}
+
+static void DrainDebugLogBuffer()
+{
+    ReopenDebugLogIfRequested();
+    // At most one buffer's worth per call, so that busy producers cannot keep the drain going forever
+    std::string strBatch;
+    std::string str;
+    for (size_t i = 0; i < debugLogBuffer->Capacity() && debugLogBuffer->TryPop(str); i++)
+        AppendDebugLogLine(strBatch, str);
+    if (!strBatch.empty())
+        FileWriteStr(strBatch, fileout);
+}
+
+void FlushDebugLog(bool fTry)
+{
+    if (mutexDebugLog == NULL)
+        return;
+    boost::unique_lock<boost::mutex> lock(*mutexDebugLog, boost::defer_lock);
+    if (fTry) {
+        // A crashing thread may hold the lock forever: give up after a short while rather than hang
+        for (int i = 0; i < 10 && !lock.try_lock(); i++)
+            MilliSleep(10);
+        if (!lock.owns_lock())
+            return;
+    } else {
+        lock.lock();
+    }
+    if (fileout != NULL)
+        DrainDebugLogBuffer();
+}
+
+static void ThreadDebugLogWriter()
+{
+    std::unique_lock<std::mutex> lock(csDebugLogWriter);
+    while (!fDebugLogWriterStopping) {
+        condDebugLogWriter.wait_for(lock, std::chrono::milliseconds(nDebugLogFlushInterval));
+        lock.unlock();
+        FlushDebugLog();
+        lock.lock();
+    }
+}
+
+void StartDebugLogWriter(int64_t nFlushIntervalMillis)
+{
+    if (nFlushIntervalMillis <= 0 || fPrintToConsole || !fPrintToDebugLog || fDebugLogAsync)
+        return;
+    {
+        boost::call_once(&DebugPrintInit, debugPrintInitFlag);
+        boost::mutex::scoped_lock scoped_lock(*mutexDebugLog);
+        if (fileout == NULL)
+            return;
+    }
+    nDebugLogFlushInterval = nFlushIntervalMillis;
+    fDebugLogWriterStopping = false;
+    fDebugLogAsync = true;
+    threadDebugLogWriter = std::thread(&TraceThread<void (*)()>, "debuglog", &ThreadDebugLogWriter);
+}
+
+void StopDebugLogWriter()
+{
+    if (!fDebugLogAsync)
+        return;
+    fDebugLogAsync = false;
+    {
+        std::unique_lock<std::mutex> lock(csDebugLogWriter);
+        fDebugLogWriterStopping = true;
+    }
+    condDebugLogWriter.notify_all();
+    if (threadDebugLogWriter.joinable())
+        threadDebugLogWriter.join();
+    FlushDebugLog();
+}
+
 bool LogAcceptCategory(const char* category)
 {
     if (category != NULL)
@@ -461,6 +571,19 @@ int LogPrintStr(const std::string &str)
     else if (fPrintToDebugLog)
     {
         boost::call_once(&DebugPrintInit, debugPrintInitFlag);
+
+        if (fDebugLogAsync)
+        {
+            ret = strTimestamped.length();
+            if (debugLogBuffer->TryPush(std::move(strTimestamped)))
+            {
+                if (debugLogBuffer->SizeApprox() >= debugLogBuffer->Capacity() / 2)
+                    condDebugLogWriter.notify_one();
+                return ret;
+            }
+            // the buffer is full: write it out ourselves (strTimestamped is only moved from on success)
+        }
+
         boost::mutex::scoped_lock scoped_lock(*mutexDebugLog);
 
         // buffer if we haven't opened the log yet
@@ -471,19 +594,12 @@ int LogPrintStr(const std::string &str)
         }
         else
         {
-            // reopen the log file, if requested
-            if (fReopenDebugLog) {
-                fReopenDebugLog = false;
-                boost::filesystem::path pathDebug = GetDataDir() / "debug.log";
-                if (freopen(pathDebug.string().c_str(),"a",fileout) != NULL)
-                    setbuf(fileout, NULL); // unbuffered
+            // lines still queued by the asynchronous writer go first
+            DrainDebugLogBuffer();
+            if (strTimestamped != strLastDebugLogLine) {
+                strLastDebugLogLine = strTimestamped;
+                ret = FileWriteStr(strTimestamped, fileout);
             }
-			static std::string strLastWritten;
-			bool fSame = (strTimestamped == strLastWritten);
-
-			strLastWritten = strTimestamped;
-			if (!fSame)
-				ret = FileWriteStr(strTimestamped, fileout);
         }
     }
     return ret;
@@ -64,6 +64,7 @@ static const bool DEFAULT_LOGTIMEMICROS  = false;
 static const bool DEFAULT_LOGIPS         = false;
 static const bool DEFAULT_LOGTIMESTAMPS  = true;
 static const bool DEFAULT_LOGTHREADNAMES = false;
+static const int64_t DEFAULT_LOGFLUSHINTERVAL = 250; // milliseconds
 std::string GetConfFileName();
 std::string GetLcaseCoinName();
 std::string GetLcaseTicker();
@@ -113,6 +114,12 @@ bool LogAcceptCategory(const char* category);
 void ResetLogAcceptCategoryCache();
 /** Send a string to the log output */
 int LogPrintStr(const std::string &str);
+/** Write debug.log from a background thread, flushing every nFlushIntervalMillis (no-op if 0 or the log is not open) */
+void StartDebugLogWriter(int64_t nFlushIntervalMillis);
+/** Write out the queued lines and go back to writing every line as it is logged */
+void StopDebugLogWriter();
+/** Write out the queued debug.log lines now.  With fTry (crash handlers) it gives up if the log stays locked */
+void FlushDebugLog(bool fTry = false);
 
 /** Formats a string without throwing exceptions. Instead, it'll return an error string instead of formatted string. */
 template<typename... Args>
@@ -7,15 +7,18 @@
 #include "validation.h"
 
 #include "alert.h"
+#include "appcache.h"
 #include "arith_uint256.h"
 #include "blockencodings.h"
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "checkqueue.h"
+#include "ctpl.h"
 #include "consensus/consensus.h"
 #include "consensus/merkle.h"
 #include "consensus/validation.h"
 #include "hash.h"
+#include "randomx_bbp.h"
 #include "rpcpog.h"
 #include "rpcpodc.h"
 #include "init.h"
@@ -87,16 +90,20 @@ bool fTxIndex = true;
 bool fAddressIndex = false;
 bool fTimestampIndex = false;
 bool fSpentIndex = false;
+bool fMessageIndex = false;
 bool fHavePruned = false;
 bool fPruneMode = false;
 bool fProd = false;
 bool fLoadingIndex = false;
+/** Set while CVerifyDB disconnects and reconnects tip blocks; those stay connected, so the message index is left alone (guarded by cs_main) */
+static bool fVerifyingDB = false;
 
 bool fIsBareMultisigStd = DEFAULT_PERMIT_BAREMULTISIG;
 bool fRequireStandard = true;
 unsigned int nBytesPerSigOp = DEFAULT_BYTES_PER_SIGOP;
 bool fCheckBlockIndex = false;
 bool fCheckpointsEnabled = DEFAULT_CHECKPOINTS_ENABLED;
+bool fCheckPoWOnDisk = DEFAULT_CHECKPOWONDISK;
 size_t nCoinCacheUsage = 5000 * 300;
 uint64_t nPruneTarget = 0;
 bool fAlerts = DEFAULT_ALERTS;
@@ -115,11 +122,10 @@ CTxMemPool mempool;
 std::map<uint256, int64_t> mapRejectedBlocks GUARDED_BY(cs_main);
 
 // DAC
-std::map<std::pair<std::string, std::string>, std::pair<std::string, int64_t>> mvApplicationCache;
+CApplicationCache mvApplicationCache;
 std::map<std::string, IPFSTransaction> mapSidechainTransactions;
 std::map<std::string, DashUTXO> mapDashUTXO;
 std::map<std::string, POSEScore> mvPOSEScore;
-std::map<std::string, Researcher> mvResearchers;
 
 std::string msGithubVersion;
 std::string msLanguage;
@@ -1186,7 +1192,7 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus:
 		CBlockIndex* pindexPrev = mapBlockIndex[block.hashPrevBlock];
 		if (pindexPrev)
 		{
-			if (!CheckProofOfWork(block.GetHash(), block.nBits, consensusParams, block.GetBlockTime(), pindexPrev->nTime, pindexPrev->nHeight, block.nNonce, pindexPrev, block.RandomXData, block.RandomXKey, 0, true))
+			if (!CheckProofOfWork(block, block.GetHash(), consensusParams, block.GetBlockTime(), pindexPrev->nTime, pindexPrev->nHeight, 0, true))
 				return error("ReadBlockFromDisk: Errors in block header at %s", pos.ToString());
 		}
 	}
@@ -1971,6 +1977,18 @@ static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& s
         }
     }
 
+    if (fMessageIndex && !fVerifyingDB) {
+        std::vector<CMessageIndexKey> vErased;
+        if (!pblocktree->EraseMessageIndex(pindex->nHeight, vErased)) {
+            AbortNode(state, "Failed to delete message index");
+            return DISCONNECT_FAILED;
+        }
+        RestoreIndexedMessages(vErased);
+    }
+
+    DisconnectGSCLedgerBlock(pindex);
+    DisconnectStakeRegistryBlock(block);
+
     // make sure the flag is reset in case of a chain reorg
     // (we reused the DIP3 deployment)
     instantsend.isAutoLockBip9Active = pindex->nHeight >= Params().GetConsensus().DIP0003Height;
@@ -2012,6 +2030,23 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+// RandomX proof of work for header batches is verified on this pool, outside of cs_main
+static ctpl::thread_pool headerVerifyPool;
+
+void StartHeaderVerifyThreads(int nThreads)
+{
+    if (nThreads <= 1)
+        return;
+    headerVerifyPool.resize(nThreads);
+    RenameThreadPool(headerVerifyPool, "dac-hdrverify");
+}
+
+void StopHeaderVerifyThreads()
+{
+    headerVerifyPool.clear_queue();
+    headerVerifyPool.stop(true);
+}
+
 // Protected by cs_main
 VersionBitsCache versionbitscache;
 
@@ -2531,6 +2566,13 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         if (!pblocktree->WriteTimestampIndex(CTimestampIndexKey(pindex->nTime, pindex->GetBlockHash())))
             return AbortNode(state, "Failed to write timestamp index");
 
+    if (fMessageIndex && !fVerifyingDB) {
+        std::vector<std::pair<CMessageIndexKey, CMessageIndexValue> > messageIndex;
+        IndexBlockMessages(block, pindex->nHeight, messageIndex);
+        if (!pblocktree->WriteMessageIndex(pindex->nHeight, messageIndex))
+            return AbortNode(state, "Failed to write message index");
+    }
+
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
 
@@ -2543,6 +2585,7 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
 	// DAC
 	if (!fLoadingIndex) 
 	{
+		ConnectGSCLedgerBlock(block, pindex);
 		MemorizeBlockChainPrayers(true, false, false, false);
 		std::string sStatus = ExecuteGenericSmartContractQuorumProcess();
 		if (fDebugSpam)
@@ -2681,6 +2724,8 @@ void PruneAndFlush() {
 /** Update chainActive and related internal data structures. */
 void static UpdateTip(CBlockIndex *pindexNew, const CChainParams& chainParams) {
     chainActive.SetTip(pindexNew);
+    // In fast mode the next block is most likely verified against the same key, so keep its dataset resident
+    RandomX_SetTipKey(pindexNew->RandomXKey);
 
     // New best block
     mempool.AddTransactionsUpdated(1);
@@ -3500,7 +3545,7 @@ bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, const
 		LogPrintf("\nChecking blockheader %f with rxhash %s and rxmsg %s ", nPrevHeight, block.RandomXKey.GetHex(), block.RandomXData);
 	}
 	
-	if (fCheckPOW && !CheckProofOfWork(block.GetHash(), block.nBits, Params().GetConsensus(), nBlockTime, nPrevBlockTime, nPrevHeight, block.nNonce, pindexPrev, block.RandomXData, block.RandomXKey, 0, false))
+	if (fCheckPOW && !CheckProofOfWork(block, block.GetHash(), Params().GetConsensus(), nBlockTime, nPrevBlockTime, nPrevHeight, 0, false))
 	{
 		LogPrintf("\nCheckBlockHeader::ERROR-FAILED height %f, nonce %f", nPrevHeight, block.nNonce);
         return state.DoS(5, false, REJECT_INVALID, "high-hash", false, "proof of work failed");
@@ -3849,7 +3894,7 @@ bool ContextualCheckBlock(const CBlock& block, CValidationState& state, const Co
     return true;
 }
 
-static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex)
+static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fCheckPOW = true)
 {
     AssertLockHeld(cs_main);
     // Check for duplicate
@@ -3880,7 +3925,7 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
 
 		pindexPrev = (*mi).second;
 		// R ANDREWS - Now we can check the block header:
-		if (!CheckBlockHeader(block, state, chainparams.GetConsensus(), true, block.GetBlockTime(), pindexPrev ? pindexPrev->nTime : 0, pindexPrev ? pindexPrev->nHeight : 0, pindexPrev))
+		if (!CheckBlockHeader(block, state, chainparams.GetConsensus(), fCheckPOW, block.GetBlockTime(), pindexPrev ? pindexPrev->nTime : 0, pindexPrev ? pindexPrev->nHeight : 0, pindexPrev))
             return error("%s: Consensus::CheckBlockHeader: %s, %s", __func__, hash.ToString(), FormatStateMessage(state));
 
 		if (pindexPrev->nStatus & BLOCK_FAILED_MASK)
@@ -3920,14 +3965,180 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
     return true;
 }
 
+/**
+ * Verify the proof of work of a contiguous run of new headers on the header verification pool without holding cs_main.
+ * Returns the hashes of the headers that passed; AcceptBlockHeader then commits those in order without rehashing them.
+ * The cheap context-free and contextual checks run first, so RandomX is only spent on headers that could be accepted,
+ * and a batch needing more distinct RandomX keys than -randomxcachekeys allows is left entirely to the serial path.
+ * Verification stops at the first header that fails; it and everything after it are checked serially as before.
+ */
+static std::set<uint256> PreVerifyHeadersProofOfWork(const std::vector<CBlockHeader>& headers, const CChainParams& chainparams)
+{
+    std::set<uint256> setVerified;
+    if (headers.size() < 2 || headerVerifyPool.size() == 0)
+        return setVerified;
+    const Consensus::Params& consensusParams = chainparams.GetConsensus();
+
+    struct HeaderWork {
+        const CBlockHeader* pheader;
+        uint256 hash;
+        int64_t nPrevTime;
+        int nPrevHeight;
+        bool fNeedRandomX;
+    };
+    std::vector<HeaderWork> vWork;
+    vWork.reserve(headers.size());
+    std::set<uint256> setKeys;
+    {
+        LOCK(cs_main);
+        BlockMap::iterator mi = mapBlockIndex.find(headers[0].hashPrevBlock);
+        if (mi == mapBlockIndex.end())
+            return setVerified;
+        const CBlockIndex* pindexPrev = mi->second;
+        if (pindexPrev->nStatus & (BLOCK_FAILED_MASK | BLOCK_CONFLICT_CHAINLOCK))
+            return setVerified;
+        CValidationState state;
+        state.fDontLog = true;
+        if (fCheckpointsEnabled && !CheckIndexAgainstCheckpoint(pindexPrev, state, chainparams, headers[0].GetHash()))
+            return setVerified;
+
+        // Temporary index entries give the contextual checks of later headers (difficulty, median time past)
+        // the same view of their ancestors that AcceptBlockHeader will have once the earlier ones are accepted
+        std::vector<uint256> vHashes;
+        std::vector<CBlockIndex> vIndex;
+        vHashes.reserve(headers.size());
+        vIndex.reserve(headers.size());
+        int64_t nAdjustedTime = GetAdjustedTime();
+        for (const CBlockHeader& header : headers) {
+            if (header.hashPrevBlock != pindexPrev->GetBlockHash())
+                break;
+            uint256 hash = header.GetHash();
+            BlockMap::iterator miSelf = mapBlockIndex.find(hash);
+            if (miSelf != mapBlockIndex.end()) {
+                // Already known, AcceptBlockHeader returns early for it
+                if (miSelf->second->nStatus & BLOCK_FAILED_MASK)
+                    break;
+                pindexPrev = miSelf->second;
+                continue;
+            }
+            if (!CheckBlockHeader(header, state, consensusParams, false, header.GetBlockTime(), pindexPrev->nTime, pindexPrev->nHeight, pindexPrev))
+                break;
+            if (!ContextualCheckBlockHeader(header, state, consensusParams, pindexPrev, nAdjustedTime))
+                break;
+            bool fNeedRandomX = IsRandomXPoWHashNeeded(header, hash, consensusParams, pindexPrev->nTime, pindexPrev->nHeight, false);
+            if (fNeedRandomX)
+                setKeys.insert(header.RandomXKey);
+            vWork.push_back({&header, hash, pindexPrev->nTime, pindexPrev->nHeight, fNeedRandomX});
+
+            vHashes.push_back(hash);
+            vIndex.emplace_back(header);
+            CBlockIndex& indexNew = vIndex.back();
+            indexNew.phashBlock = &vHashes.back();
+            indexNew.pprev = const_cast<CBlockIndex*>(pindexPrev);
+            indexNew.nHeight = pindexPrev->nHeight + 1;
+            indexNew.BuildSkip();
+            pindexPrev = &indexNew;
+        }
+    }
+    if (vWork.size() < 2)
+        return setVerified;
+    if ((int)setKeys.size() > RandomX_GetMaxCachedKeys()) {
+        // Every key costs a full RandomX cache, so a peer cycling keys must not get them built in parallel
+        LogPrint("bench", "%s: %u RandomX keys in %u headers exceeds -randomxcachekeys, verifying serially\n", __func__, setKeys.size(), vWork.size());
+        return setVerified;
+    }
+
+    // Index of the first header that failed (or whose batch threw); workers skip everything at or after it
+    std::atomic<size_t> nFirstFailed(vWork.size());
+    auto MarkFailed = [&nFirstFailed](size_t nIndex) {
+        size_t nCurrent = nFirstFailed.load();
+        while (nIndex < nCurrent && !nFirstFailed.compare_exchange_weak(nCurrent, nIndex)) {}
+    };
+
+    std::vector<char> vValid(vWork.size(), 0);
+    std::list<std::future<bool> > futures;
+    size_t nBatchSize = std::max((size_t)1, vWork.size() / (headerVerifyPool.size() * 4));
+    for (size_t i = 0; i < vWork.size(); i += nBatchSize) {
+        size_t start = i;
+        size_t count = std::min(nBatchSize, vWork.size() - start);
+        auto f = [&, start, count](int threadId) {
+            try {
+                if (start >= nFirstFailed.load())
+                    return false;
+                // Run RandomX for the batch up front, one pipelined pass per run of headers sharing a key
+                std::vector<RandomXInput> vInputs;
+                std::vector<uint256> vOut;
+                std::vector<uint256> vRandomX(count);
+                vInputs.reserve(count);
+                for (size_t j = start; j < start + count; ) {
+                    const CBlockHeader& first = *vWork[j].pheader;
+                    size_t nRunStart = j;
+                    vInputs.clear();
+                    for (; j < start + count && vWork[j].pheader->RandomXKey == first.RandomXKey; j++) {
+                        if (vWork[j].fNeedRandomX)
+                            vInputs.push_back({vWork[j].pheader->RandomXHeader.data(), vWork[j].pheader->RandomXHeader.size()});
+                    }
+                    if (vInputs.empty())
+                        continue;
+                    if (nRunStart >= nFirstFailed.load())
+                        return false;
+                    vOut.resize(vInputs.size());
+                    CRandomXVM vm(first.RandomXKey);
+                    vm.HashBatch(vInputs.data(), vInputs.size(), vOut.data());
+                    for (size_t k = nRunStart, n = 0; k < j; k++) {
+                        if (vWork[k].fNeedRandomX)
+                            vRandomX[k - start] = vOut[n++];
+                    }
+                }
+                for (size_t j = start; j < start + count; j++) {
+                    if (j >= nFirstFailed.load())
+                        return false;
+                    const CBlockHeader& header = *vWork[j].pheader;
+                    const uint256* pRandomXHash = vWork[j].fNeedRandomX ? &vRandomX[j - start] : NULL;
+                    vValid[j] = CheckProofOfWork(header, vWork[j].hash, consensusParams, header.GetBlockTime(), vWork[j].nPrevTime, vWork[j].nPrevHeight, threadId, false, pRandomXHash);
+                    if (!vValid[j]) {
+                        MarkFailed(j);
+                        return false;
+                    }
+                }
+                return true;
+            } catch (const std::exception& e) {
+                LogPrintf("%s: header verification failed: %s\n", __func__, e.what());
+            } catch (...) {
+                LogPrintf("%s: header verification failed\n", __func__);
+            }
+            MarkFailed(start);
+            return false;
+        };
+        futures.emplace_back(headerVerifyPool.push(f));
+    }
+    // Every future is waited on, the workers reference this frame
+    for (auto& f : futures) {
+        try {
+            f.get();
+        } catch (...) {
+            nFirstFailed = 0;
+        }
+    }
+
+    size_t nVerified = nFirstFailed.load();
+    for (size_t i = 0; i < nVerified; i++) {
+        if (vValid[i])
+            setVerified.insert(vWork[i].hash);
+    }
+    return setVerified;
+}
+
 // Exposed wrapper for AcceptBlockHeader
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex)
 {
+    std::set<uint256> setPowVerified = PreVerifyHeadersProofOfWork(headers, chainparams);
     {
         LOCK(cs_main);
         for (const CBlockHeader& header : headers) {
             CBlockIndex *pindex = NULL; // Use a temp pindex instead of ppindex to avoid a const_cast
-            if (!AcceptBlockHeader(header, state, chainparams, &pindex)) {
+            bool fCheckPOW = setPowVerified.empty() || !setPowVerified.count(header.GetHash());
+            if (!AcceptBlockHeader(header, state, chainparams, &pindex, fCheckPOW)) {
                 return false;
             }
             if (ppindex) {
@@ -4444,6 +4655,10 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
     pblocktree->ReadFlag("spentindex", fSpentIndex);
     LogPrintf("%s: spent index %s\n", __func__, fSpentIndex ? "enabled" : "disabled");
 
+    // Check whether we have a message index
+    pblocktree->ReadFlag("messageindex", fMessageIndex);
+    LogPrintf("%s: message index %s\n", __func__, fMessageIndex ? "enabled" : "disabled");
+
     // Load pointer to end of best chain
     BlockMap::iterator it = mapBlockIndex.find(pcoinsTip->GetBestBlock());
     if (it == mapBlockIndex.end())
@@ -4476,6 +4691,11 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
     if (chainActive.Tip() == NULL || chainActive.Tip()->pprev == NULL)
         return true;
 
+    struct VerifyingDBFlag {
+        VerifyingDBFlag() { fVerifyingDB = true; }
+        ~VerifyingDBFlag() { fVerifyingDB = false; }
+    } verifyingDBFlag;
+
     // begin tx and let it rollback
     auto dbTx = evoDb->BeginTransaction();
 
@@ -4643,6 +4863,9 @@ bool InitBlockIndex(const CChainParams& chainparams)
     fSpentIndex = GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
     pblocktree->WriteFlag("spentindex", fSpentIndex);
 
+    fMessageIndex = GetBoolArg("-messageindex", DEFAULT_MESSAGEINDEX);
+    pblocktree->WriteFlag("messageindex", fMessageIndex);
+
     LogPrintf("Initializing databases...\n");
 
     // Only add the genesis block if not reindexing (in which case we reuse the one already on disk)
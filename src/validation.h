@@ -197,10 +197,13 @@ extern bool fProposalNeedsSubmitted;
 static const bool DEFAULT_PERMIT_BAREMULTISIG = true;
 static const unsigned int DEFAULT_BYTES_PER_SIGOP = 20;
 static const bool DEFAULT_CHECKPOINTS_ENABLED = true;
+/** Default for -checkpowondisk */
+static const bool DEFAULT_CHECKPOWONDISK = false;
 static const bool DEFAULT_TXINDEX = true;
 static const bool DEFAULT_ADDRESSINDEX = false;
 static const bool DEFAULT_TIMESTAMPINDEX = false;
 static const bool DEFAULT_SPENTINDEX = false;
+static const bool DEFAULT_MESSAGEINDEX = false;
 static const unsigned int DEFAULT_BANSCORE_THRESHOLD = 100;
 
 /** Maximum number of headers to announce when relaying blocks with headers message.*/
@@ -232,11 +235,13 @@ extern std::atomic_bool fImporting;
 extern bool fReindex;
 extern int nScriptCheckThreads;
 extern bool fTxIndex;
+extern bool fMessageIndex;
 extern bool fIsBareMultisigStd;
 extern bool fRequireStandard;
 extern unsigned int nBytesPerSigOp;
 extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
+extern bool fCheckPoWOnDisk;
 extern bool fProd;
 extern bool fLoadingIndex;
 
@@ -254,18 +259,17 @@ extern bool fLargeWorkInvalidChainFound;
 extern int nSideChainHeight;
 
 extern std::map<uint256, int64_t> mapRejectedBlocks;
-extern std::map<std::pair<std::string, std::string>, std::pair<std::string, int64_t>> mvApplicationCache;
+class CApplicationCache;
+extern CApplicationCache mvApplicationCache;
 
 struct IPFSTransaction;
 struct POSEScore;
-struct Researcher;
 struct DashUTXO;
 
 extern std::map<std::string, IPFSTransaction> mapSidechainTransactions;
 extern std::map<std::string, DashUTXO> mapDashUTXO;
 extern std::map<std::string, POSEScore> mvPOSEScore;
 extern std::atomic<bool> fDIP0001ActiveAtTip;
-extern std::map<std::string, Researcher> mvResearchers;
 
 /** Block hash whose ancestors we will assume to have valid scripts without checking them. */
 extern uint256 hashAssumeValid;
@@ -350,6 +354,9 @@ bool LoadBlockIndex(const CChainParams& chainparams);
 void UnloadBlockIndex();
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Start/stop the worker pool that verifies header proof of work in parallel during header sync */
+void StartHeaderVerifyThreads(int nThreads);
+void StopHeaderVerifyThreads();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
 /** Format a string that describes several potential problems detected by the core.